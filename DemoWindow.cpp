@@ -5,6 +5,8 @@
  */
 #include "DemoWindow.h"
 #include "qtChatWidget/qtChatWidget.h"
+#include "qtChatWidget/qtChatBackend.h"
+#include "qtChatWidget/qtChatMockServer.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QPushButton>
@@ -109,30 +111,57 @@ DemoWindow::DemoWindow(QWidget* parent) : QWidget(parent), _messageCounter(0)
 	_statusLabel->setStyleSheet("padding: 5px; background-color: #f0f0f0; border-top: 1px solid #ccc;");
 	mainLayout->addWidget(_statusLabel);
 
+	// Replies come from a local mock of an OpenAI-compatible server: after a delay they stream in
+	// word by word, so the progress readout shows the time to first token and the tokens per second
+	_mockServer = new ChatMockServer(this);
+	_mockServer->setFirstTokenDelay(1500);
+	_mockServer->setTokenInterval(60);
+	_mockServer->setReply([](const QJsonArray& messages) {
+		const QString message = messages.isEmpty() ? QString() : messages.last().toObject().value("content").toString();
+		return QString("I received your message: \"%1\". This is a simulated response, "
+			"streamed in one word at a time like tokens from a language model.").arg(message);
+		});
+	if (!_mockServer->listen()) {
+		qWarning() << "Mock server could not listen on 127.0.0.1";
+	}
+
+	// The backend answers every message sent, with the conversation as context
+	_backend = new ChatBackend(this);
+	_backend->setEndpoint(_mockServer->url());
+	_backend->preconnect();
+	_backend->attach(_chatWidget);
+
+	// The same question in the same context (e.g. after Clear History) is answered at once; memory only here
+	_backend->setResponseCache(&_responseCache);
+
+	// Messages sent while a reply streams in wait their turn instead of being refused
+	_chatWidget->SetQueueMode(uiChatWidget::QueueInOrder);
+
+	connect(_backend, &ChatBackend::replyFinished, this, [this]() {
+		if (_backend->isReplyFromCache()) {
+			const ChatResponseCacheStats cacheStats = _responseCache.stats();
+			_statusLabel->setText(QString("Response served from the cache (%1 hits, %2 ms saved so far) - Ready for next message")
+				.arg(cacheStats.hits).arg(cacheStats.savedMs));
+			return;
+		}
+		const ChatStreamStats stats = _chatWidget->GetStreamStats();
+		_statusLabel->setText(QString("Response received in %1 ms (first token after %2 ms) - Ready for next message")
+			.arg(stats.elapsedMs).arg(stats.timeToFirstTokenMs));
+		});
+	connect(_backend, &ChatBackend::replyFailed, this, [this](const QString& errorString) {
+		_statusLabel->setText(QString("Request failed: %1").arg(errorString));
+		});
+
 	// Connect chat widget signal
 	connect(_chatWidget, &uiChatWidget::messageSent, this, &DemoWindow::onMessageSent);
 }
 
 void DemoWindow::onMessageSent(const QString& message)
 {
-	_statusLabel->setText(QString("Message sent: \"%1\"").arg(message));
 	qDebug() << "User message:" << message;
 
-	// Disable input while "processing"
-	_chatWidget->SetInputEnabled(false);
-	_chatWidget->ShowProgressIndicator();
-
-	// Simulate async AI processing with a timer
-	QTimer::singleShot(1500, this, [this, message]() {
-		// Simulate AI response
-		QString response = QString("I received your message: \"%1\". This is a simulated response!")
-			.arg(message);
-		_chatWidget->AppendChatMessage("Assistant", response);
-
-		_chatWidget->HideProgressIndicator();
-		_chatWidget->SetInputEnabled(true);
-		_statusLabel->setText("Response received - Ready for next message");
-		});
+	// The backend disables the input and shows the progress indicator until the reply is in
+	_statusLabel->setText(QString("Message sent: \"%1\" - waiting for the reply...").arg(message));
 }
 
 void DemoWindow::onSimulateResponse()
@@ -7,9 +7,12 @@
 #define DEMO_WINDOW_H
 
 #include <QWidget>
+#include "qtChatWidget/qtChatResponseCache.h"
 
 class QLabel;
 class uiChatWidget;
+class ChatBackend;
+class ChatMockServer;
 
 /**
  * \brief Demo window showcasing qtChatWidget features
@@ -35,6 +38,9 @@ void onToggleProgress();
 private:
     uiChatWidget* _chatWidget;
     QLabel* _statusLabel;
+    ChatBackend* _backend;
+    ChatMockServer* _mockServer;
+    ChatResponseCache _responseCache;
     int _messageCounter;
 };
 
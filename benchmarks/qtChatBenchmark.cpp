@@ -0,0 +1,132 @@
+/**
+ * File: qtChatBenchmark.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 27/04/2026| Tian-Qing Ye   | Created: minimal benchmark runner with JSON output
+ */
+#include "qtChatBenchmark.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QTextStream>
+#include <algorithm>
+
+namespace
+{
+	//! Upper bound on repetitions, for benchmarks much faster than the timer
+	const int kMaxRepetitions = 100000;
+}
+
+ChatBenchmarkRunner::ChatBenchmarkRunner(double minTimeSeconds, int minRepetitions)
+	: _minTimeSeconds(minTimeSeconds)
+	, _minRepetitions(qMax(1, minRepetitions))
+{
+}
+
+void ChatBenchmarkRunner::setFilter(const QString& pattern)
+{
+	_filter = pattern.isEmpty() ? QRegularExpression() : QRegularExpression(pattern);
+}
+
+bool ChatBenchmarkRunner::matches(const QString& name) const
+{
+	return _filter.pattern().isEmpty() || _filter.match(name).hasMatch();
+}
+
+bool ChatBenchmarkRunner::run(const QString& name, qint64 items, const Repetition& repetition)
+{
+	if (!matches(name)) return false;
+
+	const qint64 minTimeNs = qint64(_minTimeSeconds * 1e9);
+	QVector<qint64> times;
+	qint64 total = 0;
+	while (times.size() < _minRepetitions || (total < minTimeNs && times.size() < kMaxRepetitions)) {
+		const qint64 elapsed = repetition();
+		times.append(elapsed);
+		total += elapsed;
+	}
+
+	std::sort(times.begin(), times.end());
+	const double perItem = 1.0 / qMax<qint64>(1, items);
+
+	ChatBenchmarkResult result;
+	result.name = name;
+	result.repetitions = times.size();
+	result.items = items;
+	result.meanNs = double(total) / times.size() * perItem;
+	result.medianNs = times.at(times.size() / 2) * perItem;
+	result.minNs = times.first() * perItem;
+	_results.append(result);
+
+	QTextStream out(stdout);
+	out << QString("%1 %2 ns/op (median %3, min %4, %5 x %6)")
+		.arg(name, -56)
+		.arg(result.meanNs, 12, 'f', 1)
+		.arg(result.medianNs, 0, 'f', 1)
+		.arg(result.minNs, 0, 'f', 1)
+		.arg(result.repetitions)
+		.arg(items) << Qt::endl;
+	return true;
+}
+
+void ChatBenchmarkRunner::setCounter(const QString& key, const QVariant& value)
+{
+	if (_results.isEmpty()) return;
+
+	_results.last().counters.insert(key, value);
+	QTextStream(stdout) << "    " << key << " = " << value.toString() << Qt::endl;
+}
+
+void ChatBenchmarkRunner::setContext(const QString& key, const QVariant& value)
+{
+	_context.insert(key, value);
+}
+
+QByteArray ChatBenchmarkRunner::toJson() const
+{
+	QJsonArray benchmarks;
+	for (const ChatBenchmarkResult& result : _results) {
+		QJsonObject entry;
+		entry.insert("name", result.name);
+		entry.insert("run_name", result.name);
+		entry.insert("run_type", "iteration");
+		entry.insert("repetitions", result.repetitions);
+		entry.insert("iterations", double(result.repetitions) * result.items);
+		entry.insert("real_time", result.meanNs);
+		entry.insert("median_time", result.medianNs);
+		entry.insert("min_time", result.minNs);
+		entry.insert("time_unit", "ns");
+		if (result.meanNs > 0) {
+			entry.insert("items_per_second", 1e9 / result.meanNs);
+		}
+		for (auto it = result.counters.constBegin(); it != result.counters.constEnd(); ++it) {
+			entry.insert(it.key(), QJsonValue::fromVariant(it.value()));
+		}
+		benchmarks.append(entry);
+	}
+
+	QJsonObject root;
+	root.insert("context", QJsonObject::fromVariantMap(_context));
+	root.insert("benchmarks", benchmarks);
+	return QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
+
+bool ChatBenchmarkRunner::writeJson(const QString& fileName, QString* errorString) const
+{
+	if (fileName == QLatin1String("-")) {
+		QTextStream(stdout) << toJson();
+		return true;
+	}
+
+	QSaveFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly) || file.write(toJson()) < 0 || !file.commit()) {
+		if (errorString) {
+			*errorString = file.errorString();
+		}
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,94 @@
+/**
+ * File: qtChatBenchmark.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 27/04/2026| Tian-Qing Ye  | Created: minimal benchmark runner with JSON output
+ */
+#ifndef QT_CHATBENCHMARK_H
+#define QT_CHATBENCHMARK_H
+
+#include <QString>
+#include <QVector>
+#include <QVariantMap>
+#include <QRegularExpression>
+#include <functional>
+
+/**
+ * \brief Timings of one benchmark
+ */
+struct ChatBenchmarkResult
+{
+	QString name;
+	int repetitions = 0;		// Timed repetitions
+	qint64 items = 1;			// Operations per repetition
+	double meanNs = 0;			// Mean time per operation
+	double medianNs = 0;		// Median time per operation
+	double minNs = 0;			// Fastest time per operation
+	QVariantMap counters;		// Extra figures (e.g. bytes per message)
+};
+
+/**
+ * \brief Minimal benchmark runner
+ *
+ * A benchmark is a function performing one repetition and returning the
+ * nanoseconds spent in its measured part, so per-repetition setup is left
+ * out of the figures. Repetitions go on until both a minimum count and a
+ * minimum total measured time are reached.
+ *
+ * Results are written as JSON laid out like Google Benchmark output
+ * ("context" plus a "benchmarks" array with name, iterations, real_time and
+ * time_unit), so existing comparison tooling can read them.
+ */
+class ChatBenchmarkRunner
+{
+public:
+	//! One repetition; returns the measured nanoseconds
+	typedef std::function<qint64()> Repetition;
+
+	/**
+	 * \brief Constructor
+	 * \param minTimeSeconds Minimum total measured time per benchmark
+	 * \param minRepetitions Minimum number of repetitions per benchmark
+	 */
+	ChatBenchmarkRunner(double minTimeSeconds, int minRepetitions);
+
+	//! Only run benchmarks whose name matches (empty pattern runs everything)
+	void setFilter(const QString& pattern);
+
+	//! Returns true if a benchmark of this name would run (check before costly setup)
+	bool matches(const QString& name) const;
+
+	/**
+	 * \brief Time a benchmark and print a line to stdout
+	 * \param name Benchmark name, "Group/variant/parameter"
+	 * \param items Operations per repetition (times are reported per operation)
+	 * \param repetition One repetition
+	 * \return false if the filter skipped it
+	 */
+	bool run(const QString& name, qint64 items, const Repetition& repetition);
+
+	//! Attach an extra figure to the benchmark that ran last
+	void setCounter(const QString& key, const QVariant& value);
+
+	//! Add a field to the "context" object of the JSON output
+	void setContext(const QString& key, const QVariant& value);
+
+	const QVector<ChatBenchmarkResult>& results() const { return _results; }
+
+	//! Results as a JSON document
+	QByteArray toJson() const;
+
+	//! Write toJson() to a file ("-" for stdout)
+	bool writeJson(const QString& fileName, QString* errorString) const;
+
+private:
+	double _minTimeSeconds;
+	int _minRepetitions;
+	QRegularExpression _filter;
+	QVariantMap _context;
+	QVector<ChatBenchmarkResult> _results;
+};
+
+#endif // QT_CHATBENCHMARK_H
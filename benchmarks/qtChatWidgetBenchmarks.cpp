@@ -0,0 +1,1023 @@
+/**
+ * File: qtChatWidgetBenchmarks.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 27/04/2026| Tian-Qing Ye   | Created: headless benchmarks of the widget hot paths
+ * 04/05/2026| Tian-Qing Ye   | Append with the instrumentation on, to track its overhead
+ * 18/05/2026| Tian-Qing Ye   | Switching among sessions, cached and evicted
+ * 25/05/2026| Tian-Qing Ye   | Constructing many widgets, with the theme per widget and application wide
+ * 01/06/2026| Tian-Qing Ye   | Appending past a display limit, with history memory before and after
+ * 08/06/2026| Tian-Qing Ye   | Tokenizing code blocks, and appending a reply with a long one
+ * 15/06/2026| Tian-Qing Ye   | Appending an oversized message, collapsed and in full
+ * 22/06/2026| Tian-Qing Ye   | Building a compacted context (summaries of old runs)
+ * 29/06/2026| Tian-Qing Ye   | Streaming replies from the localhost mock server, alone and into a widget
+ * 13/07/2026| Tian-Qing Ye   | Response cache: fingerprinting a context, hits from memory and from disk
+ * 20/07/2026| Tian-Qing Ye   | Serializing a 1 MB context to request JSON, directly and through QJsonDocument
+ * 16/10/2026| Tian-Qing Ye   | Context JSON: the direct output checked against the QJsonDocument one
+ * 16/10/2026| Tian-Qing Ye   | Laying out the whole list view after a resize, at growing history sizes
+ * 16/10/2026| Tian-Qing Ye   | Display limit: with a history file too, and the memory growth once past the limit
+ *
+ * Usage: qtChatWidgetBenchmarks [--quick] [--filter <regex>] [--min-time <s>] [--out <file.json>]
+ *
+ * Runs without a display (QT_QPA_PLATFORM defaults to offscreen).
+ */
+#include "qtChatBenchmark.h"
+#include "qtChatWidget.h"
+#include "qtChatHistoryStore.h"
+#include "qtChatHistoryArchive.h"
+#include "qtChatExporter.h"
+#include "qtChatFragmentCache.h"
+#include "qtChatSearchIndex.h"
+#include "qtChatTheme.h"
+#include "qtChatCodeHighlighter.h"
+#include "qtChatBackend.h"
+#include "qtChatMockServer.h"
+#include "qtChatResponseCache.h"
+#include <QApplication>
+#include <QBuffer>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFont>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLineEdit>
+#include <QListView>
+#include <QPushButton>
+#include <QRandomGenerator>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextDocument>
+#include <QTextEdit>
+#include <QTextStream>
+#include <QThread>
+
+namespace
+{
+	const char* const kWords[] = {
+		"model", "context", "window", "token", "message", "history", "render", "widget",
+		"thread", "buffer", "index", "search", "export", "import", "stream", "layout",
+		"the", "a", "of", "to", "and", "is", "in", "that", "for", "it", "with", "on",
+		"performance", "latency", "memory", "answer", "question", "example", "function", "value"
+	};
+	const int kWordCount = int(sizeof(kWords) / sizeof(kWords[0]));
+
+	//! Deterministic filler text of roughly the given length
+	QString makeText(QRandomGenerator& random, int length)
+	{
+		QString text;
+		text.reserve(length + 16);
+		while (text.size() < length) {
+			if (!text.isEmpty()) {
+				text += (random.bounded(12) == 0) ? QLatin1String(". ") : QLatin1String(" ");
+			}
+			text += QLatin1String(kWords[random.bounded(kWordCount)]);
+		}
+		return text;
+	}
+
+	//! Assistant reply using most of the markdown the display renders
+	QString makeMarkdown(QRandomGenerator& random, int salt)
+	{
+		QString text;
+		text += QString("## Answer %1\n\n").arg(salt);
+		text += makeText(random, 160) + " with **bold**, *italic* and `inline code`.\n\n";
+		for (int i = 0; i < 4; ++i) {
+			text += QString("- item %1: ").arg(i) + makeText(random, 40) + "\n";
+		}
+		text += "\n1. first\n2. second\n   - nested [link](https://example.com)\n\n";
+		text += "```cpp\nint square(int x)\n{\n\treturn x * x; // " + makeText(random, 30) + "\n}\n```\n\n";
+		text += "| Name | Value | Notes |\n|------|------:|-------|\n";
+		for (int i = 0; i < 4; ++i) {
+			text += QString("| row%1 | %2 | ").arg(i).arg(random.bounded(1000)) + makeText(random, 20) + " |\n";
+		}
+		text += "\n> " + makeText(random, 80) + "\n";
+		return text;
+	}
+
+	/**
+	 * \brief Deterministic conversation: user and assistant turns with a system note now and then
+	 * \param count Number of messages
+	 * \param salt Makes the content unique per call (defeats the fragment cache)
+	 * \param markdownEvery Every n-th assistant reply is markdown heavy (0 for none)
+	 */
+	QList<ChatMessage> makeHistory(int count, int salt = 0, int markdownEvery = 8)
+	{
+		QRandomGenerator random(quint32(0x5eed + salt));
+		const QDateTime start(QDate(2026, 1, 5), QTime(9, 0));
+
+		QList<ChatMessage> history;
+		history.reserve(count);
+		for (int i = 0; i < count; ++i) {
+			const QString timestamp = start.addSecs(i * 7).toString(ChatHistoryStore::TimestampFormat);
+			if (i % 25 == 24) {
+				history.append(ChatMessage(timestamp, "System", QString("Note %1/%2").arg(salt).arg(i), "system"));
+			}
+			else if (i % 2 == 0) {
+				history.append(ChatMessage(timestamp, "You", QString("[%1] ").arg(salt) + makeText(random, 40 + random.bounded(120)) + "?", "user"));
+			}
+			else if (markdownEvery > 0 && (i / 2) % markdownEvery == 0) {
+				history.append(ChatMessage(timestamp, "Assistant", makeMarkdown(random, salt * 1000003 + i), "assistant"));
+			}
+			else {
+				history.append(ChatMessage(timestamp, "Assistant", QString("[%1] ").arg(salt) + makeText(random, 200 + random.bounded(400)), "assistant"));
+			}
+		}
+		return history;
+	}
+
+	//! Heap bytes of one QString payload (header plus UTF-16 data and terminator)
+	qint64 stringBytes(const QString& text)
+	{
+		return text.isEmpty() ? 0 : qint64(sizeof(QArrayData)) + (text.capacity() + 1) * qint64(sizeof(QChar));
+	}
+
+	//! Approximate heap bytes of a history kept as QList<ChatMessage> (the layout before ChatHistoryStore)
+	qint64 listMemoryUsage(const QList<ChatMessage>& history)
+	{
+		// QList stores large types as pointers to heap-allocated nodes
+		qint64 bytes = qint64(history.size()) * (sizeof(void*) + sizeof(ChatMessage));
+		for (const ChatMessage& msg : history) {
+			bytes += stringBytes(msg.timestamp) + stringBytes(msg.sender) + stringBytes(msg.message) + stringBytes(msg.role);
+		}
+		return bytes;
+	}
+
+	//! A visible widget of a given view mode, rendered and idle
+	uiChatWidget* makeWidget(uiChatWidget::ViewMode mode)
+	{
+		uiChatWidget* widget = new uiChatWidget("Benchmark", "Benchmark");
+		widget->SetViewMode(mode);
+		widget->resize(800, 900);
+		widget->show();
+		QCoreApplication::processEvents();
+		widget->FlushPendingRender();
+		return widget;
+	}
+
+	//! Replace the widget history and render it right away
+	void loadHistory(uiChatWidget* widget, const QList<ChatMessage>& history)
+	{
+		widget->SetChatHistory(history);
+		widget->FlushPendingRender();
+		QCoreApplication::processEvents();
+	}
+
+	QString modeName(uiChatWidget::ViewMode mode)
+	{
+		return (mode == uiChatWidget::ListView) ? QStringLiteral("list") : QStringLiteral("document");
+	}
+
+	//! ChatHistoryStore::assign() of a large history: time per message, and heap bytes per message against a QList<ChatMessage>
+	void benchmarkHistoryStore(ChatBenchmarkRunner& runner, bool quick)
+	{
+		const int count = quick ? 10000 : 100000;
+		const QString name = QString("HistoryStore/assign/%1").arg(count);
+		if (!runner.matches(name)) return;
+
+		const QList<ChatMessage> history = makeHistory(count, 1, 0);
+		ChatHistoryStore store;
+		runner.run(name, count, [&]() {
+			QElapsedTimer timer;
+			timer.start();
+			store.assign(history);
+			return timer.nsecsElapsed();
+		});
+		runner.setCounter("bytes_per_message", double(store.memoryUsage()) / count);
+		runner.setCounter("bytes_per_message_qlist", double(listMemoryUsage(history)) / count);
+	}
+
+	/**
+	 * \brief AppendChatMessage plus the frame that renders it, at growing history sizes
+	 * \param instrumented Run with the latency instrumentation on (to measure its overhead)
+	 */
+	void benchmarkAppend(ChatBenchmarkRunner& runner, bool quick, uiChatWidget::ViewMode mode, bool instrumented = false)
+	{
+		const QVector<int> sizes = quick ? QVector<int>{ 100, 1000 } : QVector<int>{ 1000, 10000, 50000 };
+		const int batch = 20;
+
+		for (int size : sizes) {
+			const QString name = QString("AppendChatMessage/%1%2/history:%3")
+				.arg(modeName(mode), instrumented ? QStringLiteral("/instrumented") : QString()).arg(size);
+			if (!runner.matches(name)) continue;
+
+			QScopedPointer<uiChatWidget> widget(makeWidget(mode));
+			loadHistory(widget.data(), makeHistory(size, 2));
+			widget->SetInstrumentationEnabled(instrumented);
+
+			QRandomGenerator random(7);
+			int sent = 0;
+			runner.run(name, batch, [&]() {
+				QStringList texts;
+				for (int i = 0; i < batch; ++i) {
+					texts.append(QString("%1 ").arg(++sent) + makeText(random, 240));
+				}
+
+				QElapsedTimer timer;
+				timer.start();
+				for (int i = 0; i < batch; ++i) {
+					widget->AppendChatMessage((i % 2) ? "Assistant" : "You", texts.at(i));
+					widget->FlushPendingRender();
+				}
+				return timer.nsecsElapsed();
+			});
+
+			if (widget->IsInstrumentationEnabled()) {
+				const ChatLatencyStats& frames = widget->GetInstrumentationStats()[ChatTraceStage::Frame];
+				runner.setCounter("frame_p50_ns", frames.percentileNs(0.5));
+				runner.setCounter("frame_p99_ns", frames.percentileNs(0.99));
+			}
+		}
+	}
+
+	//! SetChatHistory of fresh content (every message parsed) and of the same content again (cache hits)
+	void benchmarkSetHistory(ChatBenchmarkRunner& runner, bool quick)
+	{
+		const QVector<int> sizes = quick ? QVector<int>{ 100, 1000 } : QVector<int>{ 1000, 10000 };
+
+		for (int size : sizes) {
+			const QString coldName = QString("SetChatHistory/document/cold/%1").arg(size);
+			const QString warmName = QString("SetChatHistory/document/cached/%1").arg(size);
+			if (!runner.matches(coldName) && !runner.matches(warmName)) continue;
+
+			QScopedPointer<uiChatWidget> widget(makeWidget(uiChatWidget::DocumentView));
+			int salt = 100;
+			runner.run(coldName, size, [&]() {
+				const QList<ChatMessage> history = makeHistory(size, ++salt);
+				QElapsedTimer timer;
+				timer.start();
+				widget->SetChatHistory(history);
+				widget->FlushPendingRender();
+				return timer.nsecsElapsed();
+			});
+
+			const QList<ChatMessage> history = makeHistory(size, 99);
+			loadHistory(widget.data(), history);
+			runner.run(warmName, size, [&]() {
+				QElapsedTimer timer;
+				timer.start();
+				widget->SetChatHistory(history);
+				widget->FlushPendingRender();
+				return timer.nsecsElapsed();
+			});
+		}
+	}
+
+	//! A full layout of the list view at a new width, at growing history sizes: the time per row must stay flat (no markdown parsed)
+	void benchmarkListLayout(ChatBenchmarkRunner& runner, bool quick)
+	{
+		const QVector<int> sizes = quick ? QVector<int>{ 1000, 10000 } : QVector<int>{ 1000, 10000, 100000 };
+
+		for (int size : sizes) {
+			const QString name = QString("ListView/layout/resized/history:%1").arg(size);
+			if (!runner.matches(name)) continue;
+
+			QScopedPointer<uiChatWidget> widget(makeWidget(uiChatWidget::ListView));
+			loadHistory(widget.data(), makeHistory(size, 7));
+			QListView* view = widget->findChild<QListView*>("chatHistory");
+			if (!view) continue;
+
+			// Every row in one pass, so the whole layout is timed; each repetition at a width not seen before
+			view->setLayoutMode(QListView::SinglePass);
+			int step = 0;
+			runner.run(name, size, [&]() {
+				widget->resize(600 + (++step * 67) % 800, 900);
+				QElapsedTimer timer;
+				timer.start();
+				view->doItemsLayout();
+				return timer.nsecsElapsed();
+			});
+		}
+	}
+
+	//! BuildContextMessages / BuildContextMessagesByTokens at growing history sizes: the time per call must stay flat (O(k), not O(n))
+	void benchmarkContext(ChatBenchmarkRunner& runner, bool quick)
+	{
+		const QVector<int> sizes = quick ? QVector<int>{ 1000, 10000 } : QVector<int>{ 1000, 10000, 100000 };
+		const int calls = 100;
+
+		for (int size : sizes) {
+			const QString byCount = QString("BuildContextMessages/last:20/history:%1").arg(size);
+			const QString byTokens = QString("BuildContextMessagesByTokens/budget:4000/history:%1").arg(size);
+			const QString compacted = QString("BuildContextMessages/last:20/compacted/history:%1").arg(size);
+			if (!runner.matches(byCount) && !runner.matches(byTokens) && !runner.matches(compacted)) continue;
+
+			// The list view renders only visible rows, so big histories load quickly
+			QScopedPointer<uiChatWidget> widget(makeWidget(uiChatWidget::ListView));
+			loadHistory(widget.data(), makeHistory(size, 3));
+
+			int returned = 0;
+			runner.run(byCount, calls, [&]() {
+				QElapsedTimer timer;
+				timer.start();
+				for (int i = 0; i < calls; ++i) {
+					returned += widget->BuildContextMessages(20).size();
+				}
+				return timer.nsecsElapsed();
+			});
+			runner.run(byTokens, calls, [&]() {
+				QElapsedTimer timer;
+				timer.start();
+				for (int i = 0; i < calls; ++i) {
+					returned += widget->BuildContextMessagesByTokens(4000).size();
+				}
+				return timer.nsecsElapsed();
+			});
+
+			// A stand-in summarizer (the first words of each message); the summaries are made before timing
+			if (runner.matches(compacted)) {
+				widget->SetContextSummarizer([](const QList<ChatMessage>& messages) {
+					QString summary;
+					for (const ChatMessage& message : messages) {
+						summary += message.role + ": " + message.message.left(40) + '\n';
+					}
+					return summary;
+				}, 16, 4);
+				QElapsedTimer wait;
+				wait.start();
+				while (widget->GetContextSummaryCount() < 4 && wait.elapsed() < 10000) {
+					QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+				}
+
+				int contextSize = 0;
+				runner.run(compacted, calls, [&]() {
+					QElapsedTimer timer;
+					timer.start();
+					for (int i = 0; i < calls; ++i) {
+						contextSize = widget->BuildContextMessages(20).size();
+					}
+					return timer.nsecsElapsed();
+				});
+				runner.setCounter("context_messages", contextSize);
+				runner.setCounter("summaries", widget->GetContextSummaryCount());
+			}
+			Q_UNUSED(returned);
+		}
+	}
+
+	//! Markdown-heavy replies: raw parsing, and appending them to the document display
+	void benchmarkMarkdown(ChatBenchmarkRunner& runner, bool quick)
+	{
+		const int batch = quick ? 10 : 50;
+		QRandomGenerator random(11);
+		const QFont font;
+
+		int salt = 0;
+		runner.run("Markdown/parse", batch, [&]() {
+			QStringList texts;
+			for (int i = 0; i < batch; ++i) {
+				texts.append(makeMarkdown(random, ++salt));
+			}
+
+			QElapsedTimer timer;
+			timer.start();
+			for (const QString& text : texts) {
+				ChatFragmentCache::parse(text, font);
+			}
+			return timer.nsecsElapsed();
+		});
+
+		const QString appendName = QString("Markdown/AppendChatMessages/document/batch:%1").arg(batch);
+		if (!runner.matches(appendName)) return;
+
+		QScopedPointer<uiChatWidget> widget(makeWidget(uiChatWidget::DocumentView));
+		runner.run(appendName, batch, [&]() {
+			// Start each repetition from a short document
+			widget->SetChatHistory(QList<ChatMessage>());
+			widget->FlushPendingRender();
+
+			QList<ChatMessage> messages;
+			for (int i = 0; i < batch; ++i) {
+				messages.append(ChatMessage(QString(), "Assistant", makeMarkdown(random, ++salt), QString()));
+			}
+
+			QElapsedTimer timer;
+			timer.start();
+			widget->AppendChatMessages(messages);
+			widget->FlushPendingRender();
+			return timer.nsecsElapsed();
+		});
+	}
+
+	//! Synchronous export of a store snapshot in every format (what the export worker runs)
+	void benchmarkExport(ChatBenchmarkRunner& runner, bool quick)
+	{
+		const int count = quick ? 1000 : 20000;
+		const struct { ChatExporter::Format format; const char* name; } formats[] = {
+			{ ChatExporter::PlainText, "text" },
+			{ ChatExporter::Jsonl, "jsonl" },
+			{ ChatExporter::Markdown, "markdown" },
+			{ ChatExporter::Html, "html" }
+		};
+
+		ChatHistoryStore store;
+		bool loaded = false;
+		for (const auto& entry : formats) {
+			const QString name = QString("Export/%1/%2").arg(entry.name).arg(count);
+			if (!runner.matches(name)) continue;
+
+			if (!loaded) {
+				store.assign(makeHistory(count, 4));
+				loaded = true;
+			}
+
+			qint64 bytes = 0;
+			runner.run(name, count, [&]() {
+				QBuffer buffer;
+				buffer.open(QIODevice::WriteOnly);
+
+				QElapsedTimer timer;
+				timer.start();
+				ChatExporter::write(&buffer, store, entry.format);
+				const qint64 elapsed = timer.nsecsElapsed();
+
+				bytes = buffer.size();
+				return elapsed;
+			});
+			runner.setCounter("bytes", bytes);
+			const ChatBenchmarkResult& result = runner.results().last();
+			runner.setCounter("megabytes_per_second", bytes / (result.meanNs * count) * 1e3);
+		}
+	}
+
+	//! ChatSearchIndex over a large history: building the index, then a few queries of each kind (words, prefix, phrase, filters)
+	void benchmarkSearch(ChatBenchmarkRunner& runner, bool quick)
+	{
+		const int count = quick ? 10000 : 100000;
+		const QString buildName = QString("Search/index/%1").arg(count);
+		const QStringList queries = {
+			"latency memory",
+			"perf*",
+			"\"the model\"",
+			"from:Assistant token*",
+			"role:user question"
+		};
+
+		bool any = runner.matches(buildName);
+		for (int i = 0; i < queries.size(); ++i) {
+			any = any || runner.matches(QString("Search/query:%1/%2").arg(i).arg(count));
+		}
+		if (!any) return;
+
+		ChatHistoryStore store;
+		store.assign(makeHistory(count, 5));
+
+		ChatSearchIndex index;
+		runner.run(buildName, count, [&]() {
+			index.clear();
+			QElapsedTimer timer;
+			timer.start();
+			index.appendFrom(store, store.size());
+			return timer.nsecsElapsed();
+		});
+
+		for (int i = 0; i < queries.size(); ++i) {
+			const ChatSearchQuery query = ChatSearchIndex::parseQuery(queries.at(i));
+			int hits = 0;
+			if (runner.run(QString("Search/query:%1/%2").arg(i).arg(count), 1, [&]() {
+				QElapsedTimer timer;
+				timer.start();
+				hits = index.search(query, store).size();
+				return timer.nsecsElapsed();
+			})) {
+				runner.setCounter("query", queries.at(i));
+				runner.setCounter("hits", hits);
+			}
+		}
+	}
+
+	//! Switching among many sessions, with their documents cached and evicted
+	void benchmarkSessions(ChatBenchmarkRunner& runner, bool quick)
+	{
+		const int sessions = quick ? 20 : 200;
+		const int messages = 200;
+		const QString cachedName = QString("SwitchToSession/cached/sessions:%1").arg(sessions);
+		const QString evictedName = QString("SwitchToSession/evicted/sessions:%1").arg(sessions);
+		if (!runner.matches(cachedName) && !runner.matches(evictedName)) return;
+
+		QScopedPointer<uiChatWidget> widget(makeWidget(uiChatWidget::DocumentView));
+		widget->SetSessionCacheSize(4096);
+		QList<int> ids = { widget->GetCurrentSession() };
+		for (int i = 1; i < sessions; ++i) {
+			ids.append(widget->CreateSession(QString("Session %1").arg(i)));
+		}
+		for (int i = 0; i < ids.size(); ++i) {
+			widget->SwitchToSession(ids.at(i));
+			loadHistory(widget.data(), makeHistory(messages, 200 + i));
+		}
+
+		// Time until control returns to the event loop; an evicted session finishes rendering on the worker
+		auto cycle = [&]() {
+			QElapsedTimer timer;
+			timer.start();
+			for (int id : ids) {
+				widget->SwitchToSession(id);
+				widget->FlushPendingRender();
+			}
+			const qint64 elapsed = timer.nsecsElapsed();
+			QCoreApplication::processEvents();
+			return elapsed;
+		};
+
+		if (runner.run(cachedName, sessions, cycle)) {
+			runner.setCounter("cache_bytes", widget->GetSessionCacheUsage());
+		}
+
+		widget->SetSessionCacheSize(0);
+		runner.run(evictedName, sessions, cycle);
+	}
+
+	//! Constructing many widgets, as a dashboard of chat panes does at startup
+	void benchmarkConstruct(ChatBenchmarkRunner& runner, bool quick)
+	{
+		const int count = quick ? 20 : 200;
+		const QString hiddenName = QString("Construct/hidden/%1").arg(count);
+		const QString widgetThemeName = QString("Construct/shown/theme:widget/%1").arg(count);
+		const QString applicationThemeName = QString("Construct/shown/theme:application/%1").arg(count);
+
+		// Construction (and with show, polish, style sheet and first layout) of all panes
+		auto construct = [count](bool show) {
+			QVector<uiChatWidget*> widgets;
+			widgets.reserve(count);
+
+			QElapsedTimer timer;
+			timer.start();
+			for (int i = 0; i < count; ++i) {
+				uiChatWidget* widget = new uiChatWidget(QString("Pane %1").arg(i), QString());
+				if (show) {
+					widget->resize(400, 300);
+					widget->show();
+				}
+				widgets.append(widget);
+			}
+			if (show) {
+				QCoreApplication::processEvents();
+			}
+			const qint64 elapsed = timer.nsecsElapsed();
+
+			qDeleteAll(widgets);
+			return elapsed;
+		};
+
+		runner.run(hiddenName, count, [&]() { return construct(false); });
+		runner.run(widgetThemeName, count, [&]() { return construct(true); });
+
+		if (runner.matches(applicationThemeName)) {
+			const QString applicationStyleSheet = qApp->styleSheet();
+			ChatTheme::installOnApplication();
+			runner.run(applicationThemeName, count, [&]() { return construct(true); });
+			qApp->setStyleSheet(applicationStyleSheet);
+		}
+	}
+
+	//! A long-running pane with a display limit: append cost and memory must stay flat
+	void benchmarkDisplayLimit(ChatBenchmarkRunner& runner, bool quick)
+	{
+		const int limit = 500;
+		const int total = quick ? 4000 : 50000;
+		const int batch = 100;
+
+		// Past the limit and the compressed archive blocks kept in memory, memory should stop growing
+		const int plateau = limit + 2 * ChatCompressedArchive::DefaultMemoryBlocks * ChatCompressedArchive::DefaultBlockRecords;
+
+		QTemporaryDir dir;
+		for (bool file : { false, true }) {
+			const QString name = QString("DisplayLimit/append/limit:%1/total:%2%3").arg(limit).arg(total).arg(file ? "/file" : "");
+			if (!runner.matches(name)) continue;
+
+			QScopedPointer<uiChatWidget> widget(makeWidget(uiChatWidget::DocumentView));
+			if (file) {
+				widget->SetHistoryFile(dir.filePath("limit.log"), limit);
+			}
+			widget->SetDisplayLimit(limit);
+
+			// Past the limit every batch trims the display head and archives as much as it appends
+			QRandomGenerator random(11);
+			int sent = 0;
+			int sentAtLimit = 0;
+			qint64 memoryAtLimit = 0;
+			runner.run(name, total, [&]() {
+				QElapsedTimer timer;
+				qint64 elapsed = 0;
+				for (int done = 0; done < total; done += batch) {
+					QStringList texts;
+					for (int i = 0; i < batch; ++i) {
+						texts.append(QString("%1 ").arg(++sent) + makeText(random, 240));
+					}
+
+					timer.start();
+					for (int i = 0; i < batch; ++i) {
+						widget->AppendChatMessage((i % 2) ? "Assistant" : "You", texts.at(i));
+					}
+					widget->FlushPendingRender();
+					elapsed += timer.nsecsElapsed();
+
+					if (memoryAtLimit == 0 && sent >= plateau) {
+						memoryAtLimit = widget->GetHistoryMemoryUsage();
+						sentAtLimit = sent;
+					}
+				}
+				return elapsed;
+			});
+
+			// Resident messages, archive and indexes: flat memory shows as a growth near zero
+			const qint64 memoryFinal = widget->GetHistoryMemoryUsage();
+			runner.setCounter("history_bytes_at_limit", memoryAtLimit);
+			runner.setCounter("history_bytes_final", memoryFinal);
+			runner.setCounter("history_bytes_growth_per_1k_messages",
+				(sent > sentAtLimit) ? (memoryFinal - memoryAtLimit) * 1000 / (sent - sentAtLimit) : 0);
+			runner.setCounter("messages", sent);
+		}
+	}
+
+	void benchmarkOversizedMessage(ChatBenchmarkRunner& runner, bool quick)
+	{
+		const int length = quick ? 50000 : 500000;
+		QRandomGenerator random(17);
+
+		// A pasted log: many short lines
+		QString log;
+		for (int line = 0; log.size() < length; ++line) {
+			log += QString("2026-06-15 10:%1:%2 INFO ").arg(line / 60 % 60, 2, 10, QChar('0')).arg(line % 60, 2, 10, QChar('0')) + makeText(random, 80) + '\n';
+		}
+
+		for (bool collapse : { true, false }) {
+			const QString name = QString("OversizedMessage/append/%1/chars:%2").arg(collapse ? "collapsed" : "full").arg(log.size());
+			if (!runner.matches(name)) continue;
+
+			QScopedPointer<uiChatWidget> widget(makeWidget(uiChatWidget::DocumentView));
+			widget->SetCollapseThreshold(collapse ? 20000 : 0);
+			int salt = 0;
+			runner.run(name, 1, [&]() {
+				// Distinct text every time, so the fragment cache never hits
+				const QString text = QString::number(++salt) + ' ' + log;
+
+				QElapsedTimer timer;
+				timer.start();
+				widget->AppendChatMessage("You", text);
+				widget->FlushPendingRender();
+				return timer.nsecsElapsed();
+			});
+			runner.setCounter("document_chars", widget->findChild<QTextEdit*>("chatHistory")->document()->characterCount());
+		}
+	}
+
+	//! C++ source of the given number of lines (comments, strings, numbers, keywords)
+	QString makeCode(QRandomGenerator& random, int lines, int salt)
+	{
+		QString code;
+		code += QString("#include <vector>\n// Generated %1\n").arg(salt);
+		for (int line = 2; line < lines; ++line) {
+			const int kind = line % 4;
+			if (kind == 0) {
+				code += QString("static const int value%1 = %2; // %3\n").arg(line).arg(random.bounded(100000)).arg(makeText(random, 20));
+			}
+			else if (kind == 1) {
+				code += QString("for (int i = 0; i < value%1; ++i) { total += i * 0x%2; }\n").arg(line - 1).arg(random.bounded(256), 0, 16);
+			}
+			else if (kind == 2) {
+				code += QString("const char* text%1 = \"%2\";\n").arg(line).arg(makeText(random, 24));
+			}
+			else {
+				code += QString("if (std::vector<double>().empty()) return %1.5f;\n").arg(line);
+			}
+		}
+		return code;
+	}
+
+	void benchmarkCodeHighlight(ChatBenchmarkRunner& runner, bool quick)
+	{
+		const int lines = quick ? 200 : 2000;
+		QRandomGenerator random(13);
+
+		// The worker's share: pure tokenizing
+		const QString tokenizeName = QString("CodeHighlight/tokenize/lines:%1").arg(lines);
+		if (runner.matches(tokenizeName)) {
+			const QString code = makeCode(random, lines, 0);
+			int spans = 0;
+			runner.run(tokenizeName, lines, [&]() {
+				QElapsedTimer timer;
+				timer.start();
+				spans = ChatCodeHighlighter::tokenize(code, "cpp").size();
+				return timer.nsecsElapsed();
+			});
+			runner.setCounter("spans", spans);
+		}
+
+		// The GUI thread's share: a reply with a long code block, appended and rendered (tokenized on the worker)
+		const QString appendName = QString("CodeHighlight/append/lines:%1").arg(lines);
+		if (runner.matches(appendName)) {
+			QScopedPointer<uiChatWidget> widget(makeWidget(uiChatWidget::DocumentView));
+			int salt = 0;
+			runner.run(appendName, lines, [&]() {
+				// New code every time, so neither the fragment cache nor the span cache hits
+				const QString reply = "Here it is:\n\n```cpp\n" + makeCode(random, lines, ++salt) + "```\n";
+
+				QElapsedTimer timer;
+				timer.start();
+				widget->AppendChatMessage("Assistant", reply);
+				widget->FlushPendingRender();
+				return timer.nsecsElapsed();
+			});
+		}
+	}
+
+	void benchmarkBackend(ChatBenchmarkRunner& runner, bool quick)
+	{
+		const int tokens = quick ? 50 : 500;
+		QRandomGenerator random(19);
+
+		QString reply;
+		for (int i = 0; i < tokens; ++i) {
+			reply += QLatin1String(kWords[random.bounded(kWordCount)]) + QLatin1Char(' ');
+		}
+
+		// Send to reply finished over localhost, with no server delays: the client side of streaming,
+		// on its own and rendered into a widget
+		for (bool attached : { false, true }) {
+			const QString name = QString("Backend/%1/tokens:%2").arg(attached ? "widget" : "stream").arg(tokens);
+			if (!runner.matches(name)) continue;
+
+			ChatMockServer server;
+			if (!server.listen()) {
+				QTextStream(stderr) << name << ": the mock server cannot listen on 127.0.0.1" << Qt::endl;
+				continue;
+			}
+			server.setReply([reply](const QJsonArray&) { return reply; });
+
+			ChatBackend backend;
+			backend.setEndpoint(server.url());
+			backend.preconnect();
+
+			QScopedPointer<uiChatWidget> widget;
+			QLineEdit* input = nullptr;
+			QPushButton* send = nullptr;
+			if (attached) {
+				widget.reset(makeWidget(uiChatWidget::DocumentView));
+				backend.attach(widget.data());
+				input = widget->findChild<QLineEdit*>("chatInput");
+				send = widget->findChild<QPushButton*>("chatSend");
+			}
+
+			QEventLoop loop;
+			QObject::connect(&backend, &ChatBackend::replyFinished, &loop, &QEventLoop::quit);
+			QObject::connect(&backend, &ChatBackend::replyFailed, &loop, &QEventLoop::quit);
+
+			qint64 firstTokenMs = 0;
+			int replies = 0;
+			QObject::connect(&backend, &ChatBackend::firstToken, [&](qint64 ms) {
+				firstTokenMs += ms;
+				++replies;
+			});
+
+			const QList<ChatMessage> context{ ChatMessage{ QString(), "You", "Hello", "user" } };
+			runner.run(name, tokens, [&]() {
+				QElapsedTimer timer;
+				timer.start();
+				if (attached) {
+					input->setText("Hello");
+					send->click();
+				}
+				else {
+					backend.send(context);
+				}
+				loop.exec();
+				if (attached) {
+					widget->FlushPendingRender();
+				}
+				return timer.nsecsElapsed();
+			});
+			runner.setCounter("first_token_ms", replies > 0 ? double(firstTokenMs) / replies : 0.0);
+			runner.setCounter("requests", server.requestCount());
+			runner.setCounter("connections", server.connectionCount());
+		}
+	}
+
+	void benchmarkResponseCache(ChatBenchmarkRunner& runner, bool quick)
+	{
+		const int turns = quick ? 20 : 200;
+		const QList<ChatMessage> context = makeHistory(turns, 23);
+		const QString endpoint("http://127.0.0.1:8080/v1/chat/completions");
+
+		// The price of every request once a cache is set: hashing its whole context
+		const QString fingerprintName = QString("ResponseCache/fingerprint/messages:%1").arg(turns);
+		if (runner.matches(fingerprintName)) {
+			int keys = 0;
+			runner.run(fingerprintName, turns, [&]() {
+				QElapsedTimer timer;
+				timer.start();
+				keys += ChatResponseCache::fingerprint(context, "mock", endpoint).size();
+				return timer.nsecsElapsed();
+			});
+		}
+
+		// A hit from each tier; for the disk one a fresh cache on the same directory, so memory never has it
+		QRandomGenerator random(23);
+		const QString reply = makeText(random, 2000);
+		const QByteArray key = ChatResponseCache::fingerprint(context, "mock", endpoint);
+		for (bool disk : { false, true }) {
+			const QString name = QString("ResponseCache/hit/%1").arg(disk ? "disk" : "memory");
+			if (!runner.matches(name)) continue;
+
+			QTemporaryDir dir;
+			ChatResponseCache primed;
+			if (disk && !primed.setDirectory(dir.path())) {
+				QTextStream(stderr) << name << ": cannot create " << dir.path() << Qt::endl;
+				continue;
+			}
+			primed.insert(key, reply, 1500);
+
+			int hits = 0;
+			runner.run(name, 1, [&]() {
+				QElapsedTimer timer;
+				timer.start();
+				QString cached;
+				if (disk) {
+					ChatResponseCache cache;
+					cache.setDirectory(dir.path());
+					hits += cache.lookup(key, &cached) ? 1 : 0;
+				}
+				else {
+					hits += primed.lookup(key, &cached) ? 1 : 0;
+				}
+				return timer.nsecsElapsed();
+			});
+			runner.setCounter("hits", hits);
+		}
+
+		// Send to reply appended in a widget, answered from the cache (no server listens at the endpoint)
+		const QString widgetName = "ResponseCache/widget";
+		if (runner.matches(widgetName)) {
+			ChatResponseCache cache;
+			ChatBackend backend;
+			backend.setEndpoint(QUrl(endpoint));
+			backend.setModel("mock");
+			backend.setResponseCache(&cache);
+
+			QScopedPointer<uiChatWidget> widget(makeWidget(uiChatWidget::DocumentView));
+			backend.attach(widget.data());
+			QLineEdit* input = widget->findChild<QLineEdit*>("chatInput");
+			QPushButton* send = widget->findChild<QPushButton*>("chatSend");
+
+			QEventLoop loop;
+			QObject::connect(&backend, &ChatBackend::replyFinished, &loop, &QEventLoop::quit);
+			QObject::connect(&backend, &ChatBackend::replyFailed, &loop, &QEventLoop::quit);
+
+			// System messages are not part of the context, so the request is just the question
+			cache.insert(ChatResponseCache::fingerprint({ ChatMessage{ QString(), "You", "Hello", "user" } }, "mock", endpoint), reply, 1500);
+
+			runner.run(widgetName, 1, [&]() {
+				// The same question in the same (empty) context every time
+				widget->ClearChatHistory();
+
+				QElapsedTimer timer;
+				timer.start();
+				input->setText("Hello");
+				send->click();
+				loop.exec();
+				widget->FlushPendingRender();
+				return timer.nsecsElapsed();
+			});
+			runner.setCounter("hits", cache.stats().hits);
+			runner.setCounter("misses", cache.stats().misses);
+		}
+	}
+
+	void benchmarkContextJson(ChatBenchmarkRunner& runner, bool quick)
+	{
+		const int contextBytes = quick ? 128 * 1024 : 1024 * 1024;
+		const int messageChars = 16 * 1024;
+		const int count = contextBytes / messageChars;
+
+		const QString jsonName = QString("ContextJson/qjsondocument/bytes:%1").arg(contextBytes);
+		const QString directName = QString("ContextJson/direct/bytes:%1").arg(contextBytes);
+		if (!runner.matches(jsonName) && !runner.matches(directName)) return;
+
+		// Long turns of prose and code: quotes, backslashes, tabs, newlines and some non-ASCII to escape
+		QRandomGenerator random(29);
+		const QDateTime start(QDate(2026, 7, 20), QTime(9, 0));
+		QList<ChatMessage> history;
+		for (int i = 0; i < count; ++i) {
+			QString text;
+			while (text.size() < messageChars) {
+				text += makeText(random, 100) + QString(" \"caf%1\"\tpath\\to\\file\n").arg(QChar(0xe9));
+			}
+			history.append(ChatMessage(start.addSecs(i * 7).toString(ChatHistoryStore::TimestampFormat),
+				(i % 2) ? "Assistant" : "You", text, (i % 2) ? "assistant" : "user"));
+		}
+
+		// The list view renders only visible rows, so the history loads quickly
+		QScopedPointer<uiChatWidget> widget(makeWidget(uiChatWidget::ListView));
+		loadHistory(widget.data(), history);
+
+		// The route requests took before: copied messages, a QJsonArray, then a QJsonDocument
+		QByteArray json;
+		const bool jsonRan = runner.run(jsonName, count, [&]() {
+			QElapsedTimer timer;
+			timer.start();
+			QJsonArray messages;
+			for (const ChatMessage& message : widget->BuildContextMessages(count)) {
+				messages.append(QJsonObject{ { "role", message.role }, { "content", message.message } });
+			}
+			json = QJsonDocument(messages).toJson(QJsonDocument::Compact);
+			return timer.nsecsElapsed();
+		});
+		if (jsonRan) {
+			runner.setCounter("json_bytes", json.size());
+		}
+
+		// Straight from the history store into a reused buffer
+		QByteArray buffer;
+		buffer.reserve(2 * contextBytes);
+		const bool directRan = runner.run(directName, count, [&]() {
+			QElapsedTimer timer;
+			timer.start();
+			buffer.resize(0);
+			widget->WriteContextJson(buffer, count);
+			return timer.nsecsElapsed();
+		});
+		if (directRan) {
+			runner.setCounter("json_bytes", buffer.size());
+		}
+
+		// Both must say the same (object keys may come in another order, so the parsed arrays are compared)
+		if (jsonRan && directRan) {
+			const bool same = QJsonDocument::fromJson(buffer).array() == QJsonDocument::fromJson(json).array();
+			runner.setCounter("same_as_qjsondocument", same);
+			if (!same) {
+				QTextStream(stderr) << directName << ": the output differs from the QJsonDocument one" << Qt::endl;
+			}
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	// Headless unless told otherwise
+	if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
+
+	QApplication app(argc, argv);
+	QCoreApplication::setApplicationName("qtChatWidgetBenchmarks");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Benchmarks of the qtChatWidget hot paths");
+	parser.addHelpOption();
+	QCommandLineOption quickOption("quick", "Small sizes and a single repetition (smoke test).");
+	QCommandLineOption filterOption("filter", "Only run benchmarks matching <regex>.", "regex");
+	QCommandLineOption minTimeOption("min-time", "Minimum measured time per benchmark, in seconds.", "seconds", "0.5");
+	QCommandLineOption outOption("out", "Write JSON results to <file> (\"-\" for stdout).", "file");
+	parser.addOptions({ quickOption, filterOption, minTimeOption, outOption });
+	parser.process(app);
+
+	const bool quick = parser.isSet(quickOption);
+	ChatBenchmarkRunner runner(quick ? 0.0 : parser.value(minTimeOption).toDouble(), quick ? 1 : 3);
+	runner.setFilter(parser.value(filterOption));
+
+	runner.setContext("date", QDateTime::currentDateTime().toString(Qt::ISODate));
+	runner.setContext("host_name", QSysInfo::machineHostName());
+	runner.setContext("executable", QCoreApplication::applicationFilePath());
+	runner.setContext("num_cpus", QThread::idealThreadCount());
+	runner.setContext("os", QSysInfo::prettyProductName());
+	runner.setContext("qt_version", QString(qVersion()));
+	runner.setContext("qpa_platform", QGuiApplication::platformName());
+#ifdef QT_DEBUG
+	runner.setContext("library_build_type", "debug");
+#else
+	runner.setContext("library_build_type", "release");
+#endif
+	runner.setContext("quick", quick);
+
+	benchmarkHistoryStore(runner, quick);
+	benchmarkAppend(runner, quick, uiChatWidget::DocumentView);
+	benchmarkAppend(runner, quick, uiChatWidget::ListView);
+	benchmarkAppend(runner, quick, uiChatWidget::DocumentView, true);
+	benchmarkSetHistory(runner, quick);
+	benchmarkListLayout(runner, quick);
+	benchmarkContext(runner, quick);
+	benchmarkMarkdown(runner, quick);
+	benchmarkExport(runner, quick);
+	benchmarkSearch(runner, quick);
+	benchmarkSessions(runner, quick);
+	benchmarkConstruct(runner, quick);
+	benchmarkDisplayLimit(runner, quick);
+	benchmarkCodeHighlight(runner, quick);
+	benchmarkOversizedMessage(runner, quick);
+	benchmarkBackend(runner, quick);
+	benchmarkResponseCache(runner, quick);
+	benchmarkContextJson(runner, quick);
+
+	if (parser.isSet(outOption)) {
+		QString error;
+		if (!runner.writeJson(parser.value(outOption), &error)) {
+			QTextStream(stderr) << "Cannot write " << parser.value(outOption) << ": " << error << Qt::endl;
+			return 1;
+		}
+	}
+	return 0;
+}
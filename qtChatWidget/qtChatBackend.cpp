@@ -0,0 +1,475 @@
+/**
+ * File: qtChatBackend.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 29/06/2026| Tian-Qing Ye   | Created: OpenAI-compatible backend with SSE streaming
+ * 13/07/2026| Tian-Qing Ye   | Optional response cache: repeated requests answered without a round trip
+ * 20/07/2026| Tian-Qing Ye   | Request bodies written straight into a reused buffer, without QJson*
+ */
+#include "qtChatBackend.h"
+#include "qtChatResponseCache.h"
+#include "qtChatJsonWriter.h"
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace
+{
+	//! Content of the first choice of a completion ("message") or of a stream chunk ("delta")
+	QString choiceText(const QJsonObject& object, const QString& member)
+	{
+		const QJsonArray choices = object.value("choices").toArray();
+		if (choices.isEmpty()) return QString();
+		return choices.first().toObject().value(member).toObject().value("content").toString();
+	}
+
+	//! Message of an error reply ({"error": {"message": ...}}), else the start of the body
+	QString errorMessage(const QByteArray& body)
+	{
+		const QJsonValue error = QJsonDocument::fromJson(body).object().value("error");
+		if (error.isObject()) return error.toObject().value("message").toString();
+		if (error.isString()) return error.toString();
+		return QString::fromUtf8(body.left(200)).trimmed();
+	}
+
+	//! Initial capacity of the request buffer; it grows to the largest request and stays
+	const int kRequestBufferSize = 64 * 1024;
+}
+
+QVector<ChatSseParser::Event> ChatSseParser::feed(const QByteArray& bytes)
+{
+	QVector<Event> events;
+	_pending += bytes;
+
+	// Complete lines only; the rest waits for the next piece
+	int start = 0;
+	for (int end = _pending.indexOf('\n'); end >= 0; end = _pending.indexOf('\n', start)) {
+		int lineEnd = end;
+		if (lineEnd > start && _pending.at(lineEnd - 1) == '\r') {
+			--lineEnd;
+		}
+		const QByteArray line = _pending.mid(start, lineEnd - start);
+		start = end + 1;
+
+		// A blank line dispatches the event
+		if (line.isEmpty()) {
+			if (_hasData) {
+				events.append({ _name, _data });
+			}
+			_name.clear();
+			_data.clear();
+			_hasData = false;
+			continue;
+		}
+
+		// Comment (servers send these to keep the connection alive)
+		if (line.startsWith(':')) continue;
+
+		const int colon = line.indexOf(':');
+		const QByteArray field = (colon < 0) ? line : line.left(colon);
+		QByteArray value = (colon < 0) ? QByteArray() : line.mid(colon + 1);
+		if (value.startsWith(' ')) {
+			value.remove(0, 1);
+		}
+
+		if (field == "data") {
+			if (_hasData) {
+				_data += '\n';
+			}
+			_data += value;
+			_hasData = true;
+		}
+		else if (field == "event") {
+			_name = value;
+		}
+		// "id" and "retry" only matter for reconnecting, which a request never does
+	}
+
+	_pending.remove(0, start);
+	return events;
+}
+
+void ChatSseParser::reset()
+{
+	_pending.clear();
+	_name.clear();
+	_data.clear();
+	_hasData = false;
+}
+
+ChatBackend::ChatBackend(QObject* parent)
+	: QObject(parent)
+	, _manager(new QNetworkAccessManager(this))
+	, _streaming(true)
+	, _timeoutMs(DefaultTimeoutMs)
+	, _cancelling(false)
+	, _done(false)
+	, _firstTokenPending(false)
+	, _cache(nullptr)
+	, _cacheHitPending(false)
+	, _fromCache(false)
+	, _widgetStreaming(false)
+{
+	// Reserved, so that resize(0) keeps the capacity
+	_requestBuffer.reserve(kRequestBufferSize);
+}
+
+ChatBackend::~ChatBackend()
+{
+	// No signals from a backend being destroyed
+	if (_reply) {
+		_reply->disconnect(this);
+		_reply->abort();
+	}
+}
+
+void ChatBackend::setEndpoint(const QUrl& url)
+{
+	_endpoint = url;
+}
+
+void ChatBackend::setApiKey(const QString& apiKey)
+{
+	_apiKey = apiKey;
+}
+
+void ChatBackend::setModel(const QString& model)
+{
+	_model = model;
+}
+
+void ChatBackend::setStreaming(bool streaming)
+{
+	_streaming = streaming;
+}
+
+void ChatBackend::setTimeout(int ms)
+{
+	_timeoutMs = qMax(0, ms);
+}
+
+void ChatBackend::preconnect()
+{
+	if (!_endpoint.isValid()) return;
+
+#ifndef QT_NO_SSL
+	if (_endpoint.scheme() == "https") {
+		_manager->connectToHostEncrypted(_endpoint.host(), quint16(_endpoint.port(443)));
+		return;
+	}
+#endif
+	_manager->connectToHost(_endpoint.host(), quint16(_endpoint.port(80)));
+}
+
+void ChatBackend::setResponseCache(ChatResponseCache* cache)
+{
+	_cache = cache;
+}
+
+void ChatBackend::beginRequestBody(QByteArray& out) const
+{
+	// The messages go last, so that they can be written straight after this
+	out.append(_streaming ? "{\"stream\":true" : "{\"stream\":false");
+	if (!_model.isEmpty()) {
+		out.append(",\"model\":");
+		ChatJsonWriter::appendString(out, _model);
+	}
+	out.append(",\"messages\":");
+}
+
+QByteArray ChatBackend::requestBody(const QList<ChatMessage>& messages) const
+{
+	QByteArray body;
+	beginRequestBody(body);
+	ChatJsonWriter::appendMessages(body, messages);
+	body.append('}');
+	return body;
+}
+
+bool ChatBackend::send(const QList<ChatMessage>& messages)
+{
+	if (isBusy() || !_endpoint.isValid()) return false;
+
+	_requestBuffer.resize(0);
+	beginRequestBody(_requestBuffer);
+	const int messagesStart = _requestBuffer.size();
+	ChatJsonWriter::appendMessages(_requestBuffer, messages);
+	return sendRequestBuffer(messagesStart);
+}
+
+bool ChatBackend::sendContext(const uiChatWidget* widget, int maxMessages)
+{
+	if (!widget || isBusy() || !_endpoint.isValid()) return false;
+
+	_requestBuffer.resize(0);
+	beginRequestBody(_requestBuffer);
+	const int messagesStart = _requestBuffer.size();
+	widget->WriteContextJson(_requestBuffer, maxMessages);
+	return sendRequestBuffer(messagesStart);
+}
+
+bool ChatBackend::sendRequestBuffer(int messagesStart)
+{
+	const int messagesEnd = _requestBuffer.size();
+	_requestBuffer.append('}');
+
+	_parser.reset();
+	_text.clear();
+	_body.clear();
+	_streamError.clear();
+	_cancelling = false;
+	_done = false;
+	_firstTokenPending = true;
+	_cacheKey.clear();
+	_fromCache = false;
+	_clock.start();
+
+	// The same conversation answered before: no round trip
+	if (_cache) {
+		// Hashed in place
+		const QByteArray messagesJson = QByteArray::fromRawData(_requestBuffer.constData() + messagesStart, messagesEnd - messagesStart);
+		const QByteArray key = ChatResponseCache::fingerprint(messagesJson, _model, _endpoint.toString());
+		if (_cache->lookup(key, &_text)) {
+			// Delivered from the event loop, like any reply: never from inside send()
+			_cacheHitPending = true;
+			_fromCache = true;
+			QMetaObject::invokeMethod(this, [this]() { deliverCachedReply(); }, Qt::QueuedConnection);
+			return true;
+		}
+		_cacheKey = key;
+	}
+
+	QNetworkRequest request(_endpoint);
+	request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+	request.setRawHeader("Accept", _streaming ? "text/event-stream" : "application/json");
+	if (!_apiKey.isEmpty()) {
+		request.setRawHeader("Authorization", "Bearer " + _apiKey.toUtf8());
+	}
+
+	// Aborted when the server stays silent this long (also between two tokens)
+	request.setTransferTimeout(_timeoutMs);
+
+	// Over TLS, HTTP/2 lets requests share one connection
+	if (_endpoint.scheme() == "https") {
+		request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+	}
+
+	_reply = _manager->post(request, _requestBuffer);
+	connect(_reply, &QNetworkReply::readyRead, this, &ChatBackend::onReadyRead);
+	connect(_reply, &QNetworkReply::finished, this, &ChatBackend::onReplyFinished);
+	return true;
+}
+
+void ChatBackend::cancel()
+{
+	// A cached reply not delivered yet is simply dropped
+	if (_cacheHitPending) {
+		_cacheHitPending = false;
+		emit replyCancelled();
+		return;
+	}
+	if (!_reply) return;
+
+	// finished() follows synchronously
+	_cancelling = true;
+	_reply->abort();
+}
+
+void ChatBackend::onReadyRead()
+{
+	if (_reply) {
+		readAvailable(_reply);
+	}
+}
+
+void ChatBackend::readAvailable(QNetworkReply* reply)
+{
+	const QByteArray bytes = reply->readAll();
+	if (bytes.isEmpty()) return;
+
+	// Error replies, and servers answering with a whole completion, are read to the end first
+	const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+	const bool eventStream = reply->header(QNetworkRequest::ContentTypeHeader).toString().startsWith("text/event-stream");
+	if (status >= 400 || !eventStream) {
+		_body += bytes;
+		return;
+	}
+
+	if (_done) return;
+	for (const ChatSseParser::Event& event : _parser.feed(bytes)) {
+		if (!handleEvent(event.data)) {
+			break;
+		}
+	}
+}
+
+bool ChatBackend::handleEvent(const QByteArray& data)
+{
+	if (data == "[DONE]") {
+		_done = true;
+		return false;
+	}
+
+	const QJsonObject chunk = QJsonDocument::fromJson(data).object();
+	if (chunk.contains("error")) {
+		_streamError = errorMessage(data);
+		_done = true;
+		return false;
+	}
+
+	const QString text = choiceText(chunk, "delta");
+	if (!text.isEmpty()) {
+		deliverText(text);
+	}
+	return true;
+}
+
+void ChatBackend::deliverText(const QString& text)
+{
+	if (_firstTokenPending) {
+		_firstTokenPending = false;
+		emit firstToken(_clock.elapsed());
+	}
+	_text += text;
+	emit replyChunk(text);
+}
+
+void ChatBackend::deliverCachedReply()
+{
+	// Cancelled meanwhile
+	if (!_cacheHitPending) return;
+
+	_cacheHitPending = false;
+	_firstTokenPending = false;
+	emit firstToken(_clock.elapsed());
+	emit replyFinished(_text);
+}
+
+void ChatBackend::onReplyFinished()
+{
+	QNetworkReply* reply = _reply;
+	if (!reply) return;
+
+	// Idle from here on: handlers of the signals below may send the next request
+	readAvailable(reply);
+	_reply.clear();
+	reply->deleteLater();
+
+	const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+	const QNetworkReply::NetworkError error = reply->error();
+
+	if (_cancelling) {
+		emit replyCancelled();
+		return;
+	}
+	if (error == QNetworkReply::OperationCanceledError || error == QNetworkReply::TimeoutError) {
+		// Not cancel(): the transfer timeout aborted it
+		emit replyFailed(QString("No response from the server for %1 s").arg(_timeoutMs / 1000.0));
+		return;
+	}
+	if (status >= 400) {
+		const QString message = errorMessage(_body);
+		emit replyFailed(QString("HTTP %1: %2").arg(status).arg(message.isEmpty() ? reply->errorString() : message));
+		return;
+	}
+	if (error != QNetworkReply::NoError) {
+		emit replyFailed(reply->errorString());
+		return;
+	}
+	if (!_streamError.isEmpty()) {
+		emit replyFailed(_streamError);
+		return;
+	}
+
+	// A whole completion (not streamed, or the server ignored "stream")
+	if (!_body.isEmpty()) {
+		const QString text = choiceText(QJsonDocument::fromJson(_body).object(), "message");
+		if (_firstTokenPending) {
+			_firstTokenPending = false;
+			emit firstToken(_clock.elapsed());
+		}
+		_text = text;
+	}
+
+	// Only complete, successful replies are worth serving again
+	if (_cache && !_cacheKey.isEmpty() && !_text.isEmpty()) {
+		_cache->insert(_cacheKey, _text, _clock.elapsed());
+	}
+	emit replyFinished(_text);
+}
+
+void ChatBackend::attach(uiChatWidget* widget)
+{
+	for (const QMetaObject::Connection& connection : _widgetConnections) {
+		disconnect(connection);
+	}
+	_widgetConnections.clear();
+	_widget = widget;
+	_widgetStreaming = false;
+	if (!widget) return;
+
+	_widgetConnections
+		<< connect(widget, &uiChatWidget::messageSent, this, &ChatBackend::onWidgetMessageSent)
+		<< connect(this, &ChatBackend::replyChunk, this, &ChatBackend::onWidgetText)
+		<< connect(this, &ChatBackend::replyFinished, this, &ChatBackend::onWidgetFinished)
+		<< connect(this, &ChatBackend::replyFailed, this, [this](const QString& errorString) {
+			onWidgetDone(QString("Request failed: %1").arg(errorString));
+		})
+		<< connect(this, &ChatBackend::replyCancelled, this, [this]() {
+			onWidgetDone("Request cancelled");
+		});
+}
+
+void ChatBackend::onWidgetMessageSent()
+{
+	// The input is disabled while a request runs
+	if (!_widget || isBusy()) return;
+
+	_widget->SetInputEnabled(false);
+	_widget->ShowProgressIndicator();
+	if (!sendContext(_widget)) {
+		onWidgetDone("Request failed: no endpoint set");
+	}
+}
+
+void ChatBackend::onWidgetText(const QString& text)
+{
+	if (!_widget) return;
+
+	if (!_widgetStreaming) {
+		_widget->BeginStreamingMessage("Assistant");
+		_widgetStreaming = true;
+	}
+	_widget->AppendStreamingChunk(text);
+}
+
+void ChatBackend::onWidgetFinished(const QString& text)
+{
+	if (!_widget) return;
+
+	// A reply that was not streamed arrives whole
+	if (!_widgetStreaming && !text.isEmpty()) {
+		_widget->AppendChatMessage("Assistant", text);
+	}
+	onWidgetDone(QString());
+}
+
+void ChatBackend::onWidgetDone(const QString& systemNote)
+{
+	if (!_widget) return;
+
+	if (_widgetStreaming) {
+		_widget->FinishStreamingMessage();
+		_widgetStreaming = false;
+	}
+	if (!systemNote.isEmpty()) {
+		_widget->AppendChatMessage("System", systemNote);
+	}
+	_widget->HideProgressIndicator();
+	_widget->SetInputEnabled(true);
+}
@@ -0,0 +1,255 @@
+/**
+ * File: qtChatBackend.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 29/06/2026| Tian-Qing Ye  | Created: OpenAI-compatible backend with SSE streaming
+ * 13/07/2026| Tian-Qing Ye  | Optional response cache: repeated requests answered without a round trip
+ * 20/07/2026| Tian-Qing Ye  | Request bodies written straight into a reused buffer, without QJson*
+ */
+#ifndef QT_CHATBACKEND_H
+#define QT_CHATBACKEND_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QUrl>
+#include <QVector>
+#include <QPointer>
+#include <QElapsedTimer>
+#include "qtChatWidget.h"
+
+// Forward declarations
+class QNetworkAccessManager;
+class QNetworkReply;
+class ChatResponseCache;
+
+/**
+ * \brief Incremental parser of a server-sent event stream (text/event-stream)
+ *
+ * Bytes are fed as they arrive, in pieces of any size; every event completed
+ * by a piece is returned at once. Lines may end in "\n" or "\r\n".
+ */
+class ChatSseParser
+{
+public:
+	//! One dispatched event
+	struct Event
+	{
+		QByteArray name;	// "event:" field (empty: "message")
+		QByteArray data;	// "data:" lines, joined with '\n'
+	};
+
+	//! Parse more of the stream; returns the events it completed
+	QVector<Event> feed(const QByteArray& bytes);
+
+	//! Forget any partial line or event (a new stream starts)
+	void reset();
+
+private:
+	//! Bytes of a line not terminated yet
+	QByteArray _pending;
+
+	//! Fields of the event being read
+	QByteArray _name;
+	QByteArray _data;
+	bool _hasData = false;
+};
+
+/**
+ * \brief Sends the conversation to an OpenAI-compatible chat completions endpoint
+ *
+ * One request runs at a time. The reply is streamed (server-sent events) by
+ * default: tokens are parsed as the bytes arrive and handed on at once. All
+ * requests go through one QNetworkAccessManager, which keeps connections to
+ * the endpoint alive between requests; preconnect() opens one ahead of the
+ * first request.
+ *
+ * The backend can be used on its own through send() and the signals, or be
+ * attached to a uiChatWidget: every message the user sends is then answered
+ * with the widget's context as the request (written by WriteContextJson(),
+ * the messages of BuildContextMessages()), and the reply is streamed into
+ * the widget with the progress indicator showing and the input disabled (in
+ * a queued mode, see uiChatWidget::SetQueueMode(), the widget holds what the
+ * user sends meanwhile and sends it once the reply is in).
+ */
+class ChatBackend : public QObject
+{
+	Q_OBJECT
+
+public:
+	//! Default timeout: longest silence of the server, in ms
+	static const int DefaultTimeoutMs = 60000;
+
+	explicit ChatBackend(QObject* parent = nullptr);
+	~ChatBackend();
+
+	//! Endpoint URL, e.g. "https://api.openai.com/v1/chat/completions"
+	void setEndpoint(const QUrl& url);
+	QUrl endpoint() const { return _endpoint; }
+
+	//! API key sent as a bearer token (empty: no Authorization header)
+	void setApiKey(const QString& apiKey);
+
+	//! Model name of the requests
+	void setModel(const QString& model);
+	QString model() const { return _model; }
+
+	//! Stream replies as server-sent events (default), or receive them whole
+	void setStreaming(bool streaming);
+
+	//! Abort a request when the server sends nothing for this long, in ms (0: never)
+	void setTimeout(int ms);
+
+	//! Open the connection to the endpoint now, so the first request does not pay for it
+	void preconnect();
+
+	/**
+	 * \brief Answer repeated requests from a cache (opt-in)
+	 * \param cache The cache, not owned (nullptr: every request goes to the server)
+	 *
+	 * A request whose conversation, model and endpoint were answered before is
+	 * not sent: the cached reply is delivered whole, from the event loop, as
+	 * firstToken() and replyFinished() (no replyChunk()). Replies that finish
+	 * successfully are stored.
+	 */
+	void setResponseCache(ChatResponseCache* cache);
+	ChatResponseCache* responseCache() const { return _cache; }
+
+	//! Returns true if the last reply came from the response cache
+	bool isReplyFromCache() const { return _fromCache; }
+
+	/**
+	 * \brief Start a request
+	 * \param messages The conversation, e.g. uiChatWidget::BuildContextMessages()
+	 * \return false if a request is already running or no endpoint is set
+	 */
+	bool send(const QList<ChatMessage>& messages);
+
+	/**
+	 * \brief Start a request with the context of a widget
+	 * \param widget The widget
+	 * \param maxMessages As for uiChatWidget::BuildContextMessages()
+	 * \return false if a request is already running or no endpoint is set
+	 *
+	 * The context is written straight into the request body (see
+	 * uiChatWidget::WriteContextJson()): no message is copied on the way.
+	 */
+	bool sendContext(const uiChatWidget* widget, int maxMessages = -1);
+
+	//! Abort the running request; replyCancelled() follows
+	void cancel();
+
+	//! Returns true while a request runs (or a cached reply is about to be delivered)
+	bool isBusy() const { return !_reply.isNull() || _cacheHitPending; }
+
+	/**
+	 * \brief Answer the messages a widget sends
+	 * \param widget The widget (nullptr: detach)
+	 *
+	 * Replies are streamed into the widget, failures are shown as System
+	 * messages. One widget at a time.
+	 */
+	void attach(uiChatWidget* widget);
+
+	//! Request body sent for a conversation (OpenAI chat format)
+	QByteArray requestBody(const QList<ChatMessage>& messages) const;
+
+signals:
+	//! Emitted when the first reply text arrives, with the time since send() in ms
+	void firstToken(qint64 ms);
+
+	//! Emitted for each piece of reply text as it arrives (streaming only)
+	void replyChunk(const QString& text);
+
+	//! Emitted when the reply is complete, with its whole text
+	void replyFinished(const QString& text);
+
+	//! Emitted when the request failed (network, HTTP or timeout)
+	void replyFailed(const QString& errorString);
+
+	//! Emitted when cancel() stopped the request
+	void replyCancelled();
+
+private:
+	Q_DISABLE_COPY(ChatBackend)
+
+	//! Bytes arrived on the running reply
+	void onReadyRead();
+
+	//! The running reply finished (successfully or not)
+	void onReplyFinished();
+
+	//! Take the bytes a reply has received: stream events are parsed, anything else is kept whole
+	void readAvailable(QNetworkReply* reply);
+
+	//! Handle the payload of one server-sent event; false once the stream is done
+	bool handleEvent(const QByteArray& data);
+
+	//! Hand on reply text (the first piece also stops the first-token clock)
+	void deliverText(const QString& text);
+
+	//! Deliver the reply a send() found in the response cache
+	void deliverCachedReply();
+
+	//! Write the members of a request body that come before the messages array
+	void beginRequestBody(QByteArray& out) const;
+
+	//! Send the request body in _requestBuffer, whose messages array starts at messagesStart
+	bool sendRequestBuffer(int messagesStart);
+
+	//! Widget glue (attached mode)
+	void onWidgetMessageSent();
+	void onWidgetText(const QString& text);
+	void onWidgetFinished(const QString& text);
+	void onWidgetDone(const QString& systemNote);
+
+	QNetworkAccessManager* _manager;
+	QUrl _endpoint;
+	QString _apiKey;
+	QString _model;
+	bool _streaming;
+	int _timeoutMs;
+
+	//! The running request (null when idle)
+	QPointer<QNetworkReply> _reply;
+
+	//! Body of the last request, reused from request to request
+	QByteArray _requestBuffer;
+	ChatSseParser _parser;
+
+	//! Text of the running reply so far
+	QString _text;
+
+	//! Body of a reply that is not an event stream (an error or a whole completion)
+	QByteArray _body;
+
+	//! Error reported inside the stream
+	QString _streamError;
+
+	//! The running request is being cancelled (as opposed to timing out)
+	bool _cancelling;
+
+	//! The stream announced its end ("data: [DONE]")
+	bool _done;
+
+	//! Time since send(), and whether firstToken() is still to come
+	QElapsedTimer _clock;
+	bool _firstTokenPending;
+
+	//! Response cache (not owned), fingerprint of the running request (empty: not to be stored)
+	ChatResponseCache* _cache;
+	QByteArray _cacheKey;
+
+	//! A cached reply waits for delivery / the last reply came from the cache
+	bool _cacheHitPending;
+	bool _fromCache;
+
+	//! Attached widget, and whether its streamed reply has been begun
+	QPointer<uiChatWidget> _widget;
+	bool _widgetStreaming;
+	QList<QMetaObject::Connection> _widgetConnections;
+};
+
+#endif // QT_CHATBACKEND_H
@@ -0,0 +1,356 @@
+/**
+ * File: qtChatCodeHighlighter.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 08/06/2026| Tian-Qing Ye   | Created: tokenizer for syntax highlighting of fenced code blocks
+ */
+#include "qtChatCodeHighlighter.h"
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QColor>
+
+namespace
+{
+	//! Lexical rules of one language
+	struct LanguageRules
+	{
+		QSet<QString> keywords;
+		QSet<QString> types;
+		QString lineComment;		// e.g. "//", "#", "--" (empty: none)
+		QString blockOpen;			// e.g. "/*" (empty: none)
+		QString blockClose;
+		QString quotes;				// String delimiters; '`' strings may span lines
+		bool preprocessor = false;	// '#' starts a directive at the beginning of a line
+		bool tripleQuotes = false;	// """ / ''' strings spanning lines
+		bool caseInsensitive = false;
+	};
+
+	QSet<QString> words(const char* list)
+	{
+		const QStringList split = QString::fromLatin1(list).split(' ', Qt::SkipEmptyParts);
+		return QSet<QString>(split.begin(), split.end());
+	}
+
+	LanguageRules cFamily(const char* keywords, const char* types, bool preprocessor)
+	{
+		LanguageRules rules;
+		rules.keywords = words(keywords);
+		rules.types = words(types);
+		rules.lineComment = QStringLiteral("//");
+		rules.blockOpen = QStringLiteral("/*");
+		rules.blockClose = QStringLiteral("*/");
+		rules.quotes = QStringLiteral("\"'");
+		rules.preprocessor = preprocessor;
+		return rules;
+	}
+
+	//! Rules by language name; built once, read-only (and so shared by worker threads) afterwards
+	const QHash<QString, LanguageRules>& languages()
+	{
+		static const QHash<QString, LanguageRules> table = [] {
+			QHash<QString, LanguageRules> table;
+
+			const char* cKeywords =
+				"break case const continue default do else enum extern for goto if inline register "
+				"restrict return sizeof static struct switch typedef union volatile while";
+			const char* cTypes =
+				"auto char double float int long short signed unsigned void size_t ptrdiff_t "
+				"int8_t int16_t int32_t int64_t uint8_t uint16_t uint32_t uint64_t FILE";
+			table.insert(QStringLiteral("c"), cFamily(cKeywords, cTypes, true));
+
+			LanguageRules cpp = cFamily(cKeywords, cTypes, true);
+			cpp.keywords.unite(words(
+				"alignas alignof and catch class co_await co_return co_yield concept constexpr consteval "
+				"const_cast decltype delete dynamic_cast explicit export false final friend mutable "
+				"namespace new noexcept not nullptr operator or override private protected public "
+				"reinterpret_cast requires static_assert static_cast template this thread_local throw "
+				"true try typeid typename using virtual"));
+			cpp.types.unite(words("bool wchar_t char8_t char16_t char32_t"));
+			table.insert(QStringLiteral("cpp"), cpp);
+
+			LanguageRules csharp = cFamily(
+				"abstract as base break case catch checked class const continue default delegate do "
+				"else enum event explicit extern false finally fixed for foreach goto if implicit in "
+				"interface internal is lock namespace new null operator out override params private "
+				"protected public readonly ref return sealed sizeof stackalloc static struct switch "
+				"this throw true try typeof unchecked unsafe using var virtual volatile while async "
+				"await get set yield",
+				"bool byte char decimal double float int long object sbyte short string uint ulong "
+				"ushort void dynamic",
+				true);
+			csharp.quotes = QStringLiteral("\"'");
+			table.insert(QStringLiteral("csharp"), csharp);
+
+			table.insert(QStringLiteral("java"), cFamily(
+				"abstract assert break case catch class const continue default do else enum extends "
+				"false final finally for goto if implements import instanceof interface native new "
+				"null package private protected public return static strictfp super switch "
+				"synchronized this throw throws transient true try var volatile while record yield",
+				"boolean byte char double float int long short void String Object", false));
+
+			LanguageRules kotlin = cFamily(
+				"as break class continue do else false for fun if in interface is null object package "
+				"return super this throw true try typealias typeof val var when while by catch "
+				"constructor companion data enum finally import init internal lateinit open override "
+				"private protected public sealed suspend",
+				"Any Boolean Byte Char Double Float Int Long Nothing Short String Unit", false);
+			kotlin.tripleQuotes = true;
+			table.insert(QStringLiteral("kotlin"), kotlin);
+
+			const char* jsKeywords =
+				"async await break case catch class const continue debugger default delete do else "
+				"export extends false finally for from function if import in instanceof let new null "
+				"of return static super switch this throw true try typeof undefined var void while "
+				"with yield";
+			LanguageRules js = cFamily(jsKeywords, "", false);
+			js.quotes = QStringLiteral("\"'`");
+			table.insert(QStringLiteral("javascript"), js);
+
+			LanguageRules ts = js;
+			ts.keywords.unite(words(
+				"abstract as declare enum implements interface keyof namespace private protected "
+				"public readonly type"));
+			ts.types = words("any boolean never number object string symbol unknown bigint");
+			table.insert(QStringLiteral("typescript"), ts);
+
+			LanguageRules rust = cFamily(
+				"as async await break const continue crate dyn else enum extern false fn for if impl "
+				"in let loop match mod move mut pub ref return self Self static struct super trait "
+				"true type unsafe use where while",
+				"bool char f32 f64 i8 i16 i32 i64 i128 isize str u8 u16 u32 u64 u128 usize String "
+				"Vec Option Result Box",
+				false);
+			rust.quotes = QStringLiteral("\"");		// ' also starts lifetimes
+			table.insert(QStringLiteral("rust"), rust);
+
+			LanguageRules go = cFamily(
+				"break case chan const continue default defer else fallthrough for func go goto if "
+				"import interface map package range return select struct switch type var true false "
+				"nil iota",
+				"bool byte complex64 complex128 error float32 float64 int int8 int16 int32 int64 "
+				"rune string uint uint8 uint16 uint32 uint64 uintptr",
+				false);
+			go.quotes = QStringLiteral("\"'`");
+			table.insert(QStringLiteral("go"), go);
+
+			LanguageRules python;
+			python.keywords = words(
+				"False None True and as assert async await break class continue def del elif else "
+				"except finally for from global if import in is lambda nonlocal not or pass raise "
+				"return try while with yield match case self");
+			python.types = words("bool bytes dict float int list object set str tuple");
+			python.lineComment = QStringLiteral("#");
+			python.quotes = QStringLiteral("\"'");
+			python.tripleQuotes = true;
+			table.insert(QStringLiteral("python"), python);
+
+			LanguageRules bash;
+			bash.keywords = words(
+				"if then else elif fi case esac for select while until do done in function time "
+				"return exit break continue local export readonly declare unset shift source echo");
+			bash.lineComment = QStringLiteral("#");
+			bash.quotes = QStringLiteral("\"'");
+			table.insert(QStringLiteral("bash"), bash);
+
+			LanguageRules sql;
+			sql.keywords = words(
+				"select from where and or not insert into values update set delete create table "
+				"drop alter add index view join inner left right outer full on as group by order "
+				"having limit offset union all distinct case when then else end null is in like "
+				"between exists primary key foreign references default begin commit rollback with");
+			sql.types = words("int integer bigint smallint text varchar char boolean real float double decimal numeric date timestamp blob");
+			sql.lineComment = QStringLiteral("--");
+			sql.blockOpen = QStringLiteral("/*");
+			sql.blockClose = QStringLiteral("*/");
+			sql.quotes = QStringLiteral("'");
+			sql.caseInsensitive = true;
+			table.insert(QStringLiteral("sql"), sql);
+
+			LanguageRules json;
+			json.keywords = words("true false null");
+			json.quotes = QStringLiteral("\"");
+			table.insert(QStringLiteral("json"), json);
+
+			return table;
+		}();
+		return table;
+	}
+
+	//! Rules for a fence info string ("C++", "py title=x", ...), or nullptr
+	const LanguageRules* rulesFor(const QString& language)
+	{
+		static const QHash<QString, QString> aliases = {
+			{ QStringLiteral("h"), QStringLiteral("c") },
+			{ QStringLiteral("c++"), QStringLiteral("cpp") },
+			{ QStringLiteral("cc"), QStringLiteral("cpp") },
+			{ QStringLiteral("cxx"), QStringLiteral("cpp") },
+			{ QStringLiteral("hpp"), QStringLiteral("cpp") },
+			{ QStringLiteral("cs"), QStringLiteral("csharp") },
+			{ QStringLiteral("c#"), QStringLiteral("csharp") },
+			{ QStringLiteral("kt"), QStringLiteral("kotlin") },
+			{ QStringLiteral("js"), QStringLiteral("javascript") },
+			{ QStringLiteral("jsx"), QStringLiteral("javascript") },
+			{ QStringLiteral("ts"), QStringLiteral("typescript") },
+			{ QStringLiteral("tsx"), QStringLiteral("typescript") },
+			{ QStringLiteral("py"), QStringLiteral("python") },
+			{ QStringLiteral("rs"), QStringLiteral("rust") },
+			{ QStringLiteral("golang"), QStringLiteral("go") },
+			{ QStringLiteral("sh"), QStringLiteral("bash") },
+			{ QStringLiteral("shell"), QStringLiteral("bash") },
+			{ QStringLiteral("zsh"), QStringLiteral("bash") },
+		};
+
+		QString name = language.trimmed().section(' ', 0, 0).toLower();
+		name = aliases.value(name, name);
+
+		const QHash<QString, LanguageRules>& table = languages();
+		auto it = table.constFind(name);
+		return (it != table.constEnd()) ? &it.value() : nullptr;
+	}
+
+	bool matchesAt(const QString& code, int i, const QString& token)
+	{
+		return !token.isEmpty() && code.midRef(i, token.size()) == token;
+	}
+}
+
+bool ChatCodeHighlighter::supports(const QString& language)
+{
+	return rulesFor(language) != nullptr;
+}
+
+QVector<ChatCodeSpan> ChatCodeHighlighter::tokenize(const QString& code, const QString& language)
+{
+	QVector<ChatCodeSpan> spans;
+	const LanguageRules* rules = rulesFor(language);
+	if (!rules) return spans;
+
+	const QChar* s = code.constData();
+	const int n = code.size();
+
+	auto add = [&spans](int start, int end, ChatCodeToken token) {
+		if (end > start) spans.append({ start, end - start, token });
+	};
+	auto lineEnd = [&code, n](int from) {
+		const int end = code.indexOf('\n', from);
+		return (end < 0) ? n : end;
+	};
+
+	bool atLineStart = true;		// Only whitespace so far on this line
+	int i = 0;
+	while (i < n) {
+		const QChar c = s[i];
+		if (c == '\n') {
+			atLineStart = true;
+			++i;
+			continue;
+		}
+		if (c.isSpace()) {
+			++i;
+			continue;
+		}
+		const bool lineStart = atLineStart;
+		atLineStart = false;
+
+		// Preprocessor directive
+		if (rules->preprocessor && lineStart && c == '#') {
+			const int end = lineEnd(i);
+			add(i, end, ChatCodeToken::Preprocessor);
+			i = end;
+			continue;
+		}
+
+		// Block comment
+		if (matchesAt(code, i, rules->blockOpen)) {
+			int end = code.indexOf(rules->blockClose, i + rules->blockOpen.size());
+			end = (end < 0) ? n : end + rules->blockClose.size();
+			add(i, end, ChatCodeToken::Comment);
+			i = end;
+			continue;
+		}
+
+		// Line comment ('#' only after whitespace, so "$#" and "${#x}" stay code)
+		if (matchesAt(code, i, rules->lineComment) && (c != '#' || i == 0 || s[i - 1].isSpace())) {
+			const int end = lineEnd(i);
+			add(i, end, ChatCodeToken::Comment);
+			i = end;
+			continue;
+		}
+
+		// String
+		if (rules->quotes.contains(c)) {
+			int end;
+			if (rules->tripleQuotes && i + 2 < n && s[i + 1] == c && s[i + 2] == c) {
+				const QString delimiter(3, c);
+				end = code.indexOf(delimiter, i + 3);
+				end = (end < 0) ? n : end + 3;
+			}
+			else {
+				const bool multiline = (c == '`');
+				int j = i + 1;
+				while (j < n && s[j] != c && (multiline || s[j] != '\n')) {
+					j += (s[j] == '\\') ? 2 : 1;
+				}
+				end = (j < n && s[j] == c) ? j + 1 : qMin(j, n);
+			}
+			add(i, end, ChatCodeToken::String);
+			i = end;
+			continue;
+		}
+
+		// Number
+		if (c.isDigit() || (c == '.' && i + 1 < n && s[i + 1].isDigit())) {
+			int j = i + 1;
+			while (j < n && (s[j].isLetterOrNumber() || s[j] == '.' || s[j] == '_')) ++j;
+			add(i, j, ChatCodeToken::Number);
+			i = j;
+			continue;
+		}
+
+		// Identifier: keyword or type
+		if (c.isLetter() || c == '_') {
+			int j = i + 1;
+			while (j < n && (s[j].isLetterOrNumber() || s[j] == '_')) ++j;
+
+			// Looked up without copying the characters
+			QString word = QString::fromRawData(s + i, j - i);
+			if (rules->caseInsensitive) word = word.toLower();
+			if (rules->keywords.contains(word)) {
+				add(i, j, ChatCodeToken::Keyword);
+			}
+			else if (rules->types.contains(word)) {
+				add(i, j, ChatCodeToken::Type);
+			}
+			i = j;
+			continue;
+		}
+
+		++i;
+	}
+	return spans;
+}
+
+QTextCharFormat ChatCodeHighlighter::format(ChatCodeToken token)
+{
+	static const QVector<QTextCharFormat> formats = [] {
+		QVector<QTextCharFormat> formats(int(ChatCodeToken::Count));
+		formats[int(ChatCodeToken::Keyword)].setForeground(QColor(0x00, 0x00, 0xff));
+		formats[int(ChatCodeToken::Type)].setForeground(QColor(0x26, 0x7f, 0x99));
+		formats[int(ChatCodeToken::String)].setForeground(QColor(0xa3, 0x15, 0x15));
+		formats[int(ChatCodeToken::Comment)].setForeground(QColor(0x00, 0x80, 0x00));
+		formats[int(ChatCodeToken::Comment)].setFontItalic(true);
+		formats[int(ChatCodeToken::Number)].setForeground(QColor(0x09, 0x86, 0x58));
+		formats[int(ChatCodeToken::Preprocessor)].setForeground(QColor(0x80, 0x80, 0x80));
+		return formats;
+	}();
+	return formats.value(int(token));
+}
+
+quint64 ChatCodeHighlighter::key(const QString& code, const QString& language)
+{
+	// Two differently seeded 32-bit hashes: colliding blocks would share colors
+	return (quint64(qHash(code, 0x9e3779b9u)) << 32) | (qHash(code) ^ qHash(language));
+}
@@ -0,0 +1,76 @@
+/**
+ * File: qtChatCodeHighlighter.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 08/06/2026| Tian-Qing Ye  | Created: tokenizer for syntax highlighting of fenced code blocks
+ */
+#ifndef QT_CHATCODEHIGHLIGHTER_H
+#define QT_CHATCODEHIGHLIGHTER_H
+
+#include <QString>
+#include <QVector>
+#include <QTextCharFormat>
+
+/**
+ * \brief Token classes that get a color of their own
+ */
+enum class ChatCodeToken : quint8
+{
+	Keyword,
+	Type,
+	String,
+	Comment,
+	Number,
+	Preprocessor,
+	Count
+};
+
+/**
+ * \brief A highlighted range of a code block (offsets into the code text)
+ */
+struct ChatCodeSpan
+{
+	int start;
+	int length;
+	ChatCodeToken token;
+};
+
+Q_DECLARE_TYPEINFO(ChatCodeSpan, Q_PRIMITIVE_TYPE);
+
+/**
+ * \brief Lexical syntax highlighting of code blocks
+ *
+ * A single-pass scanner per language family (keywords, types, strings,
+ * comments, numbers, preprocessor lines) rather than a parser: good enough to
+ * color chat replies, and linear in the code length. tokenize() has no shared
+ * mutable state, so it runs on worker threads; the formats are only used on
+ * the GUI thread.
+ *
+ * Languages (fence info string, case-insensitive): c, cpp / c++, csharp / cs,
+ * java, kotlin, javascript / js, typescript / ts, python / py, rust / rs, go,
+ * bash / sh / shell / zsh, sql, json.
+ */
+class ChatCodeHighlighter
+{
+public:
+	//! Returns true if tokenize() knows the language of a fence info string
+	static bool supports(const QString& language);
+
+	/**
+	 * \brief Split code into highlighted spans
+	 * \param code Code text, lines separated by '\n'
+	 * \param language Fence info string (e.g. "cpp"); unknown languages yield no spans
+	 * \return Spans sorted by start, not overlapping
+	 */
+	static QVector<ChatCodeSpan> tokenize(const QString& code, const QString& language);
+
+	//! Character format of a token class (GUI thread)
+	static QTextCharFormat format(ChatCodeToken token);
+
+	//! Hash of a code block, the key of cached spans
+	static quint64 key(const QString& code, const QString& language);
+};
+
+#endif // QT_CHATCODEHIGHLIGHTER_H
@@ -0,0 +1,121 @@
+/**
+ * File: qtChatContextCompactor.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 22/06/2026| Tian-Qing Ye   | Created: cached summaries of old context runs
+ * 16/10/2026| Tian-Qing Ye   | forgetBefore(), so the summaries held stay bounded
+ */
+#include "qtChatContextCompactor.h"
+
+ChatContextCompactor::ChatContextCompactor(int runLength)
+	: _runLength(qMax(1, runLength))
+	, _nextTicket(0)
+{
+}
+
+bool ChatContextCompactor::needsSummary(int run) const
+{
+	return !_summaries.contains(run) && !_pending.contains(run) && !_failed.contains(run);
+}
+
+int ChatContextCompactor::setPending(int run)
+{
+	const int ticket = _nextTicket++;
+	_pending.insert(run, ticket);
+	return ticket;
+}
+
+bool ChatContextCompactor::finish(int run, int ticket, const QString& summary)
+{
+	// Invalidated (or cleared) since: the summary is of messages that changed
+	auto it = _pending.find(run);
+	if (it == _pending.end() || it.value() != ticket) return false;
+	_pending.erase(it);
+
+	if (summary.trimmed().isEmpty()) {
+		_failed.insert(run);
+	}
+	else {
+		_summaries.insert(run, summary);
+	}
+	return true;
+}
+
+void ChatContextCompactor::invalidateFrom(int contextMessage)
+{
+	// Runs before the one holding contextMessage are unaffected
+	const int firstRun = qMax(0, contextMessage) / _runLength;
+
+	for (auto it = _summaries.begin(); it != _summaries.end();) {
+		if (it.key() >= firstRun) {
+			it = _summaries.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+	for (auto it = _pending.begin(); it != _pending.end();) {
+		if (it.key() >= firstRun) {
+			it = _pending.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+	for (auto it = _failed.begin(); it != _failed.end();) {
+		if (*it >= firstRun) {
+			it = _failed.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+void ChatContextCompactor::forgetBefore(int run)
+{
+	// Pending runs go too: their late results miss in finish()
+	for (auto it = _summaries.begin(); it != _summaries.end();) {
+		if (it.key() < run) {
+			it = _summaries.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+	for (auto it = _pending.begin(); it != _pending.end();) {
+		if (it.key() < run) {
+			it = _pending.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+	for (auto it = _failed.begin(); it != _failed.end();) {
+		if (*it < run) {
+			it = _failed.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+void ChatContextCompactor::setRunLength(int runLength)
+{
+	runLength = qMax(1, runLength);
+	if (runLength == _runLength) return;
+
+	// Every run changes; tickets keep counting so that late results still miss
+	clear();
+	_runLength = runLength;
+}
+
+void ChatContextCompactor::clear()
+{
+	_summaries.clear();
+	_pending.clear();
+	_failed.clear();
+}
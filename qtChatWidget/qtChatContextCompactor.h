@@ -0,0 +1,100 @@
+/**
+ * File: qtChatContextCompactor.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 22/06/2026| Tian-Qing Ye  | Created: cached summaries of old context runs
+ * 16/10/2026| Tian-Qing Ye  | forgetBefore(), so the summaries held stay bounded
+ */
+#ifndef QT_CHATCONTEXTCOMPACTOR_H
+#define QT_CHATCONTEXTCOMPACTOR_H
+
+#include <QString>
+#include <QHash>
+#include <QSet>
+#include <QtGlobal>
+
+/**
+ * \brief Summaries that stand in for old turns of the API context
+ *
+ * The user/assistant messages of a conversation (numbered as in
+ * ChatContextIndex::contextPositions()) are cut into runs of a fixed length,
+ * counted from the first message: run n holds the messages
+ * [n * runLength, (n + 1) * runLength). Runs never move as the conversation
+ * grows, so each one is summarized once and its summary stays valid until one
+ * of its messages changes.
+ *
+ * This class only keeps the summaries and the state of the runs; the widget
+ * runs the summarizer in the background and feeds the results back through
+ * finish(). Results of work started before its run was invalidated are
+ * recognized by their ticket and dropped.
+ */
+class ChatContextCompactor
+{
+public:
+	//! Default user/assistant messages per run
+	static const int DefaultRunLength = 16;
+
+	explicit ChatContextCompactor(int runLength = DefaultRunLength);
+
+	//! Messages per run
+	int runLength() const { return _runLength; }
+
+	//! Change the messages per run (forgets everything if it differs)
+	void setRunLength(int runLength);
+
+	//! Number of complete runs among the first count context messages
+	int runsWithin(int count) const { return qMax(0, count) / _runLength; }
+
+	//! First context message of a run
+	int runStart(int run) const { return run * _runLength; }
+
+	//! Returns true if the summary of a run is ready
+	bool hasSummary(int run) const { return _summaries.contains(run); }
+
+	//! Summary of a run (empty if not ready)
+	QString summary(int run) const { return _summaries.value(run); }
+
+	//! Returns true if a run has no summary and none is being made (failed runs are not retried)
+	bool needsSummary(int run) const;
+
+	//! Note that the summary of a run is being made; returns the ticket to hand back to finish()
+	int setPending(int run);
+
+	/**
+	 * \brief Store the result of the summarizer
+	 * \param run The run summarized
+	 * \param ticket Value returned by setPending()
+	 * \param summary The summary (empty: the summarizer failed)
+	 * \return false if the run was invalidated meanwhile (the result is dropped)
+	 */
+	bool finish(int run, int ticket, const QString& summary);
+
+	//! Forget the runs containing a context message from contextMessage on (a message changed)
+	void invalidateFrom(int contextMessage);
+
+	//! Forget the runs before a run (no context reaches them any more)
+	void forgetBefore(int run);
+
+	//! Forget everything (the history was replaced)
+	void clear();
+
+	//! Number of summaries held
+	int summaryCount() const { return _summaries.size(); }
+
+private:
+	int _runLength;
+
+	//! Summaries by run
+	QHash<int, QString> _summaries;
+
+	//! Runs being summarized (with their ticket), and runs the summarizer failed on
+	QHash<int, int> _pending;
+	QSet<int> _failed;
+
+	//! Ticket of the next setPending()
+	int _nextTicket;
+};
+
+#endif // QT_CHATCONTEXTCOMPACTOR_H
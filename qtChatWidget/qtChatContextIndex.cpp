@@ -0,0 +1,200 @@
+/**
+ * File: qtChatContextIndex.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 16/03/2026| Tian-Qing Ye   | Created: cached token counts for token-budgeted context
+ * 23/03/2026| Tian-Qing Ye   | Track user/assistant positions so context building is O(k)
+ * 16/10/2026| Tian-Qing Ye   | Keep entries for resident messages only (see dropBefore())
+ */
+#include "qtChatContextIndex.h"
+#include "qtChatHistoryStore.h"
+#include <algorithm>
+
+namespace
+{
+	bool isContextRole(ChatRole role)
+	{
+		return role == ChatRole::User || role == ChatRole::Assistant;
+	}
+}
+
+ChatContextIndex::ChatContextIndex()
+	: _first(0)
+	, _contextBefore(0)
+	, _estimator(&ChatContextIndex::estimateTokens)
+{
+	_tokenPrefix.append(0);
+}
+
+void ChatContextIndex::setEstimator(const TokenEstimator& estimator)
+{
+	_estimator = estimator ? estimator : TokenEstimator(&ChatContextIndex::estimateTokens);
+}
+
+int ChatContextIndex::countTokens(const ChatHistoryStore& history, int index) const
+{
+	if (!isContextRole(history.roleAt(index))) {
+		return 0;
+	}
+	if (!history.isResident(index)) {
+		return MessageOverhead + _estimator(history.messageStringAt(index));
+	}
+	return MessageOverhead + _estimator(history.messageAt(index));
+}
+
+void ChatContextIndex::rebuild(const ChatHistoryStore& history)
+{
+	clear();
+	appendFrom(history);
+}
+
+void ChatContextIndex::appendFrom(const ChatHistoryStore& history)
+{
+	int i = size();
+
+	// Nothing indexed yet: archived messages only add to the totals
+	if (i == _first) {
+		for (; i < history.firstResident() && i < history.size() - 1; ++i) {
+			if (isContextRole(history.roleAt(i))) {
+				++_contextBefore;
+			}
+			_tokenPrefix[0] += countTokens(history, i);
+		}
+		_first = i;
+	}
+
+	for (; i < history.size(); ++i) {
+		if (isContextRole(history.roleAt(i))) {
+			_contextPositions.append(i);
+		}
+		_tokenPrefix.append(_tokenPrefix.last() + countTokens(history, i));
+	}
+}
+
+void ChatContextIndex::dropBefore(int index)
+{
+	index = qMin(index, size() - 1);
+	if (index <= _first) return;
+
+	// Removed from the front in place: capacity is kept, so appending does not reallocate
+	const auto kept = std::lower_bound(_contextPositions.constBegin(), _contextPositions.constEnd(), index);
+	const int drop = int(kept - _contextPositions.constBegin());
+	_contextPositions.remove(0, drop);
+	_contextBefore += drop;
+
+	_tokenPrefix.remove(0, index - _first);
+	_first = index;
+}
+
+void ChatContextIndex::updateLast(const ChatHistoryStore& history)
+{
+	const int last = size() - 1;
+	if (last < _first || last >= history.size()) return;
+
+	_tokenPrefix[last - _first + 1] = _tokenPrefix.at(last - _first) + countTokens(history, last);
+}
+
+void ChatContextIndex::clear()
+{
+	_first = 0;
+	_tokenPrefix.resize(1);
+	_tokenPrefix[0] = 0;
+	_contextBefore = 0;
+	_contextPositions.clear();
+}
+
+qint64 ChatContextIndex::memoryUsage() const
+{
+	return qint64(_tokenPrefix.capacity()) * sizeof(qint64) + qint64(_contextPositions.capacity()) * sizeof(int);
+}
+
+int ChatContextIndex::contextCountBefore(int index, const ChatHistoryStore& history) const
+{
+	if (index >= _first) {
+		const auto it = std::lower_bound(_contextPositions.constBegin(), _contextPositions.constEnd(), index);
+		return _contextBefore + int(it - _contextPositions.constBegin());
+	}
+
+	// Archived: count back from the first indexed message
+	int count = _contextBefore;
+	for (int i = qMax(0, index); i < _first; ++i) {
+		if (isContextRole(history.roleAt(i))) {
+			--count;
+		}
+	}
+	return count;
+}
+
+QVector<int> ChatContextIndex::contextPositions(int first, int last, const ChatHistoryStore& history) const
+{
+	QVector<int> positions;
+	first = qMax(0, first);
+	last = qMin(last, contextCount());
+	if (first >= last) return positions;
+	positions.reserve(last - first);
+
+	// Archived ones, newest first, then in order
+	int n = _contextBefore;
+	for (int i = _first - 1; i >= 0 && n > first; --i) {
+		if (isContextRole(history.roleAt(i)) && --n < last) {
+			positions.append(i);
+		}
+	}
+	std::reverse(positions.begin(), positions.end());
+
+	for (n = qMax(first, _contextBefore); n < last; ++n) {
+		positions.append(_contextPositions.at(n - _contextBefore));
+	}
+	return positions;
+}
+
+int ChatContextIndex::firstWithinBudget(qint64 budget, int end, const ChatHistoryStore& history) const
+{
+	if (budget < 0) return end;
+
+	// The prefix is non-decreasing: find the first i with prefix[end] - prefix[i] <= budget
+	const qint64 target = prefixAt(end) - budget;
+	if (target > _tokenPrefix.first()) {
+		const auto first = _tokenPrefix.constBegin();
+		const auto it = std::lower_bound(first, first + (end - _first) + 1, target);
+		return _first + int(it - first);
+	}
+
+	// The window reaches the archived messages: they are counted one by one
+	qint64 left = _tokenPrefix.first() - target;
+	int i = _first;
+	while (i > 0) {
+		const int tokens = countTokens(history, i - 1);
+		if (tokens > left) break;
+		left -= tokens;
+		--i;
+	}
+	return i;
+}
+
+int ChatContextIndex::estimateTokens(QStringView text)
+{
+	int tokens = 0;
+	int wordLength = 0;
+
+	for (const QChar c : text) {
+		const ushort u = c.unicode();
+
+		// Latin, Greek and Cyrillic letters and digits form words
+		if (u < 0x0530 && c.isLetterOrNumber()) {
+			++wordLength;
+			continue;
+		}
+
+		tokens += (wordLength + 3) / 4;
+		wordLength = 0;
+
+		if (!c.isSpace()) {
+			++tokens;	// punctuation, symbols, CJK ideographs, ...
+		}
+	}
+
+	return tokens + (wordLength + 3) / 4;
+}
@@ -0,0 +1,148 @@
+/**
+ * File: qtChatContextIndex.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 16/03/2026| Tian-Qing Ye  | Created: cached token counts for token-budgeted context
+ * 23/03/2026| Tian-Qing Ye  | Track user/assistant positions so context building is O(k)
+ * 16/10/2026| Tian-Qing Ye  | Keep entries for resident messages only (see dropBefore())
+ */
+#ifndef QT_CHATCONTEXTINDEX_H
+#define QT_CHATCONTEXTINDEX_H
+
+#include <QStringView>
+#include <QVector>
+#include <functional>
+
+// Forward declarations
+class ChatHistoryStore;
+
+/**
+ * \brief Side index of the chat history used to build API context quickly
+ *
+ * The token count of every message is computed once, when the message is
+ * added, and kept as a running (prefix) sum. Only user and assistant messages
+ * count; system notifications never go into the context and contribute zero.
+ * The token total of any range of messages is a subtraction, and the longest
+ * recent window that fits a budget is a binary search.
+ *
+ * The history positions of user and assistant messages are kept in order as
+ * well, so the last k context messages are found without scanning the history.
+ *
+ * Entries of messages the store archived are dropped (dropBefore()), so the
+ * index does not grow with the history; only their totals are kept. Queries
+ * reaching before the first indexed message recount the archived messages
+ * they need from the history.
+ *
+ * The widget keeps the index in step with its ChatHistoryStore.
+ */
+class ChatContextIndex
+{
+public:
+	//! Returns the number of tokens of a message body
+	typedef std::function<int(QStringView)> TokenEstimator;
+
+	//! Tokens added per message for the role and message framing (OpenAI chat format)
+	static const int MessageOverhead = 4;
+
+	ChatContextIndex();
+
+	/**
+	 * \brief Replace the tokenizer/estimator
+	 * \param estimator The new estimator (an empty function restores estimateTokens())
+	 *
+	 * Call rebuild() afterwards; cached counts are not recomputed here.
+	 */
+	void setEstimator(const TokenEstimator& estimator);
+
+	//! Recompute everything from the history (archived messages only count towards the totals)
+	void rebuild(const ChatHistoryStore& history);
+
+	//! Count the messages the history gained since the last update
+	void appendFrom(const ChatHistoryStore& history);
+
+	/**
+	 * \brief Forget the entries of the messages before a history position
+	 * \param index First message to keep (the last message is always kept)
+	 *
+	 * Called once the history archived those messages; totals stay exact.
+	 */
+	void dropBefore(int index);
+
+	//! Recount the last message after its content grew (e.g. a finished stream)
+	void updateLast(const ChatHistoryStore& history);
+
+	//! Remove everything
+	void clear();
+
+	//! Heap memory of the index, in bytes
+	qint64 memoryUsage() const;
+
+	//! Number of messages counted
+	int size() const { return _first + _tokenPrefix.size() - 1; }
+
+	//! First message with an entry of its own
+	int firstIndexed() const { return _first; }
+
+	//! Context tokens of one indexed message (0 for system messages)
+	int tokensAt(int index) const { return int(prefixAt(index + 1) - prefixAt(index)); }
+
+	//! Context tokens of the messages [first, last); first is 0 or an indexed message
+	qint64 tokensBetween(int first, int last) const { return prefixAt(last) - prefixAt(first); }
+
+	/**
+	 * \brief Find the longest window ending at a message that fits a token budget
+	 * \param budget Token budget
+	 * \param end One past the last message of the window (not before firstIndexed())
+	 * \param history The history indexed, to count archived messages the window reaches
+	 * \return The first message of the window (end if nothing fits)
+	 */
+	int firstWithinBudget(qint64 budget, int end, const ChatHistoryStore& history) const;
+
+	//! Number of user/assistant messages
+	int contextCount() const { return _contextBefore + _contextPositions.size(); }
+
+	/**
+	 * \brief History positions of the user/assistant messages [first, last)
+	 *
+	 * Archived ones are found by walking back from the first indexed message,
+	 * so the cost grows with how far first lies before it.
+	 */
+	QVector<int> contextPositions(int first, int last, const ChatHistoryStore& history) const;
+
+	//! Number of user/assistant messages before a history position
+	int contextCountBefore(int index, const ChatHistoryStore& history) const;
+
+	//! Context tokens of a message, computed now with the current estimator
+	int countTokens(const ChatHistoryStore& history, int index) const;
+
+	/**
+	 * \brief Default estimator, roughly matching BPE tokenizers
+	 *
+	 * Runs of letters and digits count one token per four characters, each
+	 * punctuation mark counts one token and whitespace is free. CJK and other
+	 * characters outside the Latin, Greek and Cyrillic ranges count one token each.
+	 */
+	static int estimateTokens(QStringView text);
+
+private:
+	//! Context tokens of messages [0, index); index is 0 or not before _first
+	qint64 prefixAt(int index) const { return (index < _first) ? 0 : _tokenPrefix.at(index - _first); }
+
+	//! First message with an entry of its own
+	int _first;
+
+	//! _tokenPrefix[i] = context tokens of messages [0, _first + i)
+	QVector<qint64> _tokenPrefix;
+
+	//! User/assistant messages before _first
+	int _contextBefore;
+
+	//! History positions of user/assistant messages from _first on, ascending
+	QVector<int> _contextPositions;
+
+	TokenEstimator _estimator;
+};
+
+#endif // QT_CHATCONTEXTINDEX_H
@@ -0,0 +1,254 @@
+/**
+ * File: qtChatExporter.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 06/04/2026| Tian-Qing Ye   | Created: background export of the chat history
+ * 20/07/2026| Tian-Qing Ye   | JSONL written with ChatJsonWriter instead of a QJsonDocument per message
+ * 16/10/2026| Tian-Qing Ye   | JSONL lines also carry sender and timestamp, so an export imports back as it was
+ * 16/10/2026| Tian-Qing Ye   | Destructor waits for the running worker, which posts to the exporter
+ */
+#include "qtChatExporter.h"
+#include "qtChatJsonWriter.h"
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QSemaphore>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDateTime>
+
+namespace
+{
+	//! Output is handed to the device in buffers of this size
+	const int kWriteBufferSize = 256 * 1024;
+
+	//! Outcome of a worker run
+	enum WorkerResult { ExportDone, ExportFailed, ExportCancelled };
+
+	const char kHtmlHead[] =
+		"<!DOCTYPE html>\n<html>\n<head>\n<meta charset=\"utf-8\">\n"
+		"<title>Chat History Export</title>\n<style>\n"
+		"body { font-family: 'Segoe UI', sans-serif; font-size: 10pt; color: #323130; max-width: 60em; margin: 2em auto; }\n"
+		".message { margin-bottom: 1em; }\n"
+		".sender { font-weight: bold; color: #605e5c; }\n"
+		".user .sender { color: #0078d4; }\n"
+		".assistant .sender { color: #107c10; }\n"
+		".system .body { font-style: italic; }\n"
+		".body { white-space: pre-wrap; }\n"
+		".meta { color: #605e5c; }\n"
+		"</style>\n</head>\n<body>\n";
+
+	void appendHeader(QByteArray& out, ChatExporter::Format format, int total)
+	{
+		const QByteArray exported = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss").toUtf8();
+		const QByteArray count = QByteArray::number(total);
+
+		switch (format) {
+		case ChatExporter::PlainText:
+			out += "========================================\n";
+			out += "Chat History Export\n";
+			out += "Exported: " + exported + "\n";
+			out += "Total Messages: " + count + "\n";
+			out += "========================================\n\n";
+			break;
+		case ChatExporter::Markdown:
+			out += "# Chat History Export\n\n";
+			out += "Exported: " + exported + "  \nTotal Messages: " + count + "\n\n---\n\n";
+			break;
+		case ChatExporter::Html:
+			out += kHtmlHead;
+			out += "<h1>Chat History Export</h1>\n";
+			out += "<p class=\"meta\">Exported: " + exported + " &middot; " + count + " messages</p>\n";
+			break;
+		case ChatExporter::Jsonl:
+			break;
+		}
+	}
+
+	void appendMessage(QByteArray& out, ChatExporter::Format format, const ChatHistoryStore& history, int index)
+	{
+		switch (format) {
+		case ChatExporter::PlainText:
+			out += "[" + history.timestampStringAt(index).toUtf8() + "] " + history.senderAt(index).toUtf8() + ":\n";
+			out += history.messageStringAt(index).toUtf8() + "\n\n";
+			break;
+		case ChatExporter::Markdown:
+			out += "### [" + history.timestampStringAt(index).toUtf8() + "] " + history.senderAt(index).toUtf8() + "\n\n";
+			out += history.messageStringAt(index).toUtf8() + "\n\n";
+			break;
+		case ChatExporter::Html:
+			out += "<div class=\"message " + ChatHistoryStore::roleToString(history.roleAt(index)).toUtf8() + "\">";
+			out += "<div class=\"sender\">[" + history.timestampStringAt(index).toUtf8() + "] "
+				+ history.senderAt(index).toHtmlEscaped().toUtf8() + ":</div>";
+			out += "<div class=\"body\">" + history.messageStringAt(index).toHtmlEscaped().toUtf8() + "</div></div>\n";
+			break;
+		case ChatExporter::Jsonl:
+			// Resident bodies are encoded in place, archived ones read back first
+			if (history.isResident(index)) {
+				ChatJsonWriter::appendMessage(out, history.roleStringAt(index), history.messageAt(index));
+			}
+			else {
+				ChatJsonWriter::appendMessage(out, history.roleStringAt(index), history.messageStringAt(index));
+			}
+
+			// Sender and timestamp as extra keys (ignored by OpenAI clients, read back by ChatImporter)
+			out.chop(1);
+			out += ",\"sender\":";
+			ChatJsonWriter::appendString(out, history.senderAt(index));
+			out += ",\"timestamp\":";
+			ChatJsonWriter::appendString(out, history.timestampStringAt(index));
+			out += "}\n";
+			break;
+		}
+	}
+
+	void appendFooter(QByteArray& out, ChatExporter::Format format)
+	{
+		if (format == ChatExporter::Html) {
+			out += "</body>\n</html>\n";
+		}
+	}
+}
+
+//! State shared between the exporter and its running worker
+struct ChatExporter::Run
+{
+	QAtomicInt cancelled;
+
+	//! Released once the worker has posted its result and no longer uses the exporter
+	QSemaphore done;
+};
+
+ChatExporter::ChatExporter(QThreadPool* pool, QObject* parent)
+	: QObject(parent)
+	, _pool(pool)
+	, _generation(0)
+{
+}
+
+ChatExporter::~ChatExporter()
+{
+	// The worker posts to this object: it must be done before the object goes
+	if (_run) {
+		_run->cancelled.storeRelease(1);
+		_run->done.acquire();
+	}
+}
+
+bool ChatExporter::start(const ChatHistoryStore& history, const QString& fileName, Format format)
+{
+	if (isRunning()) return false;
+
+	QSharedPointer<Run> run(new Run);
+	_run = run;
+	const int generation = ++_generation;
+	const int total = history.size();
+
+	_pool->start([this, history, fileName, format, run, generation, total]() {
+		QSaveFile file(fileName);
+		int result = ExportFailed;
+		QString errorString;
+
+		if (run->cancelled.loadAcquire()) {
+			result = ExportCancelled;
+		}
+		else if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+			// One progress post per flushed buffer keeps the GUI thread's event queue short
+			const bool written = write(&file, history, format, [this, run, generation, total](int count) {
+				if (run->cancelled.loadAcquire()) return false;
+				QMetaObject::invokeMethod(this, [this, generation, count, total]() {
+					if (generation == _generation) {
+						emit progress(count, total);
+					}
+				}, Qt::QueuedConnection);
+				return true;
+			});
+
+			if (run->cancelled.loadAcquire()) {
+				file.cancelWriting();
+				result = ExportCancelled;
+			}
+			else if (written && file.commit()) {
+				result = ExportDone;
+			}
+		}
+		if (result == ExportFailed) {
+			errorString = file.errorString();
+		}
+
+		QMetaObject::invokeMethod(this, [this, generation, result, fileName, errorString]() {
+			onWorkerDone(generation, result, fileName, errorString);
+		}, Qt::QueuedConnection);
+
+		// Posts to a deleted exporter are dropped by Qt; after this, this is not touched
+		run->done.release();
+	});
+
+	return true;
+}
+
+void ChatExporter::cancel()
+{
+	if (_run) {
+		_run->cancelled.storeRelease(1);
+	}
+}
+
+void ChatExporter::onWorkerDone(int generation, int result, const QString& fileName, const QString& errorString)
+{
+	if (generation != _generation) return;
+
+	_run.reset();
+	switch (result) {
+	case ExportDone:
+		emit finished(fileName);
+		break;
+	case ExportCancelled:
+		emit cancelled();
+		break;
+	default:
+		emit failed(errorString);
+		break;
+	}
+}
+
+bool ChatExporter::write(QIODevice* device, const ChatHistoryStore& history, Format format, const std::function<bool(int)>& progress)
+{
+	QByteArray buffer;
+	buffer.reserve(kWriteBufferSize + kWriteBufferSize / 4);
+
+	appendHeader(buffer, format, history.size());
+	for (int i = 0; i < history.size(); ++i) {
+		appendMessage(buffer, format, history, i);
+
+		if (buffer.size() >= kWriteBufferSize) {
+			if (device->write(buffer) != buffer.size()) return false;
+			buffer.resize(0);	// keeps the reserved capacity, unlike clear()
+			if (progress && !progress(i + 1)) return false;
+		}
+	}
+	appendFooter(buffer, format);
+
+	if (device->write(buffer) != buffer.size()) return false;
+	return !progress || progress(history.size());
+}
+
+QString ChatExporter::fileFilter()
+{
+	return "Text Files (*.txt);;JSON Lines (*.jsonl);;Markdown (*.md);;HTML (*.html *.htm);;All Files (*)";
+}
+
+ChatExporter::Format ChatExporter::formatFor(const QString& fileName, const QString& selectedFilter)
+{
+	const QString suffix = QFileInfo(fileName).suffix().toLower();
+	if (suffix == "jsonl") return Jsonl;
+	if (suffix == "md" || suffix == "markdown") return Markdown;
+	if (suffix == "html" || suffix == "htm") return Html;
+	if (suffix == "txt") return PlainText;
+
+	if (selectedFilter.startsWith("JSON")) return Jsonl;
+	if (selectedFilter.startsWith("Markdown")) return Markdown;
+	if (selectedFilter.startsWith("HTML")) return Html;
+	return PlainText;
+}
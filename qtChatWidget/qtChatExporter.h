@@ -0,0 +1,128 @@
+/**
+ * File: qtChatExporter.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 06/04/2026| Tian-Qing Ye  | Created: background export of the chat history
+ * 16/10/2026| Tian-Qing Ye  | JSONL lines also carry sender and timestamp
+ * 16/10/2026| Tian-Qing Ye  | Destructor waits for the running worker
+ */
+#ifndef QT_CHATEXPORTER_H
+#define QT_CHATEXPORTER_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QSharedPointer>
+#include <functional>
+#include "qtChatHistoryStore.h"
+
+// Forward declarations
+class QIODevice;
+class QThreadPool;
+
+/**
+ * \brief Writes the chat history to a file on a worker thread
+ *
+ * The export works on a snapshot of the history (an O(1) copy of the store),
+ * so the conversation can go on while it runs. The snapshot shares the
+ * archive of the store (history file or compressed archive), which
+ * ChatHistoryStore::clear() and assign() truncate: cancel() the export first.
+ * Output is built in large buffers and written through a QSaveFile: a
+ * cancelled or failed export leaves no partial file behind.
+ *
+ * Destroying the exporter cancels a running export and waits for its worker
+ * to stop, so it can be deleted at any time, with any thread pool.
+ */
+class ChatExporter : public QObject
+{
+	Q_OBJECT
+
+public:
+	//! Output formats
+	enum Format {
+		PlainText,	//!< The classic "[timestamp] Sender:" text layout
+		Jsonl,		//!< One OpenAI chat message ({"role", "content"}, plus "sender" and "timestamp") per line
+		Markdown,	//!< Markdown document, message bodies kept as written
+		Html		//!< Standalone HTML page
+	};
+
+	/**
+	 * \brief Constructor
+	 * \param pool Worker threads to run exports on (must outlive running exports)
+	 * \param parent Parent object
+	 */
+	explicit ChatExporter(QThreadPool* pool, QObject* parent = nullptr);
+
+	//! Cancels a running export and blocks until its worker has stopped
+	~ChatExporter();
+
+	/**
+	 * \brief Start exporting
+	 * \param history Snapshot of the history to export
+	 * \param fileName Output file
+	 * \param format Output format
+	 * \return false if an export is already running
+	 */
+	bool start(const ChatHistoryStore& history, const QString& fileName, Format format);
+
+	//! Stop the running export; cancelled() follows
+	void cancel();
+
+	//! Returns true while an export runs
+	bool isRunning() const { return !_run.isNull(); }
+
+	/**
+	 * \brief Write a whole export synchronously (this is what the worker runs)
+	 * \param device Open output device
+	 * \param history History to export
+	 * \param format Output format
+	 * \param progress Called with the number of messages written after each
+	 *        buffer flush; return false to stop
+	 * \return false if writing failed or progress() stopped it
+	 */
+	static bool write(QIODevice* device, const ChatHistoryStore& history, Format format,
+		const std::function<bool(int)>& progress = std::function<bool(int)>());
+
+	//! Filter string for QFileDialog listing all formats
+	static QString fileFilter();
+
+	//! Format from the file suffix, else from the selected filter (PlainText if neither matches)
+	static Format formatFor(const QString& fileName, const QString& selectedFilter = QString());
+
+signals:
+	/**
+	 * \brief Emitted as messages are written
+	 * \param written Number of messages written so far
+	 * \param total Number of messages being exported
+	 */
+	void progress(int written, int total);
+
+	//! Emitted when the export has been written to fileName
+	void finished(const QString& fileName);
+
+	//! Emitted when the export failed
+	void failed(const QString& errorString);
+
+	//! Emitted when the export was cancelled (no file is left behind)
+	void cancelled();
+
+private:
+	Q_DISABLE_COPY(ChatExporter)
+
+	struct Run;
+
+	//! Result of a worker run, delivered on the exporter's thread
+	void onWorkerDone(int generation, int result, const QString& fileName, const QString& errorString);
+
+	QThreadPool* _pool;
+
+	//! Cancellation flag and completion shared with the running worker (null when idle)
+	QSharedPointer<Run> _run;
+
+	//! Bumped by every start(); stale worker posts are ignored
+	int _generation;
+};
+
+#endif // QT_CHATEXPORTER_H
@@ -0,0 +1,92 @@
+/**
+ * File: qtChatFragmentCache.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 16/02/2026| Tian-Qing Ye   | Created: LRU cache of parsed markdown fragments
+ * 02/03/2026| Tian-Qing Ye   | Added contains/insert for fragments parsed off the GUI thread
+ */
+#include "qtChatFragmentCache.h"
+#include <QFont>
+#include <QTextCharFormat>
+#include <QTextDocument>
+#include <QTextCursor>
+
+ChatFragmentCache::ChatFragmentCache(int maxCost)
+	: _cache(maxCost)
+	, _hits(0)
+	, _misses(0)
+{
+}
+
+ChatFragmentCache::Key ChatFragmentCache::makeKey(const QString& markdown, const QFont& font, const QTextCharFormat& style)
+{
+	Key key;
+
+	// Two differently seeded 32-bit hashes plus the length keep collisions negligible
+	key.contentHash = (quint64(qHash(markdown, 0x9e3779b9U)) << 32) | qHash(markdown, 0x85ebca6bU);
+	key.length = markdown.size();
+	key.fontKey = font.key();
+
+	// Sender style: foreground colour, italic and weight
+	key.styleKey = (quint64(style.foreground().color().rgba()) << 32)
+		| (quint64(style.fontItalic() ? 1 : 0) << 16)
+		| quint64(style.fontWeight());
+
+	return key;
+}
+
+QTextDocumentFragment ChatFragmentCache::parse(const QString& markdown, const QFont& font)
+{
+	QTextDocument tempDoc;
+	tempDoc.setDefaultFont(font);
+	tempDoc.setMarkdown(markdown);
+
+	// Select the whole document so it can be merged into the chat display
+	QTextCursor tempCursor(&tempDoc);
+	tempCursor.select(QTextCursor::Document);
+	return tempCursor.selection();
+}
+
+QTextDocumentFragment ChatFragmentCache::fragment(const QString& markdown, const QFont& font, const QTextCharFormat& style)
+{
+	const Key key = makeKey(markdown, font, style);
+
+	// QCache::object() also marks the entry as most recently used
+	if (QTextDocumentFragment* cached = _cache.object(key)) {
+		++_hits;
+		return *cached;
+	}
+
+	++_misses;
+	QTextDocumentFragment parsed = parse(markdown, font);
+	_cache.insert(key, new QTextDocumentFragment(parsed), qMax(1, markdown.size()));
+	return parsed;
+}
+
+bool ChatFragmentCache::contains(const QString& markdown, const QFont& font, const QTextCharFormat& style) const
+{
+	return _cache.contains(makeKey(markdown, font, style));
+}
+
+void ChatFragmentCache::insert(const QString& markdown, const QFont& font, const QTextCharFormat& style, const QTextDocumentFragment& fragment)
+{
+	_cache.insert(makeKey(markdown, font, style), new QTextDocumentFragment(fragment), qMax(1, markdown.size()));
+}
+
+void ChatFragmentCache::setMaxCost(int maxCost)
+{
+	_cache.setMaxCost(maxCost);
+}
+
+ChatFragmentCacheStats ChatFragmentCache::stats() const
+{
+	ChatFragmentCacheStats stats;
+	stats.hits = _hits;
+	stats.misses = _misses;
+	stats.entries = _cache.count();
+	stats.cost = _cache.totalCost();
+	stats.maxCost = _cache.maxCost();
+	return stats;
+}
@@ -0,0 +1,107 @@
+/**
+ * File: qtChatFragmentCache.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 16/02/2026| Tian-Qing Ye  | Created: LRU cache of parsed markdown fragments
+ * 02/03/2026| Tian-Qing Ye  | Added contains/insert for fragments parsed off the GUI thread
+ */
+#ifndef QT_CHATFRAGMENTCACHE_H
+#define QT_CHATFRAGMENTCACHE_H
+
+#include <QCache>
+#include <QString>
+#include <QHash>
+#include <QTextDocumentFragment>
+
+// Forward declarations
+class QFont;
+class QTextCharFormat;
+
+/**
+ * \brief Hit/miss counters of a ChatFragmentCache
+ */
+struct ChatFragmentCacheStats
+{
+	qint64 hits = 0;	// Lookups served from the cache
+	qint64 misses = 0;	// Lookups that had to parse markdown
+	int entries = 0;	// Fragments currently cached
+	int cost = 0;		// Total cost (characters of markdown) currently cached
+	int maxCost = 0;	// Size bound
+};
+
+/**
+ * \brief Cache of parsed markdown fragments
+ *
+ * Fragments are keyed by a hash of the message content, the display font and
+ * the sender style, so re-rendering an unchanged message never parses its
+ * markdown again. The cache is bounded by the total length of the cached
+ * markdown and evicts the least recently used fragments first.
+ */
+class ChatFragmentCache
+{
+public:
+	//! Default size bound, in characters of cached markdown
+	static const int DefaultMaxCost = 8 * 1024 * 1024;
+
+	explicit ChatFragmentCache(int maxCost = DefaultMaxCost);
+
+	/**
+	 * \brief Get the parsed fragment of a message, parsing it on a miss
+	 * \param markdown The message content
+	 * \param font The display font
+	 * \param style The body format of the sender
+	 */
+	QTextDocumentFragment fragment(const QString& markdown, const QFont& font, const QTextCharFormat& style);
+
+	//! Parse markdown into a fragment without touching the cache (safe on any thread)
+	static QTextDocumentFragment parse(const QString& markdown, const QFont& font);
+
+	//! Check for a cached fragment without counting a hit or touching the LRU order
+	bool contains(const QString& markdown, const QFont& font, const QTextCharFormat& style) const;
+
+	//! Add a fragment parsed elsewhere (e.g. on a worker thread)
+	void insert(const QString& markdown, const QFont& font, const QTextCharFormat& style, const QTextDocumentFragment& fragment);
+
+	//! Set the size bound (characters of cached markdown)
+	void setMaxCost(int maxCost);
+	int maxCost() const { return _cache.maxCost(); }
+
+	//! Drop all cached fragments (counters are kept)
+	void clear() { _cache.clear(); }
+
+	//! Current counters
+	ChatFragmentCacheStats stats() const;
+
+	//! Reset the hit/miss counters
+	void resetStats() { _hits = 0; _misses = 0; }
+
+private:
+	Q_DISABLE_COPY(ChatFragmentCache)
+
+	struct Key
+	{
+		quint64 contentHash;
+		int length;
+		QString fontKey;
+		quint64 styleKey;
+
+		bool operator==(const Key& other) const {
+			return contentHash == other.contentHash && length == other.length
+				&& styleKey == other.styleKey && fontKey == other.fontKey;
+		}
+	};
+
+	friend uint qHash(const Key& key, uint seed) {
+		return qHash(key.contentHash, seed) ^ qHash(key.fontKey, seed) ^ qHash(key.styleKey, seed) ^ uint(key.length);
+	}
+
+	static Key makeKey(const QString& markdown, const QFont& font, const QTextCharFormat& style);
+
+	QCache<Key, QTextDocumentFragment> _cache;
+	qint64 _hits;
+	qint64 _misses;
+};
+
+#endif // QT_CHATFRAGMENTCACHE_H
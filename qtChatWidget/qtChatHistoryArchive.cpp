@@ -0,0 +1,175 @@
+/**
+ * File: qtChatHistoryArchive.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 01/06/2026| Tian-Qing Ye   | Created: archive interface and compressed in-memory archive
+ * 16/10/2026| Tian-Qing Ye   | ChatCompressedArchive moves older blocks to a temporary file
+ */
+#include "qtChatHistoryArchive.h"
+#include <QDataStream>
+#include <QMutexLocker>
+
+namespace
+{
+	//! zlib level: chat text compresses well already at a fast level
+	const int kCompressionLevel = 6;
+
+	QByteArray encodeBlock(const QVector<ChatLogRecord>& records)
+	{
+		QByteArray bytes;
+		QDataStream out(&bytes, QIODevice::WriteOnly);
+		out << qint32(records.size());
+		for (const ChatLogRecord& record : records) {
+			out << record.timestamp << quint8(record.role)
+				<< record.sender << record.message << record.rawTimestamp << record.rawRole;
+		}
+		return qCompress(bytes, kCompressionLevel);
+	}
+
+	QVector<ChatLogRecord> decodeBlock(const QByteArray& block)
+	{
+		const QByteArray bytes = qUncompress(block);
+		QDataStream in(bytes);
+
+		qint32 count = 0;
+		in >> count;
+		QVector<ChatLogRecord> records(qMax(0, count));
+		for (ChatLogRecord& record : records) {
+			quint8 role = 0;
+			in >> record.timestamp >> role
+				>> record.sender >> record.message >> record.rawTimestamp >> record.rawRole;
+			record.role = ChatRole(role);
+		}
+		return records;
+	}
+}
+
+ChatCompressedArchive::ChatCompressedArchive(int blockRecords, int memoryBlocks)
+	: _blockRecords(qMax(1, blockRecords))
+	, _memoryBlocks(qMax(1, memoryBlocks))
+	, _cachedBlock(-1)
+{
+}
+
+int ChatCompressedArchive::size() const
+{
+	QMutexLocker locker(&_mutex);
+	const int fileBlocks = qMax(0, _fileOffsets.size() - 1);
+	return (fileBlocks + _blocks.size()) * _blockRecords + _open.size();
+}
+
+bool ChatCompressedArchive::append(const ChatLogRecord& record)
+{
+	QMutexLocker locker(&_mutex);
+
+	_open.append(record);
+	if (_open.size() == _blockRecords) {
+		sealOpenBlock();
+	}
+	return true;
+}
+
+void ChatCompressedArchive::sealOpenBlock()
+{
+	QByteArray block = encodeBlock(_open);
+	block.squeeze();
+	_blocks.append(block);
+	_open.clear();
+
+	if (_blocks.size() > _memoryBlocks) {
+		spillBlocks();
+	}
+}
+
+void ChatCompressedArchive::spillBlocks()
+{
+	if (!_file.isOpen() && !_file.open()) return;
+
+	if (_fileOffsets.isEmpty()) {
+		_fileOffsets.append(0);
+	}
+
+	// Blocks leave memory oldest first; one that cannot be written stays, as do the ones after it
+	int moved = 0;
+	while (_blocks.size() - moved > _memoryBlocks) {
+		const QByteArray& block = _blocks.at(moved);
+		if (!_file.seek(_fileOffsets.last()) || _file.write(block) != block.size()) break;
+		_fileOffsets.append(_fileOffsets.last() + block.size());
+		++moved;
+	}
+	_blocks.remove(0, moved);
+}
+
+QByteArray ChatCompressedArchive::blockAt(int block) const
+{
+	const int fileBlocks = qMax(0, _fileOffsets.size() - 1);
+	if (block >= fileBlocks) {
+		return _blocks.at(block - fileBlocks);
+	}
+
+	const qint64 offset = _fileOffsets.at(block);
+	if (!_file.seek(offset)) return QByteArray();
+	return _file.read(_fileOffsets.at(block + 1) - offset);
+}
+
+bool ChatCompressedArchive::clear()
+{
+	QMutexLocker locker(&_mutex);
+
+	_blocks.clear();
+	_open.clear();
+	_fileOffsets.clear();
+	if (_file.isOpen()) {
+		_file.resize(0);
+	}
+	_cachedBlock = -1;
+	_cached.clear();
+	return true;
+}
+
+ChatLogRecord ChatCompressedArchive::read(int index) const
+{
+	QMutexLocker locker(&_mutex);
+
+	const int block = index / _blockRecords;
+	const int offset = index % _blockRecords;
+	const int blocks = qMax(0, _fileOffsets.size() - 1) + _blocks.size();
+	if (index < 0 || block > blocks) return ChatLogRecord();
+
+	if (block == blocks) {
+		return (offset < _open.size()) ? _open.at(offset) : ChatLogRecord();
+	}
+
+	if (block != _cachedBlock) {
+		_cached = decodeBlock(blockAt(block));
+		_cachedBlock = block;
+	}
+	return (offset < _cached.size()) ? _cached.at(offset) : ChatLogRecord();
+}
+
+qint64 ChatCompressedArchive::memoryUsage() const
+{
+	QMutexLocker locker(&_mutex);
+
+	// Blocks in the file cost their offset only
+	qint64 bytes = qint64(_fileOffsets.capacity()) * sizeof(qint64);
+	bytes += qint64(_blocks.capacity()) * sizeof(QByteArray);
+	for (const QByteArray& block : _blocks) {
+		bytes += block.capacity();
+	}
+
+	// The open block and the decompressed one are bounded by the block size
+	auto recordBytes = [](const ChatLogRecord& record) {
+		return qint64(sizeof(ChatLogRecord)) + (record.sender.capacity() + record.message.capacity()
+			+ record.rawTimestamp.capacity() + record.rawRole.capacity()) * qint64(sizeof(QChar));
+	};
+	for (const ChatLogRecord& record : _open) {
+		bytes += recordBytes(record);
+	}
+	for (const ChatLogRecord& record : _cached) {
+		bytes += recordBytes(record);
+	}
+	return bytes;
+}
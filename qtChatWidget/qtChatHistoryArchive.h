@@ -0,0 +1,132 @@
+/**
+ * File: qtChatHistoryArchive.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 01/06/2026| Tian-Qing Ye  | Created: archive interface and compressed in-memory archive
+ * 16/10/2026| Tian-Qing Ye  | ChatCompressedArchive moves older blocks to a temporary file
+ */
+#ifndef QT_CHATHISTORYARCHIVE_H
+#define QT_CHATHISTORYARCHIVE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QMutex>
+#include <QTemporaryFile>
+#include "qtChatHistoryStore.h"
+
+/**
+ * \brief One message as read back from an archive
+ */
+struct ChatLogRecord
+{
+	qint64 timestamp = -1;		// Wall-clock ms counted as UTC, -1 if kept verbatim in rawTimestamp
+	ChatRole role = ChatRole::Other;
+	QString sender;
+	QString message;
+	QString rawTimestamp;		// Only set when the timestamp did not parse
+	QString rawRole;			// Only set for ChatRole::Other
+};
+
+/**
+ * \brief Append-only store of the messages a ChatHistoryStore no longer keeps resident
+ *
+ * Implemented by ChatHistoryLog (on disk) and ChatCompressedArchive (in
+ * memory, spilling to a temporary file). Implementations are thread safe: workers read through snapshots
+ * of the store while the GUI thread appends.
+ */
+class ChatHistoryArchive
+{
+public:
+	virtual ~ChatHistoryArchive() {}
+
+	//! Number of records
+	virtual int size() const = 0;
+
+	//! Append one record
+	virtual bool append(const ChatLogRecord& record) = 0;
+
+	//! Remove all records
+	virtual bool clear() = 0;
+
+	//! Read back a whole record
+	virtual ChatLogRecord read(int index) const = 0;
+
+	//! Timestamp of a record
+	virtual qint64 timestampAt(int index) const { return read(index).timestamp; }
+
+	//! Role of a record
+	virtual ChatRole roleAt(int index) const { return read(index).role; }
+
+	//! Path of the backing file (empty for an archive held in memory)
+	virtual QString path() const { return QString(); }
+
+	//! Heap memory held by the archive, in bytes (a mapped file counts as none)
+	virtual qint64 memoryUsage() const { return 0; }
+};
+
+/**
+ * \brief Archive held in memory, compressed in blocks of records
+ *
+ * Records are gathered into blocks of a fixed number of records, and every
+ * full block is serialized and compressed (zlib) at once, so chat text costs
+ * a fraction of its resident size. Reading a record decompresses its block;
+ * the last block read is kept, as callers tend to read neighbouring records.
+ *
+ * Only the newest memoryBlocks blocks stay in memory. Older ones are written
+ * to an anonymous temporary file (removed with the archive) and read back
+ * from there, so memory stays constant but for the file offset of every
+ * moved block. If the file cannot be written, blocks stay in memory.
+ */
+class ChatCompressedArchive : public ChatHistoryArchive
+{
+public:
+	//! Records per compressed block
+	static const int DefaultBlockRecords = 64;
+
+	//! Compressed blocks kept in memory
+	static const int DefaultMemoryBlocks = 16;
+
+	explicit ChatCompressedArchive(int blockRecords = DefaultBlockRecords, int memoryBlocks = DefaultMemoryBlocks);
+
+	int size() const override;
+	bool append(const ChatLogRecord& record) override;
+	bool clear() override;
+	ChatLogRecord read(int index) const override;
+	qint64 memoryUsage() const override;
+
+private:
+	Q_DISABLE_COPY(ChatCompressedArchive)
+
+	//! Compress the open block and start a new one; the mutex must be held
+	void sealOpenBlock();
+
+	//! Move the oldest blocks held in memory to the file; the mutex must be held
+	void spillBlocks();
+
+	//! Compressed bytes of a full block; the mutex must be held
+	QByteArray blockAt(int block) const;
+
+	int _blockRecords;
+	int _memoryBlocks;
+
+	//! Full blocks moved to the file, and their offsets there (one more than blocks: the end)
+	mutable QTemporaryFile _file;
+	QVector<qint64> _fileOffsets;
+
+	//! Full blocks held in memory, compressed (they follow the ones in the file)
+	QVector<QByteArray> _blocks;
+
+	//! Records of the block being filled
+	QVector<ChatLogRecord> _open;
+
+	//! The block last decompressed by read() (-1 if none)
+	mutable int _cachedBlock;
+	mutable QVector<ChatLogRecord> _cached;
+
+	mutable QMutex _mutex;
+};
+
+#endif // QT_CHATHISTORYARCHIVE_H
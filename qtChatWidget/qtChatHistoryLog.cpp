@@ -0,0 +1,361 @@
+/**
+ * File: qtChatHistoryLog.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 30/03/2026| Tian-Qing Ye   | Created: append-only on-disk chat history
+ * 16/10/2026| Tian-Qing Ye   | Timestamps are wall-clock times counted as UTC, as ChatHistoryStore keeps them
+ */
+#include "qtChatHistoryLog.h"
+#include <QMutexLocker>
+#include <QtEndian>
+#include <cstring>
+
+namespace
+{
+	const char kLogMagic[] = "QCHATLOG";
+	const char kIndexMagic[] = "QCHATIDX";
+	const quint32 kFormatVersion = 1;
+
+	//! Magic (8 bytes), version (4 bytes), reserved (4 bytes)
+	const qint64 kFileHeaderSize = 16;
+
+	/*
+	 * Record layout (little endian):
+	 *   0  quint32  record size, header included
+	 *   4  qint64   timestamp (wall-clock ms counted as UTC, -1 if verbatim)
+	 *  12  quint8   role, then 3 bytes padding
+	 *  16  quint32  UTF-8 bytes of sender, message, raw timestamp, raw role
+	 *  32  the four strings back to back
+	 */
+	const qint64 kRecordHeaderSize = 32;
+	const int kStringCount = 4;
+
+	quint32 stringBytes(const uchar* record, int field)
+	{
+		return qFromLittleEndian<quint32>(record + 16 + 4 * field);
+	}
+
+	//! Check that the header of a record is consistent with its size
+	bool isValidRecord(const uchar* record, qint64 available)
+	{
+		if (available < kRecordHeaderSize) {
+			return false;
+		}
+
+		const quint32 size = qFromLittleEndian<quint32>(record);
+		qint64 expected = kRecordHeaderSize;
+		for (int field = 0; field < kStringCount; ++field) {
+			expected += stringBytes(record, field);
+		}
+		return size == expected && size <= available;
+	}
+}
+
+ChatHistoryLog::ChatHistoryLog()
+	: _count(0)
+	, _end(0)
+	, _logMap(nullptr)
+	, _logMapped(0)
+	, _indexMap(nullptr)
+	, _indexMapped(0)
+{
+}
+
+ChatHistoryLog::~ChatHistoryLog()
+{
+	close();
+}
+
+bool ChatHistoryLog::open(const QString& path)
+{
+	close();
+
+	QMutexLocker locker(&_mutex);
+
+	// Leave the log closed on any failure
+	auto fail = [this](const QString& error) {
+		_error = error;
+		unmap();
+		_log.close();
+		_index.close();
+		_count = 0;
+		_end = 0;
+		return false;
+	};
+
+	_log.setFileName(path);
+	_index.setFileName(path + ".idx");
+	if (!_log.open(QIODevice::ReadWrite)) {
+		return fail(QString("Cannot open %1: %2").arg(path, _log.errorString()));
+	}
+	if (!_index.open(QIODevice::ReadWrite)) {
+		return fail(QString("Cannot open %1: %2").arg(_index.fileName(), _index.errorString()));
+	}
+
+	// New log, or check that an existing one is ours
+	if (_log.size() == 0) {
+		if (!writeHeader(_log, kLogMagic)) return fail(_error);
+	}
+	else {
+		const QByteArray header = _log.read(kFileHeaderSize);
+		if (header.size() != kFileHeaderSize || !header.startsWith(kLogMagic)
+			|| qFromLittleEndian<quint32>(header.constData() + 8) != kFormatVersion) {
+			return fail(QString("%1 is not a chat history log").arg(path));
+		}
+	}
+
+	// A missing or foreign index is rebuilt from the log
+	const QByteArray indexHeader = _index.read(kFileHeaderSize);
+	if (indexHeader.size() != kFileHeaderSize || !indexHeader.startsWith(kIndexMagic)) {
+		if (!_index.resize(0) || !writeHeader(_index, kIndexMagic)) return fail(_index.errorString());
+	}
+
+	_count = int((_index.size() - kFileHeaderSize) / qint64(sizeof(qint64)));
+	if (!recover()) {
+		return fail(_error);
+	}
+
+	return true;
+}
+
+bool ChatHistoryLog::writeHeader(QFile& file, const char* magic)
+{
+	QByteArray header(kFileHeaderSize, '\0');
+	std::memcpy(header.data(), magic, 8);
+	qToLittleEndian<quint32>(kFormatVersion, header.data() + 8);
+
+	if (!file.seek(0) || file.write(header) != header.size()) {
+		_error = file.errorString();
+		return false;
+	}
+	return true;
+}
+
+bool ChatHistoryLog::recover()
+{
+	if (!remap()) {
+		_error = QString("Cannot map %1").arg(_log.fileName());
+		return false;
+	}
+
+	// Drop index entries that point past the end of the log (index written, record lost)
+	const qint64 logSize = _logMapped;
+	while (_count > 0) {
+		const qint64 offset = offsetAt(_count - 1);
+		if (offset >= kFileHeaderSize && offset < logSize && isValidRecord(_logMap + offset, logSize - offset)) {
+			_end = offset + qFromLittleEndian<quint32>(_logMap + offset);
+			break;
+		}
+		--_count;
+	}
+	if (_count == 0) {
+		_end = kFileHeaderSize;
+	}
+
+	// Mapped files cannot be truncated on every platform
+	unmap();
+	if (!_index.resize(kFileHeaderSize + qint64(_count) * sizeof(qint64)) || !_index.seek(_index.size())) {
+		_error = _index.errorString();
+		return false;
+	}
+
+	// Index complete records appended after the last index entry (record written, index lost)
+	if (!remap()) {
+		_error = QString("Cannot map %1").arg(_log.fileName());
+		return false;
+	}
+	while (isValidRecord(_logMap + _end, logSize - _end)) {
+		uchar entry[sizeof(qint64)];
+		qToLittleEndian<qint64>(_end, entry);
+		_index.write(reinterpret_cast<const char*>(entry), sizeof(entry));
+		_end += qFromLittleEndian<quint32>(_logMap + _end);
+		++_count;
+	}
+
+	// Cut a truncated trailing record
+	unmap();
+	if (!_index.flush() || (_end != logSize && !_log.resize(_end))) {
+		_error = _log.errorString();
+		return false;
+	}
+
+	return remap();
+}
+
+void ChatHistoryLog::close()
+{
+	QMutexLocker locker(&_mutex);
+
+	unmap();
+	_log.close();
+	_index.close();
+	_count = 0;
+	_end = 0;
+}
+
+bool ChatHistoryLog::isOpen() const
+{
+	QMutexLocker locker(&_mutex);
+	return _log.isOpen();
+}
+
+int ChatHistoryLog::size() const
+{
+	QMutexLocker locker(&_mutex);
+	return _count;
+}
+
+bool ChatHistoryLog::append(const ChatLogRecord& record)
+{
+	QMutexLocker locker(&_mutex);
+	if (!_log.isOpen()) return false;
+
+	const QByteArray strings[kStringCount] = {
+		record.sender.toUtf8(),
+		record.message.toUtf8(),
+		record.rawTimestamp.toUtf8(),
+		record.rawRole.toUtf8()
+	};
+
+	qint64 size = kRecordHeaderSize;
+	for (const QByteArray& string : strings) {
+		size += string.size();
+	}
+
+	QByteArray buffer(int(size), '\0');
+	uchar* data = reinterpret_cast<uchar*>(buffer.data());
+	qToLittleEndian<quint32>(quint32(size), data);
+	qToLittleEndian<qint64>(record.timestamp, data + 4);
+	data[12] = uchar(record.role);
+
+	uchar* out = data + kRecordHeaderSize;
+	for (int field = 0; field < kStringCount; ++field) {
+		qToLittleEndian<quint32>(quint32(strings[field].size()), data + 16 + 4 * field);
+		std::memcpy(out, strings[field].constData(), strings[field].size());
+		out += strings[field].size();
+	}
+
+	uchar entry[sizeof(qint64)];
+	qToLittleEndian<qint64>(_end, entry);
+
+	// Record first, then its index entry: a crash in between is repaired by recover()
+	if (!_log.seek(_end) || _log.write(buffer) != buffer.size() || !_log.flush()
+		|| !_index.seek(kFileHeaderSize + qint64(_count) * sizeof(qint64))
+		|| _index.write(reinterpret_cast<const char*>(entry), sizeof(entry)) != sizeof(entry) || !_index.flush()) {
+		_error = _log.error() != QFile::NoError ? _log.errorString() : _index.errorString();
+		return false;
+	}
+
+	_end += size;
+	++_count;
+	return true;
+}
+
+bool ChatHistoryLog::clear()
+{
+	QMutexLocker locker(&_mutex);
+	if (!_log.isOpen()) return false;
+
+	// Mapped files cannot be truncated on every platform
+	unmap();
+	if (!_log.resize(kFileHeaderSize) || !_index.resize(kFileHeaderSize)) {
+		_error = _log.errorString();
+		return false;
+	}
+
+	_count = 0;
+	_end = kFileHeaderSize;
+	return true;
+}
+
+ChatLogRecord ChatHistoryLog::read(int index) const
+{
+	QMutexLocker locker(&_mutex);
+
+	ChatLogRecord record;
+	const uchar* data = recordAt(index);
+	if (!data) return record;
+
+	record.timestamp = qFromLittleEndian<qint64>(data + 4);
+	record.role = ChatRole(data[12]);
+
+	QString* strings[kStringCount] = { &record.sender, &record.message, &record.rawTimestamp, &record.rawRole };
+	const char* in = reinterpret_cast<const char*>(data + kRecordHeaderSize);
+	for (int field = 0; field < kStringCount; ++field) {
+		const int bytes = int(stringBytes(data, field));
+		*strings[field] = QString::fromUtf8(in, bytes);
+		in += bytes;
+	}
+
+	return record;
+}
+
+qint64 ChatHistoryLog::timestampAt(int index) const
+{
+	QMutexLocker locker(&_mutex);
+	const uchar* data = recordAt(index);
+	return data ? qFromLittleEndian<qint64>(data + 4) : -1;
+}
+
+ChatRole ChatHistoryLog::roleAt(int index) const
+{
+	QMutexLocker locker(&_mutex);
+	const uchar* data = recordAt(index);
+	return data ? ChatRole(data[12]) : ChatRole::Other;
+}
+
+qint64 ChatHistoryLog::offsetAt(int index) const
+{
+	const qint64 position = kFileHeaderSize + qint64(index) * sizeof(qint64);
+	if (position + qint64(sizeof(qint64)) > _indexMapped && !remap()) {
+		return -1;
+	}
+	return qFromLittleEndian<qint64>(_indexMap + position);
+}
+
+const uchar* ChatHistoryLog::recordAt(int index) const
+{
+	if (index < 0 || index >= _count) return nullptr;
+
+	const qint64 offset = offsetAt(index);
+	if (offset < 0) return nullptr;
+
+	// Records appended since the last map are picked up by mapping again
+	if (offset + kRecordHeaderSize > _logMapped
+		|| offset + qFromLittleEndian<quint32>(_logMap + offset) > _logMapped) {
+		if (!remap() || offset + kRecordHeaderSize > _logMapped) return nullptr;
+	}
+	return _logMap + offset;
+}
+
+bool ChatHistoryLog::remap() const
+{
+	unmap();
+
+	_logMapped = _log.size();
+	_logMap = _log.map(0, _logMapped);
+	_indexMapped = _index.size();
+	_indexMap = _index.map(0, _indexMapped);
+
+	if (!_logMap || !_indexMap) {
+		unmap();
+		return false;
+	}
+	return true;
+}
+
+void ChatHistoryLog::unmap() const
+{
+	if (_logMap) {
+		_log.unmap(_logMap);
+		_logMap = nullptr;
+	}
+	if (_indexMap) {
+		_index.unmap(_indexMap);
+		_indexMap = nullptr;
+	}
+	_logMapped = 0;
+	_indexMapped = 0;
+}
@@ -0,0 +1,111 @@
+/**
+ * File: qtChatHistoryLog.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 30/03/2026| Tian-Qing Ye  | Created: append-only on-disk chat history
+ * 01/06/2026| Tian-Qing Ye  | Implements ChatHistoryArchive (ChatLogRecord moved there)
+ */
+#ifndef QT_CHATHISTORYLOG_H
+#define QT_CHATHISTORYLOG_H
+
+#include <QString>
+#include <QFile>
+#include <QMutex>
+#include "qtChatHistoryArchive.h"
+
+/**
+ * \brief Append-only on-disk log of chat messages
+ *
+ * Two files: the record log itself (path) and an offset index (path + ".idx")
+ * holding the file offset of every record. Both are read through memory maps,
+ * so fetching message i is one index lookup plus decoding the record in
+ * place, and the resident size of the log does not grow with its length.
+ *
+ * On open, records written after the last index entry (e.g. after a crash)
+ * are re-indexed and a truncated trailing record is dropped.
+ *
+ * All methods are thread safe.
+ */
+class ChatHistoryLog : public ChatHistoryArchive
+{
+public:
+	ChatHistoryLog();
+	~ChatHistoryLog() override;
+
+	/**
+	 * \brief Open or create a log
+	 * \param path Path of the record log; the index lives next to it
+	 * \return false if the files cannot be opened or are not chat logs (see errorString())
+	 */
+	bool open(const QString& path);
+
+	//! Close the files
+	void close();
+
+	bool isOpen() const;
+
+	//! Path of the record log
+	QString path() const override { return _log.fileName(); }
+
+	//! Reason of the last failure
+	QString errorString() const { return _error; }
+
+	//! Number of records
+	int size() const override;
+
+	//! Append one record (written through to disk)
+	bool append(const ChatLogRecord& record) override;
+
+	//! Remove all records
+	bool clear() override;
+
+	//! Read back a whole record
+	ChatLogRecord read(int index) const override;
+
+	//! Timestamp of a record, without decoding its strings
+	qint64 timestampAt(int index) const override;
+
+	//! Role of a record, without decoding its strings
+	ChatRole roleAt(int index) const override;
+
+private:
+	Q_DISABLE_COPY(ChatHistoryLog)
+
+	//! Pointer to a record (nullptr if out of range); the mutex must be held
+	const uchar* recordAt(int index) const;
+
+	//! File offset of a record, read from the mapped index; the mutex must be held
+	qint64 offsetAt(int index) const;
+
+	//! Map both files again after they grew past the mapped range
+	bool remap() const;
+	void unmap() const;
+
+	//! Index records past the last indexed one and drop a truncated tail
+	bool recover();
+
+	//! Write the file header of an empty log or index
+	bool writeHeader(QFile& file, const char* magic);
+
+	//! Files are remapped lazily from const readers
+	mutable QFile _log;
+	mutable QFile _index;
+
+	//! Number of records
+	int _count;
+
+	//! End of the last complete record
+	qint64 _end;
+
+	mutable uchar* _logMap;
+	mutable qint64 _logMapped;
+	mutable uchar* _indexMap;
+	mutable qint64 _indexMapped;
+
+	mutable QMutex _mutex;
+	QString _error;
+};
+
+#endif // QT_CHATHISTORYLOG_H
@@ -0,0 +1,382 @@
+/**
+ * File: qtChatHistoryStore.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 09/03/2026| Tian-Qing Ye   | Created: compact storage for the chat history
+ * 30/03/2026| Tian-Qing Ye   | Optional on-disk log; only a recent window stays resident
+ * 01/06/2026| Tian-Qing Ye   | Backed by any ChatHistoryArchive (on-disk log or compressed memory)
+ * 16/10/2026| Tian-Qing Ye   | Timestamps are wall-clock times counted as UTC: no DST shift
+ */
+#include "qtChatHistoryStore.h"
+#include "qtChatHistoryArchive.h"
+#include "qtChatWidget.h"
+#include <QDateTime>
+
+const char* const ChatHistoryStore::TimestampFormat = "yyyy-MM-dd hh:mm:ss";
+
+namespace
+{
+	//! Parse a fixed number of ASCII digits, -1 on anything else
+	int parseDigits(const QString& text, int pos, int count)
+	{
+		int value = 0;
+		for (int i = pos; i < pos + count; ++i) {
+			const ushort c = text.at(i).unicode();
+			if (c < '0' || c > '9') {
+				return -1;
+			}
+			value = value * 10 + (c - '0');
+		}
+		return value;
+	}
+
+	//! Timestamp string of a record read back from the log
+	QString logTimestampString(const ChatLogRecord& record)
+	{
+		if (record.timestamp < 0) {
+			return record.rawTimestamp;
+		}
+		return QDateTime::fromMSecsSinceEpoch(record.timestamp, Qt::UTC).toString(ChatHistoryStore::TimestampFormat);
+	}
+
+	//! Role string of a record read back from the log
+	QString logRoleString(const ChatLogRecord& record)
+	{
+		return (record.role == ChatRole::Other) ? record.rawRole : ChatHistoryStore::roleToString(record.role);
+	}
+}
+
+ChatHistoryStore::ChatHistoryStore()
+	: _first(0)
+	, _persisted(0)
+{
+}
+
+ChatRole ChatHistoryStore::roleFromString(const QString& role)
+{
+	if (role == QLatin1String("user")) {
+		return ChatRole::User;
+	}
+	else if (role == QLatin1String("assistant")) {
+		return ChatRole::Assistant;
+	}
+	else if (role == QLatin1String("system")) {
+		return ChatRole::System;
+	}
+	return ChatRole::Other;
+}
+
+QString ChatHistoryStore::roleToString(ChatRole role)
+{
+	switch (role) {
+	case ChatRole::User:
+		return QStringLiteral("user");
+	case ChatRole::Assistant:
+		return QStringLiteral("assistant");
+	default:
+		return QStringLiteral("system");
+	}
+}
+
+qint64 ChatHistoryStore::parseTimestamp(const QString& timestamp)
+{
+	// Fast path for the fixed "yyyy-MM-dd hh:mm:ss" layout
+	if (timestamp.size() != 19 || timestamp.at(4) != '-' || timestamp.at(7) != '-'
+		|| timestamp.at(10) != ' ' || timestamp.at(13) != ':' || timestamp.at(16) != ':') {
+		return -1;
+	}
+
+	const QDate date(parseDigits(timestamp, 0, 4), parseDigits(timestamp, 5, 2), parseDigits(timestamp, 8, 2));
+	const QTime time(parseDigits(timestamp, 11, 2), parseDigits(timestamp, 14, 2), parseDigits(timestamp, 17, 2));
+	if (!date.isValid() || !time.isValid()) {
+		return -1;
+	}
+
+	// UTC has no gaps or overlaps: every wall-clock time maps to one timestamp and back
+	return QDateTime(date, time, Qt::UTC).toMSecsSinceEpoch();
+}
+
+qint64 ChatHistoryStore::currentTimestamp()
+{
+	QDateTime now = QDateTime::currentDateTime();
+	now.setTimeSpec(Qt::UTC);	// Same date and time, read as UTC
+	return now.toMSecsSinceEpoch();
+}
+
+int ChatHistoryStore::senderId(const QString& sender)
+{
+	auto it = _senderIds.constFind(sender);
+	if (it != _senderIds.constEnd()) {
+		return it.value();
+	}
+
+	const int id = _senders.size();
+	_senders.append(sender);
+	_senderIds.insert(sender, id);
+	return id;
+}
+
+ChatMessage ChatHistoryStore::at(int index) const
+{
+	if (index < _first) {
+		const ChatLogRecord logged = _log->read(index);
+		return ChatMessage(logTimestampString(logged), logged.sender, logged.message, logRoleString(logged));
+	}
+	return ChatMessage(timestampStringAt(index), senderAt(index), messageStringAt(index), roleStringAt(index));
+}
+
+ChatRole ChatHistoryStore::roleAt(int index) const
+{
+	return (index < _first) ? _log->roleAt(index) : record(index).role;
+}
+
+qint64 ChatHistoryStore::timestampAt(int index) const
+{
+	return (index < _first) ? _log->timestampAt(index) : record(index).timestamp;
+}
+
+QString ChatHistoryStore::senderAt(int index) const
+{
+	return (index < _first) ? _log->read(index).sender : _senders.at(record(index).sender);
+}
+
+QString ChatHistoryStore::roleStringAt(int index) const
+{
+	if (index < _first) {
+		return logRoleString(_log->read(index));
+	}
+
+	const ChatRole role = record(index).role;
+	if (role == ChatRole::Other) {
+		return _rawRoles.value(index);
+	}
+	return roleToString(role);
+}
+
+QString ChatHistoryStore::timestampStringAt(int index) const
+{
+	if (index < _first) {
+		return logTimestampString(_log->read(index));
+	}
+
+	const qint64 timestamp = record(index).timestamp;
+	if (timestamp < 0) {
+		return _rawTimestamps.value(index);
+	}
+	return QDateTime::fromMSecsSinceEpoch(timestamp, Qt::UTC).toString(TimestampFormat);
+}
+
+QString ChatHistoryStore::displayTimeAt(int index) const
+{
+	const qint64 timestamp = timestampAt(index);
+	if (timestamp < 0) {
+		return timestampStringAt(index).mid(11, 8);
+	}
+	return QDateTime::fromMSecsSinceEpoch(timestamp, Qt::UTC).toString("hh:mm:ss");
+}
+
+QStringView ChatHistoryStore::messageAt(int index) const
+{
+	Q_ASSERT(isResident(index));
+	const Record& resident = record(index);
+	return QStringView(_arena).mid(resident.offset, resident.length);
+}
+
+QString ChatHistoryStore::messageStringAt(int index) const
+{
+	return (index < _first) ? _log->read(index).message : messageAt(index).toString();
+}
+
+void ChatHistoryStore::append(const ChatMessage& msg)
+{
+	const int index = size();
+
+	qint64 timestamp = parseTimestamp(msg.timestamp);
+	if (timestamp < 0 && !msg.timestamp.isEmpty()) {
+		_rawTimestamps.insert(index, msg.timestamp);
+	}
+
+	const ChatRole role = roleFromString(msg.role);
+	if (role == ChatRole::Other) {
+		_rawRoles.insert(index, msg.role);
+	}
+
+	append(timestamp, msg.sender, msg.message, role);
+}
+
+void ChatHistoryStore::append(qint64 timestamp, const QString& sender, const QString& message, ChatRole role)
+{
+	Record record;
+	record.timestamp = timestamp;
+	record.offset = _arena.size();
+	record.length = message.size();
+	record.sender = senderId(sender);
+	record.role = role;
+
+	_arena.append(message);
+	_records.append(record);
+}
+
+void ChatHistoryStore::appendToLast(const QString& text)
+{
+	if (_records.isEmpty() || text.isEmpty()) return;
+
+	Record& last = _records.last();
+
+	// The last message normally ends the arena, so growing it is a plain append
+	if (last.offset + last.length != _arena.size()) {
+		const QString content = messageStringAt(size() - 1);
+		last.offset = _arena.size();
+		_arena.append(content);
+	}
+
+	_arena.append(text);
+	last.length += text.size();
+}
+
+void ChatHistoryStore::assign(const QList<ChatMessage>& history)
+{
+	clear();
+
+	int characters = 0;
+	for (const ChatMessage& msg : history) {
+		characters += msg.message.size();
+	}
+	reserve(history.size(), characters);
+
+	for (const ChatMessage& msg : history) {
+		append(msg);
+	}
+}
+
+void ChatHistoryStore::reserve(int messages, int characters)
+{
+	_records.reserve(_records.size() + messages);
+	_arena.reserve(_arena.size() + characters);
+}
+
+void ChatHistoryStore::clearResident()
+{
+	_records.clear();
+	_arena.clear();
+	_rawTimestamps.clear();
+	_rawRoles.clear();
+
+	// Sender names are few; keeping them interned saves work on the next history
+}
+
+void ChatHistoryStore::clear()
+{
+	clearResident();
+	_first = 0;
+	_persisted = 0;
+
+	if (_log) {
+		_log->clear();
+	}
+}
+
+void ChatHistoryStore::attachLog(const QSharedPointer<ChatHistoryArchive>& log)
+{
+	// Page everything back in before letting go of the current log
+	if (_log && _first > 0) {
+		const QList<ChatMessage> all = toList();
+		_log.reset();
+		assign(all);
+	}
+
+	_log = log;
+	_persisted = 0;
+
+	// An existing conversation on disk becomes the content, read on demand
+	if (_log && _log->size() > 0) {
+		clearResident();
+		_first = _log->size();
+		_persisted = _first;
+	}
+}
+
+void ChatHistoryStore::persist(int end)
+{
+	if (!_log) return;
+
+	end = qMin(end, size());
+	for (int i = _persisted; i < end; ++i) {
+		const Record& resident = record(i);
+
+		ChatLogRecord logged;
+		logged.timestamp = resident.timestamp;
+		logged.role = resident.role;
+		logged.sender = _senders.at(resident.sender);
+		logged.message = messageAt(i).toString();
+		logged.rawTimestamp = _rawTimestamps.value(i);
+		logged.rawRole = _rawRoles.value(i);
+
+		// Retried on the next call if the disk is full or gone
+		if (!_log->append(logged)) break;
+		_persisted = i + 1;
+	}
+}
+
+void ChatHistoryStore::trimResident(int keep)
+{
+	if (!_log || _records.size() <= keep + keep / 2) return;
+
+	const int newFirst = qMin(size() - keep, _persisted);
+	if (newFirst <= _first) return;
+
+	// Shift the kept bodies to the front of the arena (once per keep/2 messages)
+	const int drop = newFirst - _first;
+	const int cut = (drop < _records.size()) ? _records.at(drop).offset : _arena.size();
+	_arena.remove(0, cut);
+	_records.remove(0, drop);
+	for (Record& resident : _records) {
+		resident.offset -= cut;
+	}
+
+	for (auto it = _rawTimestamps.begin(); it != _rawTimestamps.end();) {
+		it = (it.key() < newFirst) ? _rawTimestamps.erase(it) : it + 1;
+	}
+	for (auto it = _rawRoles.begin(); it != _rawRoles.end();) {
+		it = (it.key() < newFirst) ? _rawRoles.erase(it) : it + 1;
+	}
+
+	_first = newFirst;
+}
+
+QList<ChatMessage> ChatHistoryStore::range(int first, int count) const
+{
+	QList<ChatMessage> list;
+	const int end = qMin(size(), first + count);
+	for (int i = qMax(0, first); i < end; ++i) {
+		list.append(at(i));
+	}
+	return list;
+}
+
+QList<ChatMessage> ChatHistoryStore::toList() const
+{
+	return range(0, size());
+}
+
+qint64 ChatHistoryStore::memoryUsage() const
+{
+	qint64 bytes = qint64(_records.capacity()) * sizeof(Record);
+	bytes += qint64(_arena.capacity()) * sizeof(QChar);
+
+	for (const QString& sender : _senders) {
+		bytes += sizeof(QString) + sender.capacity() * sizeof(QChar);
+	}
+	bytes += qint64(_senderIds.size()) * (sizeof(QString) + sizeof(int) + 2 * sizeof(void*));
+
+	for (const QString& raw : _rawTimestamps) {
+		bytes += raw.capacity() * sizeof(QChar);
+	}
+	for (const QString& raw : _rawRoles) {
+		bytes += raw.capacity() * sizeof(QChar);
+	}
+
+	return bytes;
+}
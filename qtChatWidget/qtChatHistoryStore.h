@@ -0,0 +1,212 @@
+/**
+ * File: qtChatHistoryStore.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 09/03/2026| Tian-Qing Ye  | Created: compact storage for the chat history
+ * 30/03/2026| Tian-Qing Ye  | Optional on-disk log; only a recent window stays resident
+ * 01/06/2026| Tian-Qing Ye  | Backed by any ChatHistoryArchive (on-disk log or compressed memory)
+ * 16/10/2026| Tian-Qing Ye  | Timestamps are wall-clock times counted as UTC: no DST shift
+ */
+#ifndef QT_CHATHISTORYSTORE_H
+#define QT_CHATHISTORYSTORE_H
+
+#include <QString>
+#include <QStringView>
+#include <QVector>
+#include <QHash>
+#include <QList>
+#include <QSharedPointer>
+
+// Forward declarations
+struct ChatMessage;
+class ChatHistoryArchive;
+
+/**
+ * \brief Message role (OpenAI format)
+ */
+enum class ChatRole : quint8
+{
+	System,		// "system" (also used for notifications shown in the chat)
+	User,		// "user"
+	Assistant,	// "assistant"
+	Other		// Any other role string (kept verbatim)
+};
+
+/**
+ * \brief Compact storage for a chat history
+ *
+ * Every message is a fixed-size record: role as an enum, sender as an index
+ * into a table of interned names, and timestamp as a qint64 of milliseconds
+ * (formatted only when asked for). Message bodies live back to back in one
+ * contiguous arena string. All members are implicitly shared, so copying a
+ * store (e.g. as a snapshot for a worker thread) is O(1).
+ *
+ * A timestamp is the local wall-clock time of the message counted as if it
+ * were UTC, not a true instant since the epoch: "yyyy-MM-dd hh:mm:ss" text and
+ * its timestamp convert into each other exactly, whatever the time zone and
+ * across daylight saving changes (a time that does not exist or occurs twice
+ * in local time still reads back as written).
+ *
+ * at() and toList() still yield ChatMessage for compatibility.
+ *
+ * With an archive attached (an on-disk ChatHistoryLog or an in-memory
+ * ChatCompressedArchive), messages are written to it by persist() and
+ * trimResident() drops the oldest archived ones from memory. Indices stay the
+ * same: accessors of messages below firstResident() read them back from the
+ * archive.
+ */
+class ChatHistoryStore
+{
+public:
+	//! Format of ChatMessage::timestamp
+	static const char* const TimestampFormat;
+
+	ChatHistoryStore();
+
+	//! Number of messages (resident or not)
+	int size() const { return _first + _records.size(); }
+	bool isEmpty() const { return size() == 0; }
+
+	//! First message held in memory; older ones live only in the log
+	int firstResident() const { return _first; }
+	bool isResident(int index) const { return index >= _first; }
+
+	//! Message as a ChatMessage (builds the strings on the fly)
+	ChatMessage at(int index) const;
+
+	//! Role of a message
+	ChatRole roleAt(int index) const;
+
+	//! Role of a message as an OpenAI role string
+	QString roleStringAt(int index) const;
+
+	//! Wall-clock timestamp in milliseconds, counted as UTC (-1 if the original text did not parse)
+	qint64 timestampAt(int index) const;
+
+	//! Timestamp as "yyyy-MM-dd hh:mm:ss"
+	QString timestampStringAt(int index) const;
+
+	//! Time of day as "hh:mm:ss"
+	QString displayTimeAt(int index) const;
+
+	//! Sender name
+	QString senderAt(int index) const;
+
+	/**
+	 * \brief Message content, without copying (valid until the store is modified)
+	 *
+	 * Only for resident messages (see isResident()); use messageStringAt() otherwise.
+	 */
+	QStringView messageAt(int index) const;
+
+	//! Message content as a string (reads it back from the log if not resident)
+	QString messageStringAt(int index) const;
+
+	//! Messages [first, first + count) as ChatMessage structures
+	QList<ChatMessage> range(int first, int count) const;
+
+	//! Append a message given as a ChatMessage
+	void append(const ChatMessage& msg);
+
+	//! Append a message
+	void append(qint64 timestamp, const QString& sender, const QString& message, ChatRole role);
+
+	//! Append text to the content of the last message (e.g. streaming)
+	void appendToLast(const QString& text);
+
+	//! Replace the content with a list of messages
+	void assign(const QList<ChatMessage>& history);
+
+	//! Reserve room for more messages and message characters
+	void reserve(int messages, int characters);
+
+	//! Remove all messages (and empties the attached log)
+	void clear();
+
+	/**
+	 * \brief Back the store with an archive
+	 * \param log An open log or other archive, or null to detach
+	 *
+	 * A non-empty log becomes the content of the store (nothing of it is read
+	 * yet). An empty log receives the current content on the next persist().
+	 */
+	void attachLog(const QSharedPointer<ChatHistoryArchive>& log);
+
+	//! The attached log (null if none)
+	QSharedPointer<ChatHistoryArchive> log() const { return _log; }
+
+	//! Write messages [persisted, end) to the attached log
+	void persist(int end);
+
+	//! Number of messages already written to the attached log
+	int persistedCount() const { return _persisted; }
+
+	/**
+	 * \brief Bound the number of resident messages
+	 * \param keep Number of recent messages to keep in memory
+	 *
+	 * Only messages already in the log are dropped. Trimming waits until the
+	 * window has grown by half, so the cost is amortized O(1) per message.
+	 */
+	void trimResident(int keep);
+
+	//! All messages as ChatMessage structures
+	QList<ChatMessage> toList() const;
+
+	//! Approximate heap memory used by resident messages, in bytes
+	qint64 memoryUsage() const;
+
+	//! Role enum from an OpenAI role string
+	static ChatRole roleFromString(const QString& role);
+
+	//! OpenAI role string of a role enum ("system" for Other)
+	static QString roleToString(ChatRole role);
+
+	//! Parse a "yyyy-MM-dd hh:mm:ss" timestamp (-1 if it does not parse)
+	static qint64 parseTimestamp(const QString& timestamp);
+
+	//! Timestamp of the current local wall-clock time
+	static qint64 currentTimestamp();
+
+private:
+	struct Record
+	{
+		qint64 timestamp;	// ms since epoch, -1 when kept verbatim in _rawTimestamps
+		int offset;			// start of the message content in _arena
+		int length;			// length of the message content
+		int sender;			// index into _senders
+		ChatRole role;
+	};
+
+	//! Intern a sender name
+	int senderId(const QString& sender);
+
+	//! Record of a resident message
+	const Record& record(int index) const { return _records.at(index - _first); }
+
+	//! Resident messages, starting at message _first
+	QVector<Record> _records;
+	QString _arena;
+	QVector<QString> _senders;
+	QHash<QString, int> _senderIds;
+
+	//! Rare verbatim fields that do not fit the compact layout, by message index
+	QHash<int, QString> _rawTimestamps;
+	QHash<int, QString> _rawRoles;
+
+	//! Optional backing archive holding messages [0, _persisted)
+	QSharedPointer<ChatHistoryArchive> _log;
+
+	//! Number of messages no longer resident
+	int _first;
+
+	//! Number of messages written to _log
+	int _persisted;
+
+	//! Drop the resident messages only
+	void clearResident();
+};
+
+#endif // QT_CHATHISTORYSTORE_H
@@ -0,0 +1,270 @@
+/**
+ * File: qtChatImporter.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 13/04/2026| Tian-Qing Ye   | Created: memory-mapped import of chat transcripts
+ */
+#include "qtChatImporter.h"
+#include "qtChatHistoryStore.h"
+#include "qtChatWidget.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QStringList>
+#include <cstring>
+
+namespace
+{
+	//! Bytes parsed between two progress callbacks
+	const qint64 kProgressInterval = 4 * 1024 * 1024;
+
+	//! Length of "[yyyy-MM-dd hh:mm:ss] "
+	const int kHeaderPrefix = 22;
+
+	typedef std::function<bool(qint64, qint64)> Progress;
+
+	//! Same mapping as the widget uses for its own messages
+	QString roleForSender(const QString& sender)
+	{
+		if (sender == "You" || sender == "User") {
+			return "user";
+		}
+		else if (sender == "Assistant" || sender == "Bot") {
+			return "assistant";
+		}
+		return "system";
+	}
+
+	QString senderForRole(const QString& role)
+	{
+		if (role == "user") {
+			return "You";
+		}
+		else if (role == "assistant") {
+			return "Assistant";
+		}
+		return "System";
+	}
+
+	//! Position of the end of the line starting at pos ('\n' or size)
+	qint64 lineEnd(const char* data, qint64 pos, qint64 size)
+	{
+		const void* newline = std::memchr(data + pos, '\n', size_t(size - pos));
+		return newline ? static_cast<const char*>(newline) - data : size;
+	}
+
+	//! Report progress every few MB; false if the caller asked to stop
+	bool reportProgress(const Progress& progress, qint64 pos, qint64 size, qint64& lastReport)
+	{
+		if (!progress || pos - lastReport < kProgressInterval) return true;
+		lastReport = pos;
+		return progress(pos, size);
+	}
+
+	//! OpenAI content: a string, or an array of parts of which the text parts are kept
+	bool jsonContent(const QJsonValue& value, QString& content)
+	{
+		if (value.isString()) {
+			content = value.toString();
+			return true;
+		}
+		if (!value.isArray()) return false;
+
+		QStringList parts;
+		for (const QJsonValue& part : value.toArray()) {
+			const QJsonObject object = part.toObject();
+			if (object.value("type").toString() == "text") {
+				parts.append(object.value("text").toString());
+			}
+		}
+		content = parts.join('\n');
+		return true;
+	}
+
+	bool readJsonl(const char* data, qint64 pos, qint64 size, ChatHistoryStore& history, ChatImportStats& stats, const Progress& progress)
+	{
+		qint64 lastReport = pos;
+		while (pos < size) {
+			const qint64 end = lineEnd(data, pos, size);
+			const qint64 length = end - pos;
+
+			// Blank lines are not records
+			bool blank = true;
+			for (qint64 i = pos; i < end && blank; ++i) {
+				blank = (data[i] == ' ' || data[i] == '\t' || data[i] == '\r');
+			}
+
+			if (!blank) {
+				// fromRawData: the parser reads the mapped bytes directly
+				QJsonParseError error;
+				const QJsonDocument document = QJsonDocument::fromJson(QByteArray::fromRawData(data + pos, int(length)), &error);
+				const QJsonObject object = document.object();
+				const QString role = object.value("role").toString();
+				QString content;
+
+				if (error.error != QJsonParseError::NoError || role.isEmpty() || !jsonContent(object.value("content"), content)) {
+					++stats.skipped;
+				}
+				else {
+					QString sender = object.value("sender").toString();
+					if (sender.isEmpty()) {
+						sender = object.value("name").toString();
+					}
+					if (sender.isEmpty()) {
+						sender = senderForRole(role);
+					}
+					history.append(ChatMessage(object.value("timestamp").toString(), sender, content, role));
+					++stats.messages;
+				}
+			}
+
+			pos = end + 1;
+			if (!reportProgress(progress, pos, size, lastReport)) return false;
+		}
+		return true;
+	}
+
+	//! Check for a "[yyyy-MM-dd hh:mm:ss] Sender:" line (length without the line break)
+	bool isHeaderLine(const char* line, qint64 length)
+	{
+		if (length < kHeaderPrefix + 2 || line[0] != '[' || line[20] != ']' || line[21] != ' ' || line[length - 1] != ':') {
+			return false;
+		}
+		return line[5] == '-' && line[8] == '-' && line[11] == ' ' && line[14] == ':' && line[17] == ':';
+	}
+
+	bool readText(const char* data, qint64 pos, qint64 size, ChatHistoryStore& history, ChatImportStats& stats, const Progress& progress)
+	{
+		qint64 lastReport = pos;
+
+		// Current message: header fields and the byte range of its body
+		bool inMessage = false;
+		QString timestamp;
+		QString sender;
+		qint64 bodyStart = 0;
+
+		auto flush = [&](qint64 bodyEnd) {
+			// Each body is followed by a blank line in the export
+			while (bodyEnd > bodyStart && (data[bodyEnd - 1] == '\n' || data[bodyEnd - 1] == '\r')) {
+				--bodyEnd;
+			}
+			QString body = QString::fromUtf8(data + bodyStart, int(bodyEnd - bodyStart));
+			if (body.contains('\r')) {
+				body.replace("\r\n", "\n");
+			}
+			history.append(ChatMessage(timestamp, sender, body, roleForSender(sender)));
+			++stats.messages;
+		};
+
+		while (pos < size) {
+			const qint64 end = lineEnd(data, pos, size);
+			qint64 length = end - pos;
+			if (length > 0 && data[end - 1] == '\r') {
+				--length;
+			}
+
+			if (isHeaderLine(data + pos, length)) {
+				const QString headerTimestamp = QString::fromLatin1(data + pos + 1, 19);
+				if (ChatHistoryStore::parseTimestamp(headerTimestamp) >= 0) {
+					if (inMessage) {
+						flush(pos);
+					}
+					inMessage = true;
+					timestamp = headerTimestamp;
+					sender = QString::fromUtf8(data + pos + kHeaderPrefix, int(length - kHeaderPrefix - 1));
+					bodyStart = qMin(end + 1, size);
+				}
+				else if (!inMessage) {
+					++stats.skipped;	// Header with an impossible date and no message to belong to
+				}
+			}
+			// Anything before the first header is the export banner
+
+			pos = end + 1;
+			if (!reportProgress(progress, pos, size, lastReport)) return false;
+		}
+
+		if (inMessage) {
+			flush(size);
+		}
+		return true;
+	}
+}
+
+bool ChatImporter::read(const QString& fileName, ChatHistoryStore& history, Format format,
+	ChatImportStats* stats, QString* errorString, const std::function<bool(qint64, qint64)>& progress)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	ChatImportStats counters;
+	auto fail = [&](const QString& error) {
+		if (errorString) *errorString = error;
+		if (stats) *stats = counters;
+		return false;
+	};
+
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return fail(file.errorString());
+	}
+
+	counters.bytes = file.size();
+	if (counters.bytes == 0) {
+		if (stats) *stats = counters;
+		return true;
+	}
+
+	uchar* map = file.map(0, counters.bytes);
+	if (!map) {
+		return fail(QString("Cannot map %1: %2").arg(fileName, file.errorString()));
+	}
+
+	const char* data = reinterpret_cast<const char*>(map);
+	qint64 begin = 0;
+	if (counters.bytes >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+		begin = 3;	// UTF-8 BOM
+	}
+
+	if (format == Auto) {
+		format = detectFormat(fileName, data + begin, counters.bytes - begin);
+	}
+
+	const bool completed = (format == Jsonl)
+		? readJsonl(data, begin, counters.bytes, history, counters, progress)
+		: readText(data, begin, counters.bytes, history, counters, progress);
+
+	file.unmap(map);
+	counters.elapsedMs = timer.elapsed();
+
+	if (!completed) {
+		return fail("Import cancelled");
+	}
+	if (stats) *stats = counters;
+	return true;
+}
+
+ChatImporter::Format ChatImporter::detectFormat(const QString& fileName, const char* data, qint64 size)
+{
+	const QString suffix = QFileInfo(fileName).suffix().toLower();
+	if (suffix == "jsonl" || suffix == "json") return Jsonl;
+	if (suffix == "txt") return PlainText;
+
+	// Otherwise a leading '{' means JSON lines
+	for (qint64 i = 0; i < size; ++i) {
+		if (data[i] != ' ' && data[i] != '\t' && data[i] != '\r' && data[i] != '\n') {
+			return (data[i] == '{') ? Jsonl : PlainText;
+		}
+	}
+	return PlainText;
+}
+
+QString ChatImporter::fileFilter()
+{
+	return "Chat Transcripts (*.jsonl *.txt);;JSON Lines (*.jsonl);;Text Files (*.txt);;All Files (*)";
+}
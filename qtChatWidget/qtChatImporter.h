@@ -0,0 +1,84 @@
+/**
+ * File: qtChatImporter.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 13/04/2026| Tian-Qing Ye  | Created: memory-mapped import of chat transcripts
+ */
+#ifndef QT_CHATIMPORTER_H
+#define QT_CHATIMPORTER_H
+
+#include <QString>
+#include <QMetaType>
+#include <functional>
+
+// Forward declarations
+class ChatHistoryStore;
+
+/**
+ * \brief Counters of one import
+ */
+struct ChatImportStats
+{
+	qint64 bytes = 0;		// Size of the file
+	int messages = 0;		// Messages imported
+	int skipped = 0;		// Malformed records skipped
+	qint64 elapsedMs = 0;	// Wall time of the import
+
+	//! Throughput in MB/s
+	double megabytesPerSecond() const {
+		return elapsedMs > 0 ? (bytes / (1024.0 * 1024.0)) / (elapsedMs / 1000.0) : 0.0;
+	}
+};
+
+Q_DECLARE_METATYPE(ChatImportStats)
+
+/**
+ * \brief Reads chat transcripts into a ChatHistoryStore
+ *
+ * The file is memory-mapped and parsed in place: each record is decoded
+ * straight from the mapped bytes into the store, so apart from the store
+ * itself the extra memory does not depend on the size of the file.
+ *
+ * Supported formats are the files written by ChatExporter:
+ * - JSONL: one JSON object per line with "role" and "content" (OpenAI
+ *   format) and optionally "sender" (or "name") and "timestamp"
+ * - Plain text: "[yyyy-MM-dd hh:mm:ss] Sender:" header lines, each followed
+ *   by the message body
+ */
+class ChatImporter
+{
+public:
+	//! Input formats
+	enum Format {
+		Auto,		//!< Detect from the file suffix and content
+		Jsonl,		//!< One JSON message per line
+		PlainText	//!< The widget's text export
+	};
+
+	/**
+	 * \brief Append the messages of a transcript to a store
+	 * \param fileName File to read
+	 * \param history Store receiving the messages
+	 * \param format Input format
+	 * \param stats Receives the counters (optional)
+	 * \param errorString Receives the reason of a failure (optional)
+	 * \param progress Called every few MB with (bytes parsed, file size) from
+	 *        the calling thread; return false to stop (optional)
+	 * \return false if the file cannot be read or progress() stopped the import
+	 *
+	 * Malformed records are skipped and counted, they do not fail the import.
+	 */
+	static bool read(const QString& fileName, ChatHistoryStore& history, Format format = Auto,
+		ChatImportStats* stats = nullptr, QString* errorString = nullptr,
+		const std::function<bool(qint64, qint64)>& progress = std::function<bool(qint64, qint64)>());
+
+	//! Format of a file from its suffix, else from its first bytes
+	static Format detectFormat(const QString& fileName, const char* data, qint64 size);
+
+	//! Filter string for QFileDialog listing the supported formats
+	static QString fileFilter();
+};
+
+#endif // QT_CHATIMPORTER_H
@@ -0,0 +1,148 @@
+/**
+ * File: qtChatInstrumentation.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 04/05/2026| Tian-Qing Ye   | Created: latency counters, histograms and Chrome trace export
+ */
+#include "qtChatInstrumentation.h"
+#include <QCoreApplication>
+#include <QIODevice>
+#include <QtAlgorithms>
+
+namespace
+{
+	//! Histogram bucket of a duration
+	int bucketOf(qint64 durationNs)
+	{
+		const quint64 micros = quint64(qMax<qint64>(0, durationNs)) / 1000;
+		if (micros < 2) return 0;
+
+		const int bucket = 63 - int(qCountLeadingZeroBits(micros));
+		return qMin(bucket, ChatLatencyStats::BucketCount - 1);
+	}
+}
+
+qint64 ChatLatencyStats::percentileNs(double p) const
+{
+	if (count == 0) return 0;
+
+	const qint64 rank = qMax<qint64>(1, qint64(p * count + 0.5));
+	qint64 seen = 0;
+	for (int i = 0; i < BucketCount; ++i) {
+		seen += buckets[i];
+		if (seen >= rank) {
+			return qBound(minNs, bucketLimitNs(i), maxNs);
+		}
+	}
+	return maxNs;
+}
+
+ChatInstrumentation::ChatInstrumentation()
+	: _enabled(false)
+	, _traceNext(0)
+	, _traceCapacity(DefaultTraceCapacity)
+{
+	_clock.start();
+}
+
+void ChatInstrumentation::setEnabled(bool enabled)
+{
+#ifdef QTCHATWIDGET_NO_INSTRUMENTATION
+	Q_UNUSED(enabled);
+#else
+	_enabled = enabled;
+#endif
+}
+
+const char* ChatInstrumentation::stageName(ChatTraceStage stage)
+{
+	switch (stage) {
+	case ChatTraceStage::Markdown:
+		return "markdown";
+	case ChatTraceStage::Insert:
+		return "insert";
+	case ChatTraceStage::Layout:
+		return "layout";
+	case ChatTraceStage::Scroll:
+		return "scroll";
+	case ChatTraceStage::Frame:
+		return "frame";
+	case ChatTraceStage::Append:
+		return "append";
+	case ChatTraceStage::SetHistory:
+		return "set_history";
+	case ChatTraceStage::FirstResponse:
+		return "first_response";
+	default:
+		return "unknown";
+	}
+}
+
+void ChatInstrumentation::record(ChatTraceStage stage, qint64 startNs, qint64 durationNs)
+{
+	ChatLatencyStats& stats = _stats.stages[int(stage)];
+	if (stats.count == 0 || durationNs < stats.minNs) {
+		stats.minNs = durationNs;
+	}
+	stats.maxNs = qMax(stats.maxNs, durationNs);
+	stats.totalNs += durationNs;
+	++stats.count;
+	++stats.buckets[bucketOf(durationNs)];
+
+	if (_traceCapacity <= 0) return;
+
+	const TraceEvent event = { startNs, durationNs, stage };
+	if (_trace.size() < _traceCapacity) {
+		_trace.append(event);
+	}
+	else {
+		_trace[_traceNext] = event;
+		_traceNext = (_traceNext + 1) % _trace.size();
+		++_stats.droppedEvents;
+	}
+}
+
+void ChatInstrumentation::reset()
+{
+	_stats = ChatInstrumentationStats();
+	_trace.clear();
+	_traceNext = 0;
+}
+
+void ChatInstrumentation::setTraceCapacity(int events)
+{
+	_traceCapacity = qMax(0, events);
+	_trace.clear();
+	_traceNext = 0;
+}
+
+bool ChatInstrumentation::writeChromeTrace(QIODevice* device) const
+{
+	const qint64 pid = QCoreApplication::applicationPid();
+
+	// Events are fixed records, so the JSON is formatted by hand
+	QByteArray out;
+	out.reserve(128 + _trace.size() * 96);
+	out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + QByteArray::number(pid)
+		+ ",\"tid\":1,\"args\":{\"name\":\"qtChatWidget\"}}";
+
+	// Oldest first: the ring starts at _traceNext once it has wrapped
+	for (int k = 0; k < _trace.size(); ++k) {
+		const TraceEvent& event = _trace.at((_traceNext + k) % _trace.size());
+		out += ",\n{\"name\":\"";
+		out += stageName(event.stage);
+		out += "\",\"cat\":\"qtChatWidget\",\"ph\":\"X\",\"pid\":";
+		out += QByteArray::number(pid);
+		out += ",\"tid\":1,\"ts\":";
+		out += QByteArray::number(event.startNs / 1000.0, 'f', 3);
+		out += ",\"dur\":";
+		out += QByteArray::number(event.durationNs / 1000.0, 'f', 3);
+		out += '}';
+	}
+	out += "\n]}\n";
+
+	return device->write(out) == out.size();
+}
@@ -0,0 +1,180 @@
+/**
+ * File: qtChatInstrumentation.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 04/05/2026| Tian-Qing Ye  | Created: latency counters, histograms and Chrome trace export
+ */
+#ifndef QT_CHATINSTRUMENTATION_H
+#define QT_CHATINSTRUMENTATION_H
+
+#include <QElapsedTimer>
+#include <QMetaType>
+#include <QVector>
+
+// Forward declarations
+class QIODevice;
+
+/**
+ * \brief Timed stages of the display hot path
+ */
+enum class ChatTraceStage : quint8
+{
+	Markdown,		// Markdown to fragment (fragment cache lookup, parse on a miss)
+	Insert,			// Fragment inserted into the document
+	Layout,			// End of the document edit, where the text layout runs
+	Scroll,			// Scroll to the latest message
+	Frame,			// One coalesced display update (contains the stages above)
+	Append,			// AppendChatMessage / AppendChatMessages call (rendering is per frame)
+	SetHistory,		// SetChatHistory call (rendering is per frame)
+	FirstResponse,	// messageSent() to the first assistant message appended
+	Count
+};
+
+/**
+ * \brief Counter and latency histogram of one stage
+ *
+ * Bucket i holds durations in [2^i, 2^(i+1)) microseconds; bucket 0 also
+ * holds anything below 1 us and the last bucket anything above.
+ */
+struct ChatLatencyStats
+{
+	static const int BucketCount = 24;
+
+	qint64 count = 0;		// Number of samples
+	qint64 totalNs = 0;		// Sum of all samples
+	qint64 minNs = 0;		// Fastest sample
+	qint64 maxNs = 0;		// Slowest sample
+	qint64 buckets[BucketCount] = {};
+
+	//! Mean duration in nanoseconds (0 without samples)
+	double meanNs() const { return count > 0 ? double(totalNs) / count : 0.0; }
+
+	//! Duration below which a fraction p (0..1) of the samples fall, at bucket resolution
+	qint64 percentileNs(double p) const;
+
+	//! Upper bound of a bucket, in nanoseconds
+	static qint64 bucketLimitNs(int bucket) { return (qint64(2) << bucket) * 1000; }
+};
+
+/**
+ * \brief Snapshot of all instrumentation counters
+ */
+struct ChatInstrumentationStats
+{
+	ChatLatencyStats stages[int(ChatTraceStage::Count)];
+	qint64 droppedEvents = 0;	// Trace events overwritten since the last reset
+
+	const ChatLatencyStats& operator[](ChatTraceStage stage) const { return stages[int(stage)]; }
+};
+
+Q_DECLARE_METATYPE(ChatInstrumentationStats)
+
+/**
+ * \brief Optional latency instrumentation of the chat display
+ *
+ * Disabled by default. When enabled, every timed stage updates its counter
+ * and histogram and is kept in a bounded ring of trace events, which can be
+ * written as Chrome trace-event JSON (chrome://tracing, Perfetto).
+ *
+ * A disabled instance costs one predictable branch per timed scope. Building
+ * with QTCHATWIDGET_NO_INSTRUMENTATION removes the timed scopes altogether and
+ * makes isEnabled() a constant false.
+ */
+class ChatInstrumentation
+{
+public:
+	//! Default number of trace events kept
+	static const int DefaultTraceCapacity = 65536;
+
+	ChatInstrumentation();
+
+	//! Start or stop recording (always off with QTCHATWIDGET_NO_INSTRUMENTATION)
+	void setEnabled(bool enabled);
+
+#ifdef QTCHATWIDGET_NO_INSTRUMENTATION
+	bool isEnabled() const { return false; }
+#else
+	bool isEnabled() const { return _enabled; }
+#endif
+
+	//! Current time on the instrumentation clock, in nanoseconds
+	qint64 now() const { return _clock.nsecsElapsed(); }
+
+	//! Record one sample of a stage
+	void record(ChatTraceStage stage, qint64 startNs, qint64 durationNs);
+
+	//! Counters and histograms recorded so far
+	const ChatInstrumentationStats& stats() const { return _stats; }
+
+	//! Drop all counters and trace events
+	void reset();
+
+	//! Bound the number of trace events kept (the oldest are overwritten)
+	void setTraceCapacity(int events);
+
+	//! Write the trace events as Chrome trace-event JSON
+	bool writeChromeTrace(QIODevice* device) const;
+
+	//! Short name of a stage ("markdown", "insert", ...)
+	static const char* stageName(ChatTraceStage stage);
+
+private:
+	Q_DISABLE_COPY(ChatInstrumentation)
+
+	struct TraceEvent
+	{
+		qint64 startNs;
+		qint64 durationNs;
+		ChatTraceStage stage;
+	};
+
+	QElapsedTimer _clock;
+	bool _enabled;
+	ChatInstrumentationStats _stats;
+
+	//! Ring of trace events; _traceNext is the oldest once the ring is full
+	QVector<TraceEvent> _trace;
+	int _traceNext;
+	int _traceCapacity;
+};
+
+/**
+ * \brief Records the duration of the enclosing scope (use CHAT_TRACE_SCOPE)
+ */
+class ChatTraceScope
+{
+public:
+	ChatTraceScope(ChatInstrumentation& instrumentation, ChatTraceStage stage)
+		: _instrumentation(instrumentation.isEnabled() ? &instrumentation : nullptr)
+		, _stage(stage)
+		, _start(_instrumentation ? _instrumentation->now() : 0)
+	{
+	}
+
+	~ChatTraceScope()
+	{
+		if (_instrumentation) {
+			_instrumentation->record(_stage, _start, _instrumentation->now() - _start);
+		}
+	}
+
+private:
+	Q_DISABLE_COPY(ChatTraceScope)
+
+	ChatInstrumentation* _instrumentation;
+	ChatTraceStage _stage;
+	qint64 _start;
+};
+
+#ifndef QTCHATWIDGET_NO_INSTRUMENTATION
+#define CHAT_TRACE_CONCAT_(a, b) a##b
+#define CHAT_TRACE_CONCAT(a, b) CHAT_TRACE_CONCAT_(a, b)
+#define CHAT_TRACE_SCOPE(instrumentation, stage) \
+	ChatTraceScope CHAT_TRACE_CONCAT(chatTraceScope, __LINE__)(instrumentation, stage)
+#else
+#define CHAT_TRACE_SCOPE(instrumentation, stage) ((void)0)
+#endif
+
+#endif // QT_CHATINSTRUMENTATION_H
@@ -0,0 +1,120 @@
+/**
+ * File: qtChatJsonWriter.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 20/07/2026| Tian-Qing Ye   | Created: OpenAI chat JSON written straight into a byte buffer
+ * 16/10/2026| Tian-Qing Ye   | Documented the handling of unpaired surrogates (see tests/qtChatJsonWriterTests.cpp)
+ */
+#include "qtChatJsonWriter.h"
+#include "qtChatWidget.h"
+
+namespace
+{
+	//! Text is encoded in chunks of this many UTF-16 units, so the room made for
+	//! the worst case stays small however long the text is
+	const int kChunkUnits = 4096;
+
+	//! Most bytes one UTF-16 unit turns into (a control character, escaped as six)
+	const int kMaxBytesPerUnit = 6;
+
+	const char kHexDigits[] = "0123456789abcdef";
+}
+
+void ChatJsonWriter::appendString(QByteArray& out, QStringView text)
+{
+	out.append('"');
+
+	const QChar* it = text.begin();
+	const QChar* const end = text.end();
+	while (it < end) {
+		const QChar* const chunkEnd = it + qMin<qsizetype>(end - it, kChunkUnits);
+
+		// Room for the worst case, trimmed to what was written once the chunk is done
+		const int start = out.size();
+		out.resize(start + int(chunkEnd - it) * kMaxBytesPerUnit);
+		uchar* const first = reinterpret_cast<uchar*>(out.data());
+		uchar* p = first + start;
+
+		while (it < chunkEnd) {
+			const ushort unit = it->unicode();
+			++it;
+
+			if (unit < 0x80) {
+				if (unit >= 0x20 && unit != '"' && unit != '\\') {
+					*p++ = uchar(unit);
+					continue;
+				}
+				*p++ = '\\';
+				switch (unit) {
+				case '"': *p++ = '"'; break;
+				case '\\': *p++ = '\\'; break;
+				case '\n': *p++ = 'n'; break;
+				case '\r': *p++ = 'r'; break;
+				case '\t': *p++ = 't'; break;
+				case '\b': *p++ = 'b'; break;
+				case '\f': *p++ = 'f'; break;
+				default:
+					*p++ = 'u';
+					*p++ = '0';
+					*p++ = '0';
+					*p++ = uchar(kHexDigits[unit >> 4]);
+					*p++ = uchar(kHexDigits[unit & 0xf]);
+					break;
+				}
+			}
+			else if (unit < 0x800) {
+				*p++ = uchar(0xc0 | (unit >> 6));
+				*p++ = uchar(0x80 | (unit & 0x3f));
+			}
+			else if (QChar::isHighSurrogate(unit) && it < end && it->isLowSurrogate()) {
+				// The pair may straddle the chunk end; its first unit made room for both
+				const uint code = QChar::surrogateToUcs4(unit, it->unicode());
+				++it;
+				*p++ = uchar(0xf0 | (code >> 18));
+				*p++ = uchar(0x80 | ((code >> 12) & 0x3f));
+				*p++ = uchar(0x80 | ((code >> 6) & 0x3f));
+				*p++ = uchar(0x80 | (code & 0x3f));
+			}
+			else if (QChar::isSurrogate(unit)) {
+				// Unpaired: no UTF-8 form, written as U+FFFD
+				*p++ = 0xef;
+				*p++ = 0xbf;
+				*p++ = 0xbd;
+			}
+			else {
+				*p++ = uchar(0xe0 | (unit >> 12));
+				*p++ = uchar(0x80 | ((unit >> 6) & 0x3f));
+				*p++ = uchar(0x80 | (unit & 0x3f));
+			}
+		}
+
+		// Shrinking keeps the allocation
+		out.resize(int(p - first));
+	}
+
+	out.append('"');
+}
+
+void ChatJsonWriter::appendMessage(QByteArray& out, QStringView role, QStringView content)
+{
+	out.append("{\"role\":", 8);
+	appendString(out, role);
+	out.append(",\"content\":", 11);
+	appendString(out, content);
+	out.append('}');
+}
+
+void ChatJsonWriter::appendMessages(QByteArray& out, const QList<ChatMessage>& messages)
+{
+	out.append('[');
+	for (int i = 0; i < messages.size(); ++i) {
+		if (i > 0) {
+			out.append(',');
+		}
+		const ChatMessage& message = messages.at(i);
+		appendMessage(out, message.role.isEmpty() ? QStringView(u"user") : QStringView(message.role), message.message);
+	}
+	out.append(']');
+}
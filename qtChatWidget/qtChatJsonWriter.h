@@ -0,0 +1,49 @@
+/**
+ * File: qtChatJsonWriter.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 20/07/2026| Tian-Qing Ye  | Created: OpenAI chat JSON written straight into a byte buffer
+ * 16/10/2026| Tian-Qing Ye  | Documented the handling of unpaired surrogates (see tests/qtChatJsonWriterTests.cpp)
+ */
+#ifndef QT_CHATJSONWRITER_H
+#define QT_CHATJSONWRITER_H
+
+#include <QByteArray>
+#include <QStringView>
+#include <QList>
+
+// Forward declarations
+struct ChatMessage;
+
+/**
+ * \brief Writes OpenAI chat JSON straight into a byte buffer
+ *
+ * Text is escaped and encoded to UTF-8 in one pass over its UTF-16 code
+ * units, directly into the buffer: no QJsonObject / QJsonDocument, and no
+ * intermediate QByteArray per string. Output is appended, so one buffer can
+ * collect a whole request; a buffer that was reserve()d once keeps its
+ * capacity across resize(0), so it can be reused from request to request.
+ *
+ * For well-formed text the output parses back to the same values as
+ * QJsonDocument's would: '"', the backslash and control characters are
+ * escaped, everything else is written as UTF-8. Unpaired surrogates, which
+ * UTF-8 cannot encode, become U+FFFD, so the output is always valid UTF-8.
+ *
+ * All functions are thread safe.
+ */
+class ChatJsonWriter
+{
+public:
+	//! Append text as a JSON string (quoted)
+	static void appendString(QByteArray& out, QStringView text);
+
+	//! Append one message object: {"role":"...","content":"..."}
+	static void appendMessage(QByteArray& out, QStringView role, QStringView content);
+
+	//! Append messages as a JSON array (an empty role is written as "user")
+	static void appendMessages(QByteArray& out, const QList<ChatMessage>& messages);
+};
+
+#endif // QT_CHATJSONWRITER_H
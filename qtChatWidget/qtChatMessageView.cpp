@@ -0,0 +1,308 @@
+/**
+ * File: qtChatMessageView.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 09/02/2026| Tian-Qing Ye   | Created: model and delegate for the virtualized message view
+ * 09/03/2026| Tian-Qing Ye   | Model reads from ChatHistoryStore
+ * 16/10/2026| Tian-Qing Ye   | Rows never painted get an estimated height; measured heights kept per width bucket
+ */
+#include "qtChatMessageView.h"
+#include "qtChatWidget.h"
+#include <QAbstractItemView>
+#include <QAbstractTextDocumentLayout>
+#include <QTextDocument>
+#include <QPainter>
+#include <QFontMetrics>
+#include <QBrush>
+#include <QColor>
+#include <QtMath>
+
+namespace
+{
+	//! Padding around each message row
+	const int kRowMargin = 6;
+
+	//! Number of laid-out rows kept around (a few screenfuls)
+	const int kDocumentCacheSize = 256;
+
+	//! Layout widths within one bucket share their measured heights (until the rows are painted)
+	const int kWidthBucket = 32;
+
+	//! Width buckets whose heights are kept (e.g. the window and the maximized window)
+	const int kWidthBuckets = 4;
+
+	//! Estimated lines of a message that is not resident (its text is not read back)
+	const int kArchivedLines = 2;
+}
+
+QTextCharFormat chatSenderFormat(const QString& sender)
+{
+	QTextCharFormat senderFormat;
+	senderFormat.setFontWeight(QFont::Bold);
+
+	if (sender == "You") {
+		senderFormat.setForeground(QBrush(QColor("#0078d4")));
+	}
+	else if (sender == "Assistant" || sender == "Bot") {
+		senderFormat.setForeground(QBrush(QColor("#107c10")));
+	}
+	else if (sender == "System") {
+		senderFormat.setForeground(QBrush(QColor("#605e5c")));
+	}
+
+	return senderFormat;
+}
+
+QTextCharFormat chatMessageFormat(const QString& sender)
+{
+	QTextCharFormat defaultFormat;
+	defaultFormat.setForeground(QBrush(QColor("#323130")));
+
+	// For system messages, apply italic style
+	if (sender == "System") {
+		defaultFormat.setFontItalic(true);
+	}
+
+	return defaultFormat;
+}
+
+ChatMessageModel::ChatMessageModel(const ChatHistoryStore* history, QObject* parent)
+	: QAbstractListModel(parent)
+	, _history(history)
+	, _rowCount(history ? history->size() : 0)
+{
+}
+
+int ChatMessageModel::rowCount(const QModelIndex& parent) const
+{
+	return parent.isValid() ? 0 : _rowCount;
+}
+
+QVariant ChatMessageModel::data(const QModelIndex& index, int role) const
+{
+	if (!_history || !index.isValid() || index.row() >= _rowCount) {
+		return QVariant();
+	}
+
+	const int row = index.row();
+	switch (role) {
+	case Qt::DisplayRole:
+		return _history->messageStringAt(row);
+	case SenderRole:
+		return _history->senderAt(row);
+	case TimestampRole:
+		return _history->timestampStringAt(row);
+	case ChatRoleRole:
+		return _history->roleStringAt(row);
+	default:
+		return QVariant();
+	}
+}
+
+void ChatMessageModel::messagesAppended(int count)
+{
+	if (count <= 0) return;
+
+	beginInsertRows(QModelIndex(), _rowCount, _rowCount + count - 1);
+	_rowCount += count;
+	endInsertRows();
+}
+
+void ChatMessageModel::messageChanged(int row)
+{
+	if (row < 0 || row >= _rowCount) return;
+
+	QModelIndex changed = index(row);
+	emit dataChanged(changed, changed, { Qt::DisplayRole });
+}
+
+void ChatMessageModel::historyReset()
+{
+	beginResetModel();
+	_rowCount = _history ? _history->size() : 0;
+	endResetModel();
+}
+
+bool ChatMessageModel::textExtent(int row, int* characters, int* lines) const
+{
+	if (!_history || row < 0 || row >= _rowCount || !_history->isResident(row)) return false;
+
+	// Scanned where it is held: no copy, no markdown
+	const QStringView text = _history->messageAt(row);
+	int count = 1;
+	for (const QChar c : text) {
+		if (c == QLatin1Char('\n')) {
+			++count;
+		}
+	}
+
+	*characters = text.size();
+	*lines = count;
+	return true;
+}
+
+ChatMessageDelegate::ChatMessageDelegate(QAbstractItemView* view, QObject* parent)
+	: QStyledItemDelegate(parent)
+	, _view(view)
+	, _documents(kDocumentCacheSize)
+{
+}
+
+int ChatMessageDelegate::bodyWidth() const
+{
+	int width = _view->viewport()->width() - 2 * kRowMargin;
+	return qMax(width, 50);
+}
+
+QVector<int>& ChatMessageDelegate::heightsFor(int width) const
+{
+	const int bucket = width / kWidthBucket;
+
+	if (!_buckets.isEmpty() && _buckets.last() == bucket) {
+		return _heights[bucket];
+	}
+
+	// Most recently used last; the oldest bucket goes when there are too many
+	_buckets.removeOne(bucket);
+	_buckets.append(bucket);
+	if (_buckets.size() > kWidthBuckets) {
+		_heights.remove(_buckets.takeFirst());
+	}
+	return _heights[bucket];
+}
+
+QTextDocument* ChatMessageDelegate::documentFor(const QModelIndex& index, const QFont& font, int width) const
+{
+	const int row = index.row();
+	QTextDocument* doc = _documents.object(row);
+	if (!doc) {
+		const QString sender = index.data(ChatMessageModel::SenderRole).toString();
+
+		QFont bodyFont = font;
+		bodyFont.setItalic(chatMessageFormat(sender).fontItalic());
+
+		doc = new QTextDocument;
+		doc->setDefaultFont(bodyFont);
+		doc->setMarkdown(index.data(Qt::DisplayRole).toString());
+		_documents.insert(row, doc);
+	}
+
+	// A new width only lays the parsed document out again
+	if (doc->textWidth() != width) {
+		doc->setTextWidth(width);
+	}
+	return doc;
+}
+
+int ChatMessageDelegate::estimatedBodyHeight(const QModelIndex& index, const QFont& font, int width) const
+{
+	const int row = index.row();
+	while (_extents.size() <= row) {
+		_extents.append(TextExtent());
+	}
+
+	TextExtent& extent = _extents[row];
+	if (extent.characters < 0) {
+		const ChatMessageModel* model = qobject_cast<const ChatMessageModel*>(index.model());
+		if (!model || !model->textExtent(row, &extent.characters, &extent.lines)) {
+			return kArchivedLines * QFontMetrics(font).lineSpacing();
+		}
+	}
+
+	// Every line of the text, plus the lines its long ones wrap into
+	const QFontMetrics metrics(font);
+	const int charactersPerLine = qMax(1, width / qMax(1, metrics.averageCharWidth()));
+	return (extent.lines + extent.characters / charactersPerLine) * metrics.lineSpacing();
+}
+
+void ChatMessageDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
+{
+	const QString sender = index.data(ChatMessageModel::SenderRole).toString();
+	const QString timestamp = index.data(ChatMessageModel::TimestampRole).toString();
+
+	QFont headerFont = option.font;
+	headerFont.setBold(true);
+	const int headerHeight = QFontMetrics(headerFont).height();
+
+	// Markdown is parsed here, for painted rows only; the real height replaces the estimate
+	const int width = bodyWidth();
+	QTextDocument* doc = documentFor(index, option.font, width);
+	const int bodyHeight = qCeil(doc->size().height());
+
+	QVector<int>& heights = heightsFor(width);
+	const int row = index.row();
+	while (heights.size() <= row) {
+		heights.append(-1);
+	}
+	heights[row] = bodyHeight;
+	if (option.rect.height() != headerHeight + bodyHeight + 2 * kRowMargin) {
+		emit const_cast<ChatMessageDelegate*>(this)->sizeHintChanged(index);
+	}
+
+	painter->save();
+
+	// Header line: "[hh:mm:ss] Sender:"
+	QRect headerRect(option.rect.left() + kRowMargin, option.rect.top() + kRowMargin,
+		option.rect.width() - 2 * kRowMargin, headerHeight);
+	QTextCharFormat senderFormat = chatSenderFormat(sender);
+	painter->setFont(headerFont);
+	painter->setPen(senderFormat.hasProperty(QTextFormat::ForegroundBrush)
+		? senderFormat.foreground().color() : option.palette.color(QPalette::Text));
+	painter->drawText(headerRect, Qt::AlignLeft | Qt::AlignVCenter,
+		QString("[%1] %2:").arg(timestamp.mid(11, 8)).arg(sender));
+
+	// Markdown body below the header
+	painter->translate(headerRect.left(), headerRect.bottom() + 1);
+
+	QAbstractTextDocumentLayout::PaintContext context;
+	context.palette = option.palette;
+	context.palette.setColor(QPalette::Text, chatMessageFormat(sender).foreground().color());
+	context.clip = QRectF(0, 0, doc->textWidth(), doc->size().height());
+	doc->documentLayout()->draw(painter, context);
+
+	painter->restore();
+}
+
+QSize ChatMessageDelegate::sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const
+{
+	QFont headerFont = option.font;
+	headerFont.setBold(true);
+	const int headerHeight = QFontMetrics(headerFont).height();
+
+	const int width = bodyWidth();
+	const int row = index.row();
+
+	// Called for every row on each layout: a remembered height or an estimate, never markdown
+	const QVector<int>& heights = heightsFor(width);
+	int bodyHeight = (row < heights.size()) ? heights.at(row) : -1;
+	if (bodyHeight < 0) {
+		bodyHeight = estimatedBodyHeight(index, option.font, width);
+	}
+
+	return QSize(width + 2 * kRowMargin, headerHeight + bodyHeight + 2 * kRowMargin);
+}
+
+void ChatMessageDelegate::invalidateRow(const QModelIndex& index)
+{
+	const int row = index.row();
+	_documents.remove(row);
+	for (QVector<int>& heights : _heights) {
+		if (row >= 0 && row < heights.size()) {
+			heights[row] = -1;
+		}
+	}
+	if (row >= 0 && row < _extents.size()) {
+		_extents[row] = TextExtent();
+	}
+	emit sizeHintChanged(index);
+}
+
+void ChatMessageDelegate::invalidateAll()
+{
+	_documents.clear();
+	_heights.clear();
+	_buckets.clear();
+	_extents.clear();
+}
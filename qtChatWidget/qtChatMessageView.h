@@ -0,0 +1,157 @@
+/**
+ * File: qtChatMessageView.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 09/02/2026| Tian-Qing Ye  | Created: model and delegate for the virtualized message view
+ * 09/03/2026| Tian-Qing Ye  | Model reads from ChatHistoryStore
+ * 16/10/2026| Tian-Qing Ye  | Rows never painted get an estimated height; measured heights kept per width bucket
+ */
+#ifndef QT_CHATMESSAGEVIEW_H
+#define QT_CHATMESSAGEVIEW_H
+
+#include <QAbstractListModel>
+#include <QStyledItemDelegate>
+#include <QTextCharFormat>
+#include <QCache>
+#include <QHash>
+#include <QVector>
+#include <QList>
+
+// Forward declarations
+class ChatHistoryStore;
+class QAbstractItemView;
+class QTextDocument;
+
+//! Format of the "[hh:mm:ss] Sender:" header line, colour coded by sender
+QTextCharFormat chatSenderFormat(const QString& sender);
+
+//! Format of the message body (system messages are italic)
+QTextCharFormat chatMessageFormat(const QString& sender);
+
+/**
+ * \brief Read-only list model over the chat widget's message history
+ *
+ * The model does not own the messages. The widget notifies it whenever the
+ * history changes, so attached views only ever touch the rows they show.
+ */
+class ChatMessageModel : public QAbstractListModel
+{
+	Q_OBJECT
+
+public:
+	//! Extra data roles (Qt::DisplayRole returns the message content)
+	enum Roles {
+		SenderRole = Qt::UserRole + 1,
+		TimestampRole,
+		ChatRoleRole
+	};
+
+	/**
+	 * \brief Constructor
+	 * \param history The history owned by the chat widget
+	 * \param parent Parent object
+	 */
+	explicit ChatMessageModel(const ChatHistoryStore* history, QObject* parent = nullptr);
+
+	int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+	//! Announce messages appended at the end of the history
+	void messagesAppended(int count);
+
+	//! Announce that the content of one message changed (e.g. while streaming)
+	void messageChanged(int row);
+
+	//! Announce that the whole history was replaced
+	void historyReset();
+
+	/**
+	 * \brief Size of a message's text, for an estimated row height
+	 * \param row Row of the message
+	 * \param characters Receives the length of the text
+	 * \param lines Receives the number of lines of the text
+	 * \return false if the message is not resident (it is not read back from the archive)
+	 */
+	bool textExtent(int row, int* characters, int* lines) const;
+
+private:
+	//! History owned by the chat widget
+	const ChatHistoryStore* _history;
+
+	//! Number of rows announced to views so far
+	int _rowCount;
+};
+
+/**
+ * \brief Paints one chat message per row of a list view
+ *
+ * Markdown is only parsed for rows that are painted. A row that never was
+ * gets an estimated height from the length and line count of its text, so
+ * laying out the whole list costs no parsing and no reads from the archive.
+ * Painting a row measures its real height; if that differs from the
+ * estimate, sizeHintChanged() makes the view lay it out again.
+ *
+ * Laid-out documents are kept in a small LRU cache and only the body height
+ * of each row is remembered, per bucket of layout widths: resizing the view
+ * re-estimates the rows measured at another width instead of parsing them,
+ * and going back to an earlier width finds its heights still there.
+ */
+class ChatMessageDelegate : public QStyledItemDelegate
+{
+	Q_OBJECT
+
+public:
+	/**
+	 * \brief Constructor
+	 * \param view The view the delegate paints into (used for the layout width)
+	 * \param parent Parent object
+	 */
+	explicit ChatMessageDelegate(QAbstractItemView* view, QObject* parent = nullptr);
+
+	void paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const override;
+	QSize sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const override;
+
+	//! Drop the cached layout of one row after its content changed
+	void invalidateRow(const QModelIndex& index);
+
+	//! Drop all cached layouts (history replaced)
+	void invalidateAll();
+
+private:
+	//! Length and line count of a row's text, -1 characters when not known yet
+	struct TextExtent
+	{
+		int characters = -1;
+		int lines = 0;
+	};
+
+	//! Return the body document of a row laid out at width, creating it on demand
+	QTextDocument* documentFor(const QModelIndex& index, const QFont& font, int width) const;
+
+	//! Body height of a row that was not measured at this width bucket (no markdown parsing)
+	int estimatedBodyHeight(const QModelIndex& index, const QFont& font, int width) const;
+
+	//! Measured body heights for a layout width (-1: not measured), created on demand
+	QVector<int>& heightsFor(int width) const;
+
+	//! Width available to message bodies
+	int bodyWidth() const;
+
+	QAbstractItemView* _view;
+
+	//! Laid-out body documents of recently shown rows (LRU)
+	mutable QCache<int, QTextDocument> _documents;
+
+	//! Measured body height per row, by width bucket
+	mutable QHash<int, QVector<int>> _heights;
+
+	//! Width buckets held in _heights, least recently used first
+	mutable QList<int> _buckets;
+
+	//! Text extent per row, for estimates
+	mutable QVector<TextExtent> _extents;
+};
+
+#endif // QT_CHATMESSAGEVIEW_H
@@ -0,0 +1,283 @@
+/**
+ * File: qtChatMockServer.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 29/06/2026| Tian-Qing Ye   | Created: localhost mock of a chat completions endpoint
+ */
+#include "qtChatMockServer.h"
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QJsonDocument>
+#include <QDateTime>
+#include <QRegularExpression>
+#include <QTimer>
+
+namespace
+{
+	//! Cut a reply into the tokens it is streamed in: words with the spaces that follow them
+	QStringList splitTokens(const QString& text)
+	{
+		static const QRegularExpression tokenPattern("\\S+\\s*|\\s+");
+
+		QStringList tokens;
+		QRegularExpressionMatchIterator it = tokenPattern.globalMatch(text);
+		while (it.hasNext()) {
+			tokens.append(it.next().captured());
+		}
+		return tokens;
+	}
+
+	//! One chunk of a chat.completion.chunk stream, as an SSE event
+	QByteArray chunkEvent(const QByteArray& model, const QJsonObject& delta, const QJsonValue& finishReason)
+	{
+		const QJsonObject chunk{
+			{ "id", "chatcmpl-mock" },
+			{ "object", "chat.completion.chunk" },
+			{ "created", QDateTime::currentSecsSinceEpoch() },
+			{ "model", QString::fromUtf8(model) },
+			{ "choices", QJsonArray{ QJsonObject{
+				{ "index", 0 },
+				{ "delta", delta },
+				{ "finish_reason", finishReason }
+			} } }
+		};
+		return "data: " + QJsonDocument(chunk).toJson(QJsonDocument::Compact) + "\n\n";
+	}
+
+	//! Write one piece of a chunked response
+	void writeChunk(QTcpSocket* socket, const QByteArray& data)
+	{
+		socket->write(QByteArray::number(data.size(), 16) + "\r\n" + data + "\r\n");
+	}
+}
+
+ChatMockServer::ChatMockServer(QObject* parent)
+	: QObject(parent)
+	, _server(new QTcpServer(this))
+	, _firstTokenDelayMs(0)
+	, _tokenIntervalMs(0)
+	, _failStatus(0)
+	, _connectionCount(0)
+	, _requestCount(0)
+{
+	connect(_server, &QTcpServer::newConnection, this, &ChatMockServer::onNewConnection);
+}
+
+ChatMockServer::~ChatMockServer()
+{
+	close();
+}
+
+bool ChatMockServer::listen(quint16 port)
+{
+	return _server->listen(QHostAddress::LocalHost, port);
+}
+
+void ChatMockServer::close()
+{
+	_server->close();
+
+	const QList<QTcpSocket*> sockets = _connections.keys();
+	_connections.clear();
+	for (QTcpSocket* socket : sockets) {
+		socket->disconnect(this);
+		socket->abort();
+		socket->deleteLater();
+	}
+}
+
+QUrl ChatMockServer::url() const
+{
+	return QUrl(QString("http://127.0.0.1:%1/v1/chat/completions").arg(_server->serverPort()));
+}
+
+void ChatMockServer::setReply(const ReplyFunction& reply)
+{
+	_reply = reply;
+}
+
+void ChatMockServer::setFirstTokenDelay(int ms)
+{
+	_firstTokenDelayMs = qMax(0, ms);
+}
+
+void ChatMockServer::setTokenInterval(int ms)
+{
+	_tokenIntervalMs = qMax(0, ms);
+}
+
+void ChatMockServer::failNextRequest(int status, const QString& message)
+{
+	_failStatus = status;
+	_failMessage = message;
+}
+
+void ChatMockServer::onNewConnection()
+{
+	while (QTcpSocket* socket = _server->nextPendingConnection()) {
+		++_connectionCount;
+		_connections.insert(socket, Connection());
+
+		connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+			auto it = _connections.find(socket);
+			if (it == _connections.end()) return;
+			it->buffer += socket->readAll();
+			processRequests(socket);
+		});
+		connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+			_connections.remove(socket);
+			socket->deleteLater();
+		});
+	}
+}
+
+void ChatMockServer::processRequests(QTcpSocket* socket)
+{
+	for (;;) {
+		auto it = _connections.find(socket);
+		if (it == _connections.end() || it->responding) return;
+
+		const int headerEnd = it->buffer.indexOf("\r\n\r\n");
+		if (headerEnd < 0) return;
+
+		const QList<QByteArray> lines = it->buffer.left(headerEnd).split('\n');
+		const QByteArray requestLine = lines.first().trimmed();
+		int contentLength = 0;
+		bool keepAlive = !requestLine.endsWith("HTTP/1.0");
+		for (int i = 1; i < lines.size(); ++i) {
+			const int colon = lines[i].indexOf(':');
+			if (colon < 0) continue;
+			const QByteArray name = lines[i].left(colon).trimmed().toLower();
+			const QByteArray value = lines[i].mid(colon + 1).trimmed();
+			if (name == "content-length") {
+				contentLength = value.toInt();
+			}
+			else if (name == "connection") {
+				keepAlive = (value.toLower() != "close");
+			}
+		}
+
+		// Wait for the whole body
+		const int requestSize = headerEnd + 4 + contentLength;
+		if (it->buffer.size() < requestSize) return;
+
+		const QByteArray body = it->buffer.mid(headerEnd + 4, contentLength);
+		it->buffer.remove(0, requestSize);
+		it->keepAlive = keepAlive;
+
+		respond(socket, requestLine, body);
+	}
+}
+
+void ChatMockServer::respond(QTcpSocket* socket, const QByteArray& requestLine, const QByteArray& body)
+{
+	++_requestCount;
+	Connection& connection = _connections[socket];
+	connection.responding = true;
+
+	if (!requestLine.startsWith("POST ")) {
+		sendJson(socket, 405, QJsonObject{ { "error", QJsonObject{ { "message", "Only POST is supported" } } } });
+		return;
+	}
+	if (_failStatus != 0) {
+		const int status = _failStatus;
+		_failStatus = 0;
+		sendJson(socket, status, QJsonObject{ { "error", QJsonObject{
+			{ "message", _failMessage },
+			{ "type", "mock_error" }
+		} } });
+		return;
+	}
+
+	const QJsonObject request = QJsonDocument::fromJson(body).object();
+	const QJsonArray messages = request.value("messages").toArray();
+	const QString reply = _reply ? _reply(messages) : echoReply(messages);
+	connection.model = request.value("model").toString("mock").toUtf8();
+
+	if (!request.value("stream").toBool()) {
+		sendJson(socket, 200, QJsonObject{
+			{ "id", "chatcmpl-mock" },
+			{ "object", "chat.completion" },
+			{ "created", QDateTime::currentSecsSinceEpoch() },
+			{ "model", QString::fromUtf8(connection.model) },
+			{ "choices", QJsonArray{ QJsonObject{
+				{ "index", 0 },
+				{ "message", QJsonObject{ { "role", "assistant" }, { "content", reply } } },
+				{ "finish_reason", "stop" }
+			} } }
+		});
+		return;
+	}
+
+	socket->write(QByteArray("HTTP/1.1 200 OK\r\n"
+		"Content-Type: text/event-stream\r\n"
+		"Cache-Control: no-cache\r\n"
+		"Transfer-Encoding: chunked\r\n")
+		+ (connection.keepAlive ? QByteArray() : QByteArray("Connection: close\r\n"))
+		+ "\r\n");
+	connection.tokens = splitTokens(reply);
+
+	// The socket as context: nothing fires once the client is gone
+	QTimer::singleShot(_firstTokenDelayMs, socket, [this, socket]() { streamNext(socket); });
+}
+
+void ChatMockServer::streamNext(QTcpSocket* socket)
+{
+	auto it = _connections.find(socket);
+	if (it == _connections.end()) return;
+
+	if (!it->tokens.isEmpty()) {
+		writeChunk(socket, chunkEvent(it->model, QJsonObject{ { "content", it->tokens.takeFirst() } }, QJsonValue::Null));
+		QTimer::singleShot(_tokenIntervalMs, socket, [this, socket]() { streamNext(socket); });
+		return;
+	}
+
+	writeChunk(socket, chunkEvent(it->model, QJsonObject(), "stop"));
+	writeChunk(socket, "data: [DONE]\n\n");
+	socket->write("0\r\n\r\n");
+	finishResponse(socket);
+}
+
+void ChatMockServer::sendJson(QTcpSocket* socket, int status, const QJsonObject& object)
+{
+	const QByteArray body = QJsonDocument(object).toJson(QJsonDocument::Compact);
+	const bool keepAlive = _connections.value(socket).keepAlive;
+
+	socket->write(QString("HTTP/1.1 %1 %2\r\n").arg(status).arg(status < 400 ? "OK" : "Error").toLatin1()
+		+ "Content-Type: application/json\r\n"
+		+ "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+		+ (keepAlive ? QByteArray() : QByteArray("Connection: close\r\n"))
+		+ "\r\n"
+		+ body);
+	finishResponse(socket);
+}
+
+void ChatMockServer::finishResponse(QTcpSocket* socket)
+{
+	auto it = _connections.find(socket);
+	if (it == _connections.end()) return;
+
+	it->responding = false;
+	it->tokens.clear();
+	if (!it->keepAlive) {
+		socket->disconnectFromHost();
+		return;
+	}
+
+	// Requests sent meanwhile are handled from the event loop, not from inside this one
+	QTimer::singleShot(0, socket, [this, socket]() { processRequests(socket); });
+}
+
+QString ChatMockServer::echoReply(const QJsonArray& messages)
+{
+	for (int i = messages.size() - 1; i >= 0; --i) {
+		const QJsonObject message = messages.at(i).toObject();
+		if (message.value("role").toString() == "user") {
+			return QString("This is a mock reply to: %1").arg(message.value("content").toString());
+		}
+	}
+	return QString("This is a mock reply.");
+}
@@ -0,0 +1,127 @@
+/**
+ * File: qtChatMockServer.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 29/06/2026| Tian-Qing Ye  | Created: localhost mock of a chat completions endpoint
+ */
+#ifndef QT_CHATMOCKSERVER_H
+#define QT_CHATMOCKSERVER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QHash>
+#include <QUrl>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <functional>
+
+// Forward declarations
+class QTcpServer;
+class QTcpSocket;
+
+/**
+ * \brief Minimal OpenAI-compatible chat completions server on 127.0.0.1
+ *
+ * Answers POST requests with a completion, streamed as server-sent events
+ * (word by word, with chunked transfer encoding) when the request asks for a
+ * stream, else as one JSON object. Connections are kept alive, so a client
+ * that reuses them shows a connectionCount() lower than its requestCount().
+ * Delays before the first token and between tokens mimic a model.
+ *
+ * Meant for the demo, tests and latency benchmarks of ChatBackend. It runs on
+ * the thread that owns it, through that thread's event loop.
+ */
+class ChatMockServer : public QObject
+{
+	Q_OBJECT
+
+public:
+	//! Returns the reply to a conversation (the "messages" of the request)
+	typedef std::function<QString(const QJsonArray& messages)> ReplyFunction;
+
+	explicit ChatMockServer(QObject* parent = nullptr);
+	~ChatMockServer();
+
+	/**
+	 * \brief Start listening on 127.0.0.1
+	 * \param port The port (0: any free one, see url())
+	 * \return false if the port could not be bound
+	 */
+	bool listen(quint16 port = 0);
+
+	//! Stop listening and drop every connection
+	void close();
+
+	//! Endpoint URL to hand to ChatBackend::setEndpoint()
+	QUrl url() const;
+
+	//! How replies are made (default: quotes the last user message)
+	void setReply(const ReplyFunction& reply);
+
+	//! Delay before the first token of a streamed reply, in ms
+	void setFirstTokenDelay(int ms);
+
+	//! Delay between two tokens of a streamed reply, in ms
+	void setTokenInterval(int ms);
+
+	//! Answer the next request with an HTTP error
+	void failNextRequest(int status, const QString& message);
+
+	//! Connections accepted, and requests answered, since creation
+	int connectionCount() const { return _connectionCount; }
+	int requestCount() const { return _requestCount; }
+
+private:
+	Q_DISABLE_COPY(ChatMockServer)
+
+	//! State of one client connection
+	struct Connection
+	{
+		QByteArray buffer;			// bytes of requests not handled yet
+		QStringList tokens;			// tokens of the reply being streamed
+		QByteArray model;			// model named by the request
+		bool responding = false;	// a reply is being written (requests wait)
+		bool keepAlive = true;		// keep the connection after the reply
+	};
+
+	//! Accept waiting connections
+	void onNewConnection();
+
+	//! Handle every complete request buffered on a connection, one at a time
+	void processRequests(QTcpSocket* socket);
+
+	//! Answer one request
+	void respond(QTcpSocket* socket, const QByteArray& requestLine, const QByteArray& body);
+
+	//! Write the next token of a streamed reply (or its end)
+	void streamNext(QTcpSocket* socket);
+
+	//! Write a whole JSON response
+	void sendJson(QTcpSocket* socket, int status, const QJsonObject& object);
+
+	//! A reply is written: close the connection or go on with the next request
+	void finishResponse(QTcpSocket* socket);
+
+	//! Default reply
+	static QString echoReply(const QJsonArray& messages);
+
+	QTcpServer* _server;
+	QHash<QTcpSocket*, Connection> _connections;
+
+	ReplyFunction _reply;
+	int _firstTokenDelayMs;
+	int _tokenIntervalMs;
+
+	//! Error for the next request (0: none)
+	int _failStatus;
+	QString _failMessage;
+
+	int _connectionCount;
+	int _requestCount;
+};
+
+#endif // QT_CHATMOCKSERVER_H
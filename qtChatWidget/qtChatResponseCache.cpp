@@ -0,0 +1,217 @@
+/**
+ * File: qtChatResponseCache.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 13/07/2026| Tian-Qing Ye   | Created: replies cached by context fingerprint, in memory and on disk
+ * 20/07/2026| Tian-Qing Ye   | Fingerprint of a context already serialized as JSON
+ */
+#include "qtChatResponseCache.h"
+#include "qtChatWidget.h"
+#include "qtChatJsonWriter.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+namespace
+{
+	//! Magic (8 bytes) and version at the start of every entry file
+	const char kEntryMagic[] = "QCHATRSP";
+	const quint32 kEntryVersion = 1;
+
+	//! Suffix of the entry files (the name is the fingerprint)
+	const char kEntrySuffix[] = ".rsp";
+
+	//! Fields are separated by a byte that UTF-8 text never contains
+	void addField(QCryptographicHash& hash, const QString& field)
+	{
+		hash.addData(field.toUtf8());
+		hash.addData("\xff", 1);
+	}
+}
+
+ChatResponseCache::ChatResponseCache(int maxCost)
+	: _cache(maxCost)
+	, _ttlSecs(DefaultTimeToLive)
+	, _hits(0)
+	, _diskHits(0)
+	, _misses(0)
+	, _savedMs(0)
+{
+}
+
+QByteArray ChatResponseCache::fingerprint(const QList<ChatMessage>& messages, const QString& model, const QString& endpoint)
+{
+	// Timestamps and display names do not change the answer; roles and text do
+	QByteArray messagesJson;
+	ChatJsonWriter::appendMessages(messagesJson, messages);
+	return fingerprint(messagesJson, model, endpoint);
+}
+
+QByteArray ChatResponseCache::fingerprint(const QByteArray& messagesJson, const QString& model, const QString& endpoint)
+{
+	QCryptographicHash hash(QCryptographicHash::Sha256);
+	addField(hash, endpoint);
+	addField(hash, model);
+	hash.addData(messagesJson);
+	return hash.result().toHex();
+}
+
+bool ChatResponseCache::lookup(const QByteArray& key, QString* reply)
+{
+	// QCache::object() also marks the entry as most recently used
+	if (Entry* cached = _cache.object(key)) {
+		if (!isExpired(cached->createdMs)) {
+			++_hits;
+			_savedMs += cached->latencyMs;
+			*reply = cached->reply;
+			return true;
+		}
+		_cache.remove(key);
+	}
+
+	if (!_directory.isEmpty()) {
+		const QString path = entryPath(key);
+		Entry entry;
+		if (readEntry(path, &entry)) {
+			if (!isExpired(entry.createdMs)) {
+				++_hits;
+				++_diskHits;
+				_savedMs += entry.latencyMs;
+				*reply = entry.reply;
+				_cache.insert(key, new Entry(entry), qMax(1, entry.reply.size()));
+				return true;
+			}
+			QFile::remove(path);
+		}
+	}
+
+	++_misses;
+	return false;
+}
+
+void ChatResponseCache::insert(const QByteArray& key, const QString& reply, qint64 latencyMs)
+{
+	Entry entry;
+	entry.reply = reply;
+	entry.createdMs = QDateTime::currentMSecsSinceEpoch();
+	entry.latencyMs = latencyMs;
+
+	_cache.insert(key, new Entry(entry), qMax(1, reply.size()));
+	if (!_directory.isEmpty()) {
+		writeEntry(entryPath(key), entry);
+	}
+}
+
+bool ChatResponseCache::setDirectory(const QString& path)
+{
+	if (!path.isEmpty() && !QDir().mkpath(path)) {
+		_directory.clear();
+		return false;
+	}
+	_directory = path;
+	return true;
+}
+
+void ChatResponseCache::setTimeToLive(qint64 seconds)
+{
+	_ttlSecs = qMax<qint64>(0, seconds);
+}
+
+int ChatResponseCache::purgeExpired()
+{
+	if (_directory.isEmpty()) return 0;
+
+	int removed = 0;
+	const QDir dir(_directory);
+	const QStringList files = dir.entryList(QStringList(QString("*") + kEntrySuffix), QDir::Files);
+	for (const QString& file : files) {
+		// Unreadable files (truncated, another version) go too
+		const QString path = dir.filePath(file);
+		Entry entry;
+		if ((!readEntry(path, &entry) || isExpired(entry.createdMs)) && QFile::remove(path)) {
+			++removed;
+		}
+	}
+	return removed;
+}
+
+void ChatResponseCache::setMaxCost(int maxCost)
+{
+	_cache.setMaxCost(maxCost);
+}
+
+void ChatResponseCache::clear()
+{
+	_cache.clear();
+	if (_directory.isEmpty()) return;
+
+	const QDir dir(_directory);
+	for (const QString& file : dir.entryList(QStringList(QString("*") + kEntrySuffix), QDir::Files)) {
+		QFile::remove(dir.filePath(file));
+	}
+}
+
+ChatResponseCacheStats ChatResponseCache::stats() const
+{
+	ChatResponseCacheStats stats;
+	stats.hits = _hits;
+	stats.diskHits = _diskHits;
+	stats.misses = _misses;
+	stats.savedMs = _savedMs;
+	stats.entries = _cache.count();
+	stats.cost = _cache.totalCost();
+	stats.maxCost = _cache.maxCost();
+	return stats;
+}
+
+void ChatResponseCache::resetStats()
+{
+	_hits = 0;
+	_diskHits = 0;
+	_misses = 0;
+	_savedMs = 0;
+}
+
+bool ChatResponseCache::isExpired(qint64 createdMs) const
+{
+	return _ttlSecs > 0 && QDateTime::currentMSecsSinceEpoch() - createdMs > _ttlSecs * 1000;
+}
+
+QString ChatResponseCache::entryPath(const QByteArray& key) const
+{
+	return QDir(_directory).filePath(QString::fromLatin1(key) + kEntrySuffix);
+}
+
+bool ChatResponseCache::readEntry(const QString& path, Entry* entry) const
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly)) return false;
+	if (file.read(8) != QByteArray(kEntryMagic, 8)) return false;
+
+	QDataStream in(&file);
+	in.setVersion(QDataStream::Qt_5_15);
+	quint32 version = 0;
+	in >> version;
+	if (version != kEntryVersion) return false;
+
+	in >> entry->createdMs >> entry->latencyMs >> entry->reply;
+	return in.status() == QDataStream::Ok;
+}
+
+bool ChatResponseCache::writeEntry(const QString& path, const Entry& entry) const
+{
+	// Written to a temporary file and renamed: a reader never sees half an entry
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly)) return false;
+	file.write(kEntryMagic, 8);
+
+	QDataStream out(&file);
+	out.setVersion(QDataStream::Qt_5_15);
+	out << kEntryVersion << entry.createdMs << entry.latencyMs << entry.reply;
+	return out.status() == QDataStream::Ok && file.commit();
+}
@@ -0,0 +1,145 @@
+/**
+ * File: qtChatResponseCache.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 13/07/2026| Tian-Qing Ye  | Created: replies cached by context fingerprint, in memory and on disk
+ * 20/07/2026| Tian-Qing Ye  | Fingerprint of a context already serialized as JSON
+ */
+#ifndef QT_CHATRESPONSECACHE_H
+#define QT_CHATRESPONSECACHE_H
+
+#include <QCache>
+#include <QString>
+#include <QByteArray>
+#include <QList>
+
+// Forward declarations
+struct ChatMessage;
+
+/**
+ * \brief Counters of a ChatResponseCache
+ */
+struct ChatResponseCacheStats
+{
+	qint64 hits = 0;		// Lookups answered from the cache (either tier)
+	qint64 diskHits = 0;	// Of those, lookups answered from the disk tier
+	qint64 misses = 0;		// Lookups that needed a request
+	qint64 savedMs = 0;		// Sum of the request times of the replies served from the cache
+	int entries = 0;		// Replies held in memory
+	int cost = 0;			// Total cost (characters of reply) held in memory
+	int maxCost = 0;		// Size bound of the memory tier
+};
+
+/**
+ * \brief Cache of assistant replies, keyed by the conversation they answer
+ *
+ * The key is a fingerprint (SHA-256) of the request: the messages array of
+ * its body (every message of the context, in order, with its role), plus the
+ * model and endpoint. The same question asked in the same context therefore
+ * maps to the same reply, in this process and in the next one.
+ *
+ * Replies are held in two tiers. The memory tier is bounded by the total
+ * length of the cached replies and evicts the least recently used first. The
+ * optional disk tier (setDirectory()) keeps one small file per reply, so the
+ * cache survives restarts; a reply found only on disk is promoted to memory.
+ * Entries older than the time to live are misses in both tiers, and are
+ * removed when found.
+ *
+ * Not thread safe: use it from the thread of the backend.
+ */
+class ChatResponseCache
+{
+public:
+	//! Default size bound of the memory tier, in characters of cached replies
+	static const int DefaultMaxCost = 4 * 1024 * 1024;
+
+	//! Default time to live of an entry, in seconds (one week)
+	static const qint64 DefaultTimeToLive = 7 * 24 * 3600;
+
+	explicit ChatResponseCache(int maxCost = DefaultMaxCost);
+
+	/**
+	 * \brief Fingerprint of a request
+	 * \param messages The conversation sent, new prompt included (e.g. uiChatWidget::BuildContextMessages())
+	 * \param model Model name of the request
+	 * \param endpoint Endpoint URL of the request
+	 * \return Hex digest, stable across runs
+	 */
+	static QByteArray fingerprint(const QList<ChatMessage>& messages, const QString& model = QString(), const QString& endpoint = QString());
+
+	//! Fingerprint of a request whose messages are already serialized (a JSON array as ChatJsonWriter writes it)
+	static QByteArray fingerprint(const QByteArray& messagesJson, const QString& model = QString(), const QString& endpoint = QString());
+
+	/**
+	 * \brief Look up the reply of a request
+	 * \param key Fingerprint of the request
+	 * \param reply Receives the reply on a hit
+	 * \return true on a hit (counted in the stats, with the time the original request took)
+	 */
+	bool lookup(const QByteArray& key, QString* reply);
+
+	/**
+	 * \brief Store the reply of a request
+	 * \param key Fingerprint of the request
+	 * \param reply The whole reply text
+	 * \param latencyMs Time the request took, counted as saved by each later hit
+	 */
+	void insert(const QByteArray& key, const QString& reply, qint64 latencyMs);
+
+	//! Directory of the disk tier, created if needed (empty: memory only); false if it cannot be created
+	bool setDirectory(const QString& path);
+	QString directory() const { return _directory; }
+
+	//! Time to live of the entries, in seconds (0: entries never expire)
+	void setTimeToLive(qint64 seconds);
+	qint64 timeToLive() const { return _ttlSecs; }
+
+	//! Remove the expired entries of the disk tier; returns how many were removed
+	int purgeExpired();
+
+	//! Set the size bound of the memory tier (characters of cached replies)
+	void setMaxCost(int maxCost);
+	int maxCost() const { return _cache.maxCost(); }
+
+	//! Drop all entries, in memory and on disk (counters are kept)
+	void clear();
+
+	//! Current counters
+	ChatResponseCacheStats stats() const;
+
+	//! Reset the hit/miss counters
+	void resetStats();
+
+private:
+	Q_DISABLE_COPY(ChatResponseCache)
+
+	struct Entry
+	{
+		QString reply;
+		qint64 createdMs;	// Milliseconds since the epoch
+		qint64 latencyMs;
+	};
+
+	//! Whether an entry created at this time has outlived the time to live
+	bool isExpired(qint64 createdMs) const;
+
+	//! Path of the file of an entry in the disk tier
+	QString entryPath(const QByteArray& key) const;
+
+	//! Read and write one file of the disk tier
+	bool readEntry(const QString& path, Entry* entry) const;
+	bool writeEntry(const QString& path, const Entry& entry) const;
+
+	QCache<QByteArray, Entry> _cache;
+	QString _directory;
+	qint64 _ttlSecs;
+
+	qint64 _hits;
+	qint64 _diskHits;
+	qint64 _misses;
+	qint64 _savedMs;
+};
+
+#endif // QT_CHATRESPONSECACHE_H
@@ -0,0 +1,335 @@
+/**
+ * File: qtChatSearchIndex.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 20/04/2026| Tian-Qing Ye   | Created: inverted index for searching the chat history
+ * 16/10/2026| Tian-Qing Ye   | Index resident messages only; archived ones are scanned
+ */
+#include "qtChatSearchIndex.h"
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+	//! Longer runs (e.g. base64 blobs) are cut to this length
+	const int kMaxTermLength = 64;
+
+	//! CJK and other scripts written without spaces: one character per word
+	bool isSingleCharWord(QChar c)
+	{
+		return c.unicode() >= 0x2E80 && c.isLetterOrNumber();
+	}
+
+	QVector<int> intersect(const QVector<int>& a, const QVector<int>& b)
+	{
+		QVector<int> result;
+		result.reserve(qMin(a.size(), b.size()));
+		std::set_intersection(a.constBegin(), a.constEnd(), b.constBegin(), b.constEnd(), std::back_inserter(result));
+		return result;
+	}
+}
+
+ChatSearchIndex::ChatSearchIndex()
+	: _sortedTermsDirty(false)
+	, _first(0)
+	, _count(0)
+{
+}
+
+QStringList ChatSearchIndex::tokenize(QStringView text)
+{
+	QStringList words;
+	QString word;
+
+	for (const QChar c : text) {
+		if (isSingleCharWord(c)) {
+			if (!word.isEmpty()) {
+				words.append(word);
+				word.clear();
+			}
+			words.append(QString(c));
+		}
+		else if (c.isLetterOrNumber()) {
+			if (word.size() < kMaxTermLength) {
+				word.append(c.toLower());
+			}
+		}
+		else if (!word.isEmpty()) {
+			words.append(word);
+			word.clear();
+		}
+	}
+	if (!word.isEmpty()) {
+		words.append(word);
+	}
+
+	return words;
+}
+
+void ChatSearchIndex::appendFrom(const ChatHistoryStore& history, int end)
+{
+	end = qMin(end, history.size());
+
+	// Archived messages are scanned by search() rather than indexed
+	if (_count < history.firstResident()) {
+		dropBefore(history.firstResident());
+	}
+
+	for (int i = _count; i < end; ++i) {
+		const QStringList words = history.isResident(i)
+			? tokenize(history.messageAt(i))
+			: tokenize(history.messageStringAt(i));
+
+		for (const QString& word : words) {
+			auto it = _termIds.constFind(word);
+			if (it == _termIds.constEnd()) {
+				it = _termIds.insert(word, _postings.size());
+				_postings.append(QVector<int>());
+				_sortedTerms.append(word);
+				_sortedTermsDirty = true;
+			}
+
+			// Lists stay ascending and hold each message once
+			QVector<int>& list = _postings[it.value()];
+			if (list.isEmpty() || list.last() != i) {
+				list.append(i);
+			}
+		}
+	}
+	_count = qMax(_count, end);
+}
+
+void ChatSearchIndex::dropBefore(int index)
+{
+	if (index <= _first) return;
+
+	// Lists are ascending: archived messages are the head of each; words left without messages go
+	QHash<QString, int> termIds;
+	QVector<QVector<int>> postings;
+	for (auto it = _termIds.constBegin(); it != _termIds.constEnd(); ++it) {
+		const QVector<int>& list = _postings.at(it.value());
+		const int kept = int(std::lower_bound(list.constBegin(), list.constEnd(), index) - list.constBegin());
+		if (kept == list.size()) continue;
+
+		termIds.insert(it.key(), postings.size());
+		postings.append(list.mid(kept));
+	}
+	_termIds.swap(termIds);
+	_postings.swap(postings);
+	_sortedTerms = _termIds.keys().toVector();
+	_sortedTermsDirty = true;
+
+	_first = index;
+	_count = qMax(_count, index);
+}
+
+void ChatSearchIndex::clear()
+{
+	_termIds.clear();
+	_postings.clear();
+	_sortedTerms.clear();
+	_sortedTermsDirty = false;
+	_first = 0;
+	_count = 0;
+}
+
+qint64 ChatSearchIndex::memoryUsage() const
+{
+	qint64 bytes = qint64(_postings.capacity()) * sizeof(QVector<int>);
+	for (const QVector<int>& list : _postings) {
+		bytes += qint64(list.capacity()) * sizeof(int);
+	}
+
+	// Words are shared by the hash and the sorted list
+	bytes += qint64(_sortedTerms.capacity()) * sizeof(QString);
+	for (const QString& term : _sortedTerms) {
+		bytes += term.capacity() * sizeof(QChar);
+	}
+	bytes += qint64(_termIds.size()) * (sizeof(QString) + sizeof(int) + 2 * sizeof(void*));
+
+	return bytes;
+}
+
+const QVector<int>* ChatSearchIndex::postings(const QString& term) const
+{
+	auto it = _termIds.constFind(term);
+	return (it == _termIds.constEnd()) ? nullptr : &_postings.at(it.value());
+}
+
+QVector<int> ChatSearchIndex::prefixPostings(const QString& prefix) const
+{
+	if (_sortedTermsDirty) {
+		std::sort(_sortedTerms.begin(), _sortedTerms.end());
+		_sortedTermsDirty = false;
+	}
+
+	// All words starting with prefix form one run of the sorted list
+	QVector<int> merged;
+	for (auto it = std::lower_bound(_sortedTerms.constBegin(), _sortedTerms.constEnd(), prefix);
+		it != _sortedTerms.constEnd() && it->startsWith(prefix); ++it) {
+		merged += _postings.at(_termIds.value(*it));
+	}
+
+	std::sort(merged.begin(), merged.end());
+	merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+	return merged;
+}
+
+QVector<int> ChatSearchIndex::indexedCandidates(const QStringList& words, const QStringList& prefixes) const
+{
+	QVector<int> hits;
+
+	QVector<QVector<int>> lists;
+	for (const QString& word : words) {
+		const QVector<int>* list = postings(word);
+		if (!list) return hits;
+		lists.append(*list);
+	}
+	for (const QString& prefix : prefixes) {
+		lists.append(prefixPostings(prefix));
+		if (lists.last().isEmpty()) return hits;
+	}
+
+	if (lists.isEmpty()) {
+		// Filters only: every indexed message is a candidate
+		hits.resize(_count - _first);
+		for (int i = 0; i < hits.size(); ++i) {
+			hits[i] = _first + i;
+		}
+	}
+	else {
+		// Smallest list first keeps every intermediate result small
+		std::sort(lists.begin(), lists.end(), [](const QVector<int>& a, const QVector<int>& b) { return a.size() < b.size(); });
+		hits = lists.first();
+		for (int k = 1; k < lists.size() && !hits.isEmpty(); ++k) {
+			hits = intersect(hits, lists.at(k));
+		}
+	}
+
+	return hits;
+}
+
+QVector<int> ChatSearchIndex::scannedCandidates(const QStringList& words, const QStringList& prefixes, const ChatHistoryStore& history) const
+{
+	QVector<int> hits;
+	const int end = qMin(_first, history.size());
+
+	for (int i = 0; i < end; ++i) {
+		if (!words.isEmpty() || !prefixes.isEmpty()) {
+			const QStringList found = history.isResident(i)
+				? tokenize(history.messageAt(i))
+				: tokenize(history.messageStringAt(i));
+
+			const auto hasPrefix = [&found](const QString& prefix) {
+				return std::any_of(found.constBegin(), found.constEnd(), [&prefix](const QString& word) { return word.startsWith(prefix); });
+			};
+			if (!std::all_of(words.constBegin(), words.constEnd(), [&found](const QString& word) { return found.contains(word); })) continue;
+			if (!std::all_of(prefixes.constBegin(), prefixes.constEnd(), hasPrefix)) continue;
+		}
+		hits.append(i);
+	}
+
+	return hits;
+}
+
+QVector<int> ChatSearchIndex::search(const ChatSearchQuery& query, const ChatHistoryStore& history) const
+{
+	QVector<int> hits;
+	if (query.isEmpty()) return hits;
+
+	// Whole words (including the words of phrases) and prefixes; archived messages come first
+	QStringList words = query.terms;
+	for (const QString& phrase : query.phrases) {
+		words += tokenize(phrase);
+	}
+	hits = scannedCandidates(words, query.prefixes, history);
+	hits += indexedCandidates(words, query.prefixes);
+
+	// Phrases and filters are checked on the remaining candidates only
+	if (query.phrases.isEmpty() && query.sender.isEmpty() && !query.filterRole) {
+		return hits;
+	}
+
+	QVector<int> filtered;
+	for (int index : hits) {
+		if (query.filterRole && history.roleAt(index) != query.role) continue;
+		if (!query.sender.isEmpty() && history.senderAt(index).compare(query.sender, Qt::CaseInsensitive) != 0) continue;
+
+		bool matches = true;
+		if (!query.phrases.isEmpty()) {
+			const QString message = history.messageStringAt(index);
+			for (const QString& phrase : query.phrases) {
+				if (!message.contains(phrase, Qt::CaseInsensitive)) {
+					matches = false;
+					break;
+				}
+			}
+		}
+		if (matches) {
+			filtered.append(index);
+		}
+	}
+
+	return filtered;
+}
+
+ChatSearchQuery ChatSearchIndex::parseQuery(const QString& text)
+{
+	ChatSearchQuery query;
+
+	int pos = 0;
+	while (pos < text.size()) {
+		if (text.at(pos).isSpace()) {
+			++pos;
+			continue;
+		}
+
+		// "quoted phrase"
+		if (text.at(pos) == '"') {
+			int close = text.indexOf('"', pos + 1);
+			if (close < 0) close = text.size();
+			const QString phrase = text.mid(pos + 1, close - pos - 1).simplified();
+			if (!phrase.isEmpty()) {
+				query.phrases.append(phrase);
+			}
+			pos = close + 1;
+			continue;
+		}
+
+		int end = pos;
+		while (end < text.size() && !text.at(end).isSpace()) {
+			++end;
+		}
+		const QString token = text.mid(pos, end - pos);
+		pos = end;
+
+		if (token.startsWith("from:", Qt::CaseInsensitive) || token.startsWith("sender:", Qt::CaseInsensitive)) {
+			query.sender = token.mid(token.indexOf(':') + 1);
+		}
+		else if (token.startsWith("role:", Qt::CaseInsensitive)) {
+			query.role = ChatHistoryStore::roleFromString(token.mid(5).toLower());
+			query.filterRole = true;
+		}
+		else if (token.endsWith('*')) {
+			const QStringList words = tokenize(QStringView(token).left(token.size() - 1));
+			if (!words.isEmpty()) {
+				// Earlier words of e.g. "foo-ba*" must match whole, the last one by prefix
+				query.terms += words.mid(0, words.size() - 1);
+				query.prefixes.append(words.last());
+			}
+		}
+		else {
+			const QStringList words = tokenize(token);
+			query.terms += words;
+
+			// CJK text has no word breaks; keep the characters in order
+			if (words.size() > 1 && std::any_of(token.constBegin(), token.constEnd(), isSingleCharWord)) {
+				query.phrases.append(token);
+			}
+		}
+	}
+
+	return query;
+}
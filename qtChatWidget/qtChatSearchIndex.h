@@ -0,0 +1,125 @@
+/**
+ * File: qtChatSearchIndex.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 20/04/2026| Tian-Qing Ye  | Created: inverted index for searching the chat history
+ * 16/10/2026| Tian-Qing Ye  | Index resident messages only; archived ones are scanned
+ */
+#ifndef QT_CHATSEARCHINDEX_H
+#define QT_CHATSEARCHINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QVector>
+#include <QHash>
+#include "qtChatHistoryStore.h"
+
+/**
+ * \brief A parsed search query
+ *
+ * Syntax: plain words must all occur; "word*" matches any word starting with
+ * "word"; "a quoted phrase" must occur as written; from:Sender and role:user
+ * (or assistant, system) filter by sender and role. Matching ignores case.
+ */
+struct ChatSearchQuery
+{
+	QStringList terms;		// Whole words (normalized)
+	QStringList prefixes;	// Word prefixes (normalized)
+	QStringList phrases;	// Text that must occur verbatim (case-insensitive)
+	QString sender;			// Sender filter (empty: any)
+	ChatRole role = ChatRole::Other;
+	bool filterRole = false;
+
+	bool isEmpty() const {
+		return terms.isEmpty() && prefixes.isEmpty() && phrases.isEmpty() && sender.isEmpty() && !filterRole;
+	}
+
+	//! Strings to highlight in a hit
+	QStringList highlights() const { return terms + prefixes + phrases; }
+};
+
+/**
+ * \brief Inverted index over the message bodies of a ChatHistoryStore
+ *
+ * Every word maps to the ascending list of messages containing it. Appending
+ * messages only appends to those lists, so the index follows the history
+ * incrementally; replacing the history means clear() and one bulk appendFrom().
+ *
+ * A query intersects the posting lists of its words (smallest first), merges
+ * the lists of all words matching a prefix, then checks phrases and filters
+ * on the few remaining candidates only.
+ *
+ * Messages the store archived are not indexed (dropBefore()), so the index
+ * does not grow with the history: a query reads them back and matches their
+ * words one message at a time.
+ */
+class ChatSearchIndex
+{
+public:
+	ChatSearchIndex();
+
+	//! Index messages [size(), end) of the history; archived ones are skipped
+	void appendFrom(const ChatHistoryStore& history, int end);
+
+	//! Forget the messages before a history position (they were archived); queries scan them instead
+	void dropBefore(int index);
+
+	//! Remove everything
+	void clear();
+
+	//! Number of messages covered (indexed or scanned)
+	int size() const { return _count; }
+
+	//! First message indexed
+	int firstIndexed() const { return _first; }
+
+	//! Heap memory of the index, in bytes (approximate)
+	qint64 memoryUsage() const;
+
+	//! Number of distinct words
+	int termCount() const { return _postings.size(); }
+
+	/**
+	 * \brief Find the messages matching a query
+	 * \return Indices of matching messages, ascending
+	 */
+	QVector<int> search(const ChatSearchQuery& query, const ChatHistoryStore& history) const;
+
+	//! Parse the query syntax described at ChatSearchQuery
+	static ChatSearchQuery parseQuery(const QString& text);
+
+	//! Split text into normalized (lower case) words; CJK characters are words of their own
+	static QStringList tokenize(QStringView text);
+
+private:
+	//! Posting list of a word (nullptr if unknown)
+	const QVector<int>* postings(const QString& term) const;
+
+	//! Union of the posting lists of all words starting with prefix
+	QVector<int> prefixPostings(const QString& prefix) const;
+
+	//! Indexed messages holding all words and a word of each prefix (all of them if none)
+	QVector<int> indexedCandidates(const QStringList& words, const QStringList& prefixes) const;
+
+	//! Archived messages holding all words and a word of each prefix
+	QVector<int> scannedCandidates(const QStringList& words, const QStringList& prefixes, const ChatHistoryStore& history) const;
+
+	//! Word -> position in _postings
+	QHash<QString, int> _termIds;
+
+	//! Ascending message indices per word
+	QVector<QVector<int>> _postings;
+
+	//! Words in sorted order for prefix lookups (sorted lazily after new words arrive)
+	mutable QVector<QString> _sortedTerms;
+	mutable bool _sortedTermsDirty;
+
+	//! Messages [_first, _count) are indexed
+	int _first;
+	int _count;
+};
+
+#endif // QT_CHATSEARCHINDEX_H
@@ -0,0 +1,78 @@
+/**
+ * File: qtChatSession.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 18/05/2026| Tian-Qing Ye  | Created: state of a conversation parked behind the current one
+ * 15/06/2026| Tian-Qing Ye  | Expanded oversized messages are part of the session
+ * 22/06/2026| Tian-Qing Ye  | Summaries of old context runs are part of the session
+ * 06/07/2026| Tian-Qing Ye  | Messages queued while a reply is pending are part of the session
+ */
+#ifndef QT_CHATSESSION_H
+#define QT_CHATSESSION_H
+
+#include <QString>
+#include <QList>
+#include <QSet>
+#include "qtChatHistoryStore.h"
+#include "qtChatContextIndex.h"
+#include "qtChatSearchIndex.h"
+#include "qtChatContextCompactor.h"
+
+/**
+ * \brief A message typed while a reply was pending, waiting to be sent
+ */
+struct ChatQueuedMessage
+{
+	int id = 0;			// Stable identifier (see uiChatWidget::EditQueuedMessage())
+	QString text;		// The message as it will be sent
+};
+
+/**
+ * \brief One conversation hosted by a uiChatWidget
+ *
+ * The widget works on the current conversation through its own members. On
+ * a switch those members are swapped with the parked session's fields, which
+ * is O(1) because every container is implicitly shared. The rendered
+ * document is not part of the session: the widget keeps the documents of
+ * recently used sessions in an LRU cache, and a session whose document was
+ * evicted is rendered again when it becomes current.
+ */
+struct ChatSession
+{
+	QString title;
+
+	ChatHistoryStore history;
+	ChatContextIndex contextIndex;
+	ChatSearchIndex searchIndex;
+	ChatContextCompactor contextCompactor;
+
+	//! Context window of this conversation (messages)
+	int maxContextMessages = 20;
+
+	//! Messages kept in memory when the history is backed by a file
+	int residentMessages = 0;
+
+	//! A streamed reply is open (the last message) / grew since it was last rendered
+	bool streaming = false;
+	bool streamDirty = false;
+
+	//! Messages [displayFirst, renderedCount) are in the cached document
+	int renderedCount = 0;
+	int displayFirst = 0;
+
+	//! Oversized messages the user expanded (see uiChatWidget::SetCollapseThreshold())
+	QSet<int> expandedMessages;
+
+	//! Messages waiting to be sent, oldest first (see uiChatWidget::SetQueueMode())
+	QList<ChatQueuedMessage> queue;
+
+	//! Scroll position of the cached document (-1 = following the latest message)
+	int scrollValue = -1;
+
+	//! Switch counter value when the session was last current (most recent wins)
+	quint64 lastUsed = 0;
+};
+
+#endif // QT_CHATSESSION_H
@@ -0,0 +1,137 @@
+/**
+ * File: qtChatTheme.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 25/05/2026| Tian-Qing Ye   | Created: one shared style sheet for every chat widget
+ * 16/10/2026| Tian-Qing Ye   | Export progress bar styled like the busy indicator
+ */
+#include "qtChatTheme.h"
+#include <QApplication>
+#include <QWidget>
+
+namespace
+{
+	//! Style sheet of new widgets; built on first use, then shared by all of them
+	QString& currentStyleSheet()
+	{
+		static QString styleSheet = ChatTheme::defaultStyleSheet();
+		return styleSheet;
+	}
+}
+
+QString ChatTheme::defaultStyleSheet()
+{
+	return QStringLiteral(
+		"uiChatWidget QLabel#chatTitle { "
+		"   font-weight: bold; "
+		"   font-size: 11pt; "
+		"   padding: 5px; "
+		"} "
+		"uiChatWidget QLabel#chatSearchStatus, uiChatWidget QLabel#chatProgressLabel { "
+		"   color: #605e5c; "
+		"   font-size: 9pt; "
+		"   padding: 0px 5px; "
+		"} "
+		"uiChatWidget QPushButton[chatButton=\"secondary\"] { "
+		"   background-color: #f3f2f1; "
+		"   color: #323130; "
+		"   border: 1px solid #8a8886; "
+		"   border-radius: 4px; "
+		"   padding: 6px 16px; "
+		"   font-size: 9pt; "
+		"} "
+		"uiChatWidget QPushButton[chatButton=\"secondary\"]:hover { "
+		"   background-color: #e1dfdd; "
+		"   border-color: #605e5c; "
+		"} "
+		"uiChatWidget QPushButton[chatButton=\"secondary\"]:pressed { "
+		"   background-color: #d2d0ce; "
+		"} "
+		"uiChatWidget QLineEdit#chatSearchBox { "
+		"   padding: 4px 8px; "
+		"   border: 1px solid #cccccc; "
+		"   border-radius: 4px; "
+		"   font-size: 9pt; "
+		"} "
+		"uiChatWidget QTextEdit#chatHistory, uiChatWidget QListView#chatHistory { "
+		"   background-color: #f5f5f5; "
+		"   border: 1px solid #cccccc; "
+		"   border-radius: 4px; "
+		"   padding: 8px; "
+		"   font-family: 'Segoe UI', Arial, sans-serif; "
+		"   font-size: 10pt; "
+		"} "
+		"uiChatWidget QProgressBar#chatProgress, uiChatWidget QProgressBar#chatExportProgress { "
+		"   border: 2px solid #0078d4; "
+		"   border-radius: 4px; "
+		"   background-color: #e6e6e6; "
+		"   height: 8px; "
+		"   margin: 4px 0px; "
+		"   text-align: center; "
+		"} "
+		"uiChatWidget QProgressBar#chatProgress::chunk, uiChatWidget QProgressBar#chatExportProgress::chunk { "
+		"   background-color: qlineargradient(x1:0, y1:0, x2:1, y2:0, "
+		"       stop:0 #0078d4, stop:0.5 #106ebe, stop:1 #0078d4); "
+		"   border-radius: 2px; "
+		"   width: 20px; "
+		"} "
+		"uiChatWidget QLineEdit#chatInput { "
+		"   padding: 8px; "
+		"   border: 1px solid #cccccc; "
+		"   border-radius: 4px; "
+		"   font-size: 10pt; "
+		"} "
+		"uiChatWidget QPushButton#chatSend { "
+		"   background-color: #0078d4; "
+		"   color: white; "
+		"   border: none; "
+		"   border-radius: 4px; "
+		"   padding: 8px 20px; "
+		"   font-size: 10pt; "
+		"   font-weight: bold; "
+		"} "
+		"uiChatWidget QPushButton#chatSend:hover { "
+		"   background-color: #106ebe; "
+		"} "
+		"uiChatWidget QPushButton#chatSend:pressed { "
+		"   background-color: #005a9e; "
+		"} "
+		"uiChatWidget QPushButton#chatSend:disabled { "
+		"   background-color: #cccccc; "
+		"   color: #666666; "
+		"}"
+	);
+}
+
+QString ChatTheme::styleSheet()
+{
+	return currentStyleSheet();
+}
+
+void ChatTheme::setStyleSheet(const QString& styleSheet)
+{
+	currentStyleSheet() = styleSheet.isEmpty() ? defaultStyleSheet() : styleSheet;
+}
+
+void ChatTheme::installOnApplication()
+{
+	if (!qApp || isInstalledOnApplication()) return;
+
+	const QString applicationStyleSheet = qApp->styleSheet();
+	qApp->setStyleSheet(applicationStyleSheet.isEmpty() ? currentStyleSheet() : applicationStyleSheet + '\n' + currentStyleSheet());
+}
+
+bool ChatTheme::isInstalledOnApplication()
+{
+	return qApp && qApp->styleSheet().contains(currentStyleSheet());
+}
+
+void ChatTheme::apply(QWidget* widget)
+{
+	// Parsed once for the widget and all its parts
+	if (!isInstalledOnApplication()) {
+		widget->setStyleSheet(currentStyleSheet());
+	}
+}
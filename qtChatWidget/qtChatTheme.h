@@ -0,0 +1,70 @@
+/**
+ * File: qtChatTheme.h
+ *
+ * History:
+ * When      | Who           | What
+ * ----------|---------------|------------------------------------------------------
+ * 25/05/2026| Tian-Qing Ye  | Created: one shared style sheet for every chat widget
+ * 16/10/2026| Tian-Qing Ye  | Export progress bar styled like the busy indicator
+ */
+#ifndef QT_CHATTHEME_H
+#define QT_CHATTHEME_H
+
+#include <QString>
+
+// Forward declarations
+class QWidget;
+
+/**
+ * \brief Look of all uiChatWidget instances
+ *
+ * The whole look is one style sheet whose rules are scoped to uiChatWidget
+ * and select the parts by object name, instead of a separate style sheet per
+ * child widget. The text is built once and shared (implicitly) by every
+ * instance, and Qt parses it once per widget rather than once per child.
+ *
+ * Applications creating many widgets can go further with
+ * installOnApplication(): the rules then become part of the application
+ * style sheet, which Qt parses a single time, and new widgets carry no style
+ * sheet of their own.
+ *
+ * Object names of the parts: chatTitle, chatHistory (document and list
+ * view), chatInput, chatSend, chatSearchBox, chatSearchStatus, chatProgress,
+ * chatProgressLabel and chatExportProgress; the header and search buttons have the dynamic
+ * property chatButton="secondary".
+ */
+class ChatTheme
+{
+public:
+	//! The built-in style sheet
+	static QString defaultStyleSheet();
+
+	//! Style sheet of widgets created from now on
+	static QString styleSheet();
+
+	/**
+	 * \brief Replace the style sheet of widgets created from now on
+	 * \param styleSheet Rules for the parts named above (empty: the default look)
+	 */
+	static void setStyleSheet(const QString& styleSheet);
+
+	/**
+	 * \brief Append the style sheet to the application style sheet (once)
+	 *
+	 * Call after creating the QApplication and before creating widgets.
+	 * A later QApplication::setStyleSheet() replaces the rules; call this
+	 * again afterwards.
+	 */
+	static void installOnApplication();
+
+	//! True if the rules are part of the application style sheet
+	static bool isInstalledOnApplication();
+
+	//! Style a widget under construction (nothing to do once installed on the application)
+	static void apply(QWidget* widget);
+
+private:
+	ChatTheme() = delete;
+};
+
+#endif // QT_CHATTHEME_H
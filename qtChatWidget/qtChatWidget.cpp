@@ -6,13 +6,42 @@
  * ----------|----------------|------------------------------------------------
  * 25/10/2025| Tian-Qing Ye   | Created with assistance of Claude Sonnet 4.5
  * 13/11/2025| Tian-Qing Ye   | Added new chat and export buttons and slot functions
+ * 02/02/2026| Tian-Qing Ye   | Added streaming message API (begin/append chunk/finish)
+ * 09/02/2026| Tian-Qing Ye   | Added virtualized list view mode
+ * 16/02/2026| Tian-Qing Ye   | Cache parsed markdown fragments per message
+ * 23/02/2026| Tian-Qing Ye   | Added batch append; display updates coalesced per frame
+ * 02/03/2026| Tian-Qing Ye   | Added asynchronous, newest-first SetChatHistoryAsync
+ * 09/03/2026| Tian-Qing Ye   | History kept in a compact ChatHistoryStore
+ * 16/03/2026| Tian-Qing Ye   | Added token-budgeted context building
+ * 23/03/2026| Tian-Qing Ye   | Context building costs O(k) via the context index
+ * 30/03/2026| Tian-Qing Ye   | Optional on-disk history file with lazy paging of old messages
+ * 06/04/2026| Tian-Qing Ye   | Export runs on a worker thread (text, JSONL, Markdown, HTML)
+ * 13/04/2026| Tian-Qing Ye   | Added memory-mapped import of JSONL and text transcripts
+ * 20/04/2026| Tian-Qing Ye   | Added indexed search bar with hit highlighting
+ * 27/04/2026| Tian-Qing Ye   | Added FlushPendingRender for headless use and benchmarks
+ * 04/05/2026| Tian-Qing Ye   | Optional latency instrumentation with Chrome trace export
+ * 11/05/2026| Tian-Qing Ye   | Progress indicator no longer pumps events; determinate mode and reply latency readout
+ * 18/05/2026| Tian-Qing Ye   | Multiple conversation sessions with LRU-cached rendered documents
+ * 25/05/2026| Tian-Qing Ye   | Shared theme, lazily created controls, rendering deferred to the first show
+ * 01/06/2026| Tian-Qing Ye   | Display limit with head trimming; old messages archived compressed in memory
+ * 08/06/2026| Tian-Qing Ye   | Syntax highlighting of code blocks, tokenized off the GUI thread and cached
+ * 15/06/2026| Tian-Qing Ye   | Oversized messages collapsed to a preview, parsed only when expanded
+ * 22/06/2026| Tian-Qing Ye   | Context compaction: old turns replaced by summaries made in the background
+ * 06/07/2026| Tian-Qing Ye   | Queued mode: messages sent while a reply is pending wait in the display
+ * 20/07/2026| Tian-Qing Ye   | WriteContextJson: the context serialized straight from the history store
  */
 #include "qtChatWidget.h"
+#include "qtChatMessageView.h"
+#include "qtChatHistoryLog.h"
+#include "qtChatImporter.h"
+#include "qtChatTheme.h"
+#include "qtChatJsonWriter.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QLineEdit>
 #include <QTextEdit>
+#include <QListView>
 #include <QPushButton>
 #include <QProgressBar>
 #include <QScrollBar>
@@ -22,12 +51,181 @@
 #include <QTextCharFormat>
 #include <QTextDocument>
 #include <QTextDocumentFragment>
+#include <QTextBlock>
+#include <QTextLayout>
+#include <QTimer>
+#include <QThreadPool>
+#include <QAbstractTextDocumentLayout>
 #include <QBrush>
 #include <QColor>
 #include <QFileDialog>
-#include <QFile>
-#include <QTextStream>
 #include <QMessageBox>
+#include <QSaveFile>
+#include <QShortcut>
+#include <QShowEvent>
+#include <QMouseEvent>
+#include <limits>
+
+namespace
+{
+	//! Interval used to coalesce display updates to at most one per frame (~60 Hz)
+	const int kFrameIntervalMs = 16;
+
+	//! Messages in the first (newest) chunk of an async load, enough to fill the viewport
+	const int kFirstLoadChunk = 32;
+
+	//! Messages per chunk when older history streams in behind the viewport
+	const int kLoadChunkSize = 256;
+
+	//! Messages paged in from the history file each time the user reaches the top
+	const int kPageInChunk = 64;
+
+	//! Refresh interval of the reply readout while the busy indicator shows
+	const int kReadoutIntervalMs = 250;
+
+	//! Default memory budget of the documents cached for background sessions
+	const int kDefaultSessionCacheMB = 256;
+
+	//! Rough memory of a rendered document per character (text, formats and line layouts)
+	const int kRenderedBytesPerChar = 24;
+
+	//! Syntax spans kept for code blocks (about 12 bytes each)
+	const int kCodeSpanCacheSize = 500000;
+
+	//! Code blocks up to this many characters are tokenized on the spot, longer ones on the worker
+	const int kInlineTokenizeChars = 2048;
+
+	//! Default length from which messages are collapsed
+	const int kDefaultCollapseThreshold = 20000;
+
+	//! Preview of a collapsed message: at most this many characters and lines
+	const int kPreviewChars = 2000;
+	const int kPreviewLines = 20;
+
+	//! Scheme of the links the widget inserts into the display ("chat://expand/<index>")
+	const char* const kChatLinkScheme = "chat://";
+
+	//! Tag of the display blocks showing queued messages: above every message index, so tags stay non-decreasing
+	const int kQueuedBlockState = std::numeric_limits<int>::max();
+
+	//! Color of queued messages, which are not part of the conversation yet
+	const char* const kQueuedColor = "#8a8886";
+
+	bool isQueueBlock(const QTextBlock& block)
+	{
+		return block.isValid() && block.userState() == kQueuedBlockState;
+	}
+
+	//! Start of a collapsed message, cut at a line end where possible
+	QString collapsedPreview(const QString& text)
+	{
+		int end = qMin(text.size(), kPreviewChars);
+		int lines = 0;
+		for (int i = 0; i < end; ++i) {
+			if (text.at(i) == '\n' && ++lines == kPreviewLines) {
+				end = i;
+				break;
+			}
+		}
+		if (end < text.size() && text.at(end) != '\n') {
+			const int lineEnd = text.lastIndexOf('\n', end - 1);
+			if (lineEnd > 0) {
+				end = lineEnd;
+			}
+		}
+		return text.left(end) + '\n' + QChar(0x2026);
+	}
+
+	//! One fenced code block of the display: its blocks (one per line), text and language
+	struct DisplayCodeBlock
+	{
+		QVector<QTextBlock> lines;
+		QString code;
+		QString language;
+	};
+
+	bool isCodeBlock(const QTextBlock& block)
+	{
+		const QTextBlockFormat format = block.blockFormat();
+		return format.hasProperty(QTextFormat::BlockCodeFence) || format.hasProperty(QTextFormat::BlockCodeLanguage);
+	}
+
+	//! The code blocks among the display blocks [first, last]
+	QVector<DisplayCodeBlock> findCodeBlocks(QTextBlock block, const QTextBlock& last)
+	{
+		QVector<DisplayCodeBlock> codeBlocks;
+		bool inCode = false;
+		for (; block.isValid(); block = block.next()) {
+			if (isCodeBlock(block)) {
+				const QString language = block.blockFormat().stringProperty(QTextFormat::BlockCodeLanguage);
+				if (!inCode || codeBlocks.last().language != language) {
+					codeBlocks.append(DisplayCodeBlock());
+					codeBlocks.last().language = language;
+				}
+				else {
+					codeBlocks.last().code += '\n';
+				}
+				codeBlocks.last().code += block.text();
+				codeBlocks.last().lines.append(block);
+				inCode = true;
+			}
+			else {
+				inCode = false;
+			}
+			if (block == last) {
+				break;
+			}
+		}
+
+		// Line breaks inside a block end lines too (same length, so offsets hold)
+		for (DisplayCodeBlock& codeBlock : codeBlocks) {
+			codeBlock.code.replace(QChar::LineSeparator, '\n');
+		}
+		return codeBlocks;
+	}
+
+	//! Color a code block with layout formats, as QSyntaxHighlighter does: the text itself is not edited
+	void applyCodeSpans(QTextDocument* doc, const DisplayCodeBlock& codeBlock, const QVector<ChatCodeSpan>& spans)
+	{
+		int lineStart = 0;
+		int s = 0;
+		for (const QTextBlock& line : codeBlock.lines) {
+			const int lineEnd = lineStart + line.length() - 1;
+			while (s < spans.size() && spans.at(s).start + spans.at(s).length <= lineStart) ++s;
+
+			QVector<QTextLayout::FormatRange> ranges;
+			for (int k = s; k < spans.size() && spans.at(k).start < lineEnd; ++k) {
+				const int from = qMax(spans.at(k).start, lineStart);
+				const int to = qMin(spans.at(k).start + spans.at(k).length, lineEnd);
+				ranges.append({ from - lineStart, to - from, ChatCodeHighlighter::format(spans.at(k).token) });
+			}
+			line.layout()->setFormats(ranges);
+			lineStart = lineEnd + 1;
+		}
+
+		const QTextBlock& first = codeBlock.lines.first();
+		const QTextBlock& last = codeBlock.lines.last();
+		doc->markContentsDirty(first.position(), last.position() + last.length() - first.position());
+	}
+
+	//! Cache cost of a rendered document, in KB
+	int documentCostKB(const QTextDocument* document)
+	{
+		return int(qMax<qint64>(1, qint64(document->characterCount()) * kRenderedBytesPerChar / 1024));
+	}
+
+	//! Duration for the readout: "850 ms", "6.1 s", "2:05"
+	QString formatDuration(qint64 ms)
+	{
+		if (ms < 1000) {
+			return QString("%1 ms").arg(ms);
+		}
+		if (ms < 60000) {
+			return QString("%1 s").arg(ms / 1000.0, 0, 'f', 1);
+		}
+		return QString("%1:%2").arg(ms / 60000).arg((ms / 1000) % 60, 2, 10, QChar('0'));
+	}
+}
 
 uiChatWidget::uiChatWidget(const QString& title, const QString& welcomeMsg, int maxContextMessages, QWidget* parent)
 	: QWidget(parent)
@@ -38,10 +236,75 @@ uiChatWidget::uiChatWidget(const QString& title, const QString& welcomeMsg, int
 	, _newButton(nullptr)
 	, _exportButton(nullptr)
 	, _progressBar(nullptr)
+	, _progressLabel(nullptr)
+	, _exportProgressBar(nullptr)
+	, _progressTimer(nullptr)
+	, _firstTokenMs(-1)
+	, _lastTokenMs(-1)
+	, _replyEndMs(-1)
+	, _replyIndex(-1)
+	, _streaming(false)
+	, _streamDirty(false)
+	, _renderTimer(nullptr)
+	, _renderedCount(0)
+	, _scrollPending(false)
+	, _viewMode(DocumentView)
+	, _messageListView(nullptr)
+	, _messageModel(nullptr)
+	, _messageDelegate(nullptr)
+	, _displayFirst(0)
+	, _workerPool(nullptr)
+	, _loadGeneration(0)
+	, _loadTotal(0)
+	, _loadFloor(0)
+	, _residentMessages(0)
+	, _exporter(nullptr)
+	, _exportInteractive(false)
+	, _searchBar(nullptr)
+	, _searchBox(nullptr)
+	, _searchStatus(nullptr)
+	, _searchCurrent(-1)
+	, _responseStart(-1)
+	, _currentSession(0)
+	, _nextSessionId(1)
+	, _sessionClock(0)
+	, _backgroundStream(-1)
+	, _sessionDocuments(kDefaultSessionCacheMB * 1024)
+	, _headerLayout(nullptr)
+	, _progressLayout(nullptr)
+	, _renderDeferred(true)
+	, _displayMaxMessages(0)
+	, _displayMaxBytes(0)
+	, _codeSpans(kCodeSpanCacheSize)
+	, _maxSummaries(0)
+	, _summaryPool(nullptr)
+	, _collapseThreshold(kDefaultCollapseThreshold)
+	, _overChatLink(false)
+	, _viewportCursor(Qt::ArrowCursor)
+	, _queueMode(NoQueue)
+	, _replyPending(false)
+	, _nextQueuedId(1)
+	, _editingQueued(-1)
+	, _queueDirty(false)
+	, _dispatchPosted(false)
 {
+	// The widget starts with one conversation; its state lives in the members
+	ChatSession first;
+	first.title = title;
+	_sessions.insert(0, first);
+
 	// Create the UI
 	createUI(title);
 
+	// Appends, streaming re-renders and scrolling are coalesced to one update per frame
+	_renderTimer = new QTimer(this);
+	_renderTimer->setSingleShot(true);
+	_renderTimer->setInterval(kFrameIntervalMs);
+	connect(_renderTimer, &QTimer::timeout, this, &uiChatWidget::flushRender);
+
+	// Background work (markdown parsing of large loads, tokenizing long code blocks) runs here
+	_workerPool = new QThreadPool(this);
+
 	// Add Assistant welcome message
 	if (welcomeMsg.isEmpty())
 		AppendChatMessage("Assistant", "Welcome! I'm your AI assistant. How can I help you today?");
@@ -53,118 +316,75 @@ uiChatWidget::uiChatWidget(const QString& title, const QString& welcomeMsg, int
 
 uiChatWidget::~uiChatWidget()
 {
+	// Workers post results back to this object; let them finish first
+	cancelHistoryLoad();
+	if (_exporter) {
+		_exporter->cancel();
+	}
+	_workerPool->waitForDone();
+	if (_summaryPool) {
+		_summaryPool->clear();
+		_summaryPool->waitForDone();
+	}
+
+	// Whatever is still pending (including an unfinished stream) goes to the history file
+	_chatHistory.persist(_chatHistory.size());
+	for (ChatSession& session : _sessions) {
+		session.history.persist(session.history.size());
+	}
 }
 
 void uiChatWidget::createUI(const QString& title)
 {
+	// One style sheet for the whole widget, shared by all instances (see ChatTheme)
+	ChatTheme::apply(this);
+
 	QVBoxLayout* mainLayout = new QVBoxLayout;
 	setLayout(mainLayout);
 
 	// Header Container with Title and Buttons
 	QWidget* headerContainer = new QWidget(this);
-	QHBoxLayout* headerLayout = new QHBoxLayout;
-	headerContainer->setLayout(headerLayout);
-	headerLayout->setContentsMargins(0, 0, 0, 5);
+	_headerLayout = new QHBoxLayout;
+	headerContainer->setLayout(_headerLayout);
+	_headerLayout->setContentsMargins(0, 0, 0, 5);
 
 	// Title/Instructions Label
 	if (title.isEmpty() == false)
 	{
 		QLabel* titleLabel = new QLabel(title, this);
-		titleLabel->setStyleSheet("font-weight: bold; font-size: 11pt; padding: 5px;");
-		headerLayout->addWidget(titleLabel);
+		titleLabel->setObjectName("chatTitle");
+		_headerLayout->addWidget(titleLabel);
 	}
 
-	// Spacer
-	headerLayout->addStretch();
-
-	// New Button
-	_newButton = new QPushButton("New", headerContainer);
-	_newButton->setStyleSheet(
-		"QPushButton { "
-		"   background-color: #f3f2f1; "
-		"   color: #323130; "
-		"   border: 1px solid #8a8886; "
-		"   border-radius: 4px; "
-		"   padding: 6px 16px; "
-		"   font-size: 9pt; "
-		"} "
-		"QPushButton:hover { "
-		"   background-color: #e1dfdd; "
-		"   border-color: #605e5c; "
-		"} "
-		"QPushButton:pressed { "
-		"   background-color: #d2d0ce; "
-		"}"
-	);
-	_newButton->setCursor(Qt::PointingHandCursor);
-	_newButton->setToolTip("Start a new conversation");
-	headerLayout->addWidget(_newButton);
-
-	// Export Button
-	_exportButton = new QPushButton("Export", headerContainer);
-	_exportButton->setStyleSheet(
-		"QPushButton { "
-		"   background-color: #f3f2f1; "
-		"   color: #323130; "
-		"   border: 1px solid #8a8886; "
-		"   border-radius: 4px; "
-		"   padding: 6px 16px; "
-		"   font-size: 9pt; "
-		"} "
-		"QPushButton:hover { "
-		"   background-color: #e1dfdd; "
-		"   border-color: #605e5c; "
-		"} "
-		"QPushButton:pressed { "
-		"   background-color: #d2d0ce; "
-		"}"
-	);
-	_exportButton->setCursor(Qt::PointingHandCursor);
-	_exportButton->setToolTip("Export chat history to file");
-	headerLayout->addWidget(_exportButton);
+	// Spacer; the New and Export buttons are added when the widget is first shown
+	_headerLayout->addStretch();
 
 	mainLayout->addWidget(headerContainer);
 
+	// The search bar is created on the first Ctrl+F
+	QShortcut* findShortcut = new QShortcut(QKeySequence::Find, this);
+	findShortcut->setContext(Qt::WidgetWithChildrenShortcut);
+	connect(findShortcut, &QShortcut::activated, this, &uiChatWidget::ShowSearchBar);
+
 	// Chat History Display Area
 	_chatHistoryDisplay = new QTextEdit(this);
+	_chatHistoryDisplay->setObjectName("chatHistory");
+	_chatHistoryDisplay->setDocument(createSessionDocument()); // Owned by the widget, so it can be parked on a session switch
 	_chatHistoryDisplay->setReadOnly(true);
+	_chatHistoryDisplay->setUndoRedoEnabled(false); // Display is append-only; no undo stack needed
 	_chatHistoryDisplay->setPlaceholderText("Chat history will appear here...");
-	_chatHistoryDisplay->setStyleSheet(
-		"QTextEdit { "
-		"   background-color: #f5f5f5; "
-		"   border: 1px solid #cccccc; "
-		"   border-radius: 4px; "
-		"   padding: 8px; "
-		"   font-family: 'Segoe UI', Arial, sans-serif; "
-		"   font-size: 10pt; "
-		"}"
-	);
+	_chatHistoryDisplay->viewport()->installEventFilter(this); // Expand / collapse links
+	_chatHistoryDisplay->viewport()->setMouseTracking(true);
 	mainLayout->addWidget(_chatHistoryDisplay, 1);
 
-	// Progress Bar (initially hidden)
-	_progressBar = new QProgressBar(this);
-	_progressBar->setTextVisible(false);
-	_progressBar->setRange(0, 0); // Indeterminate/busy mode
-	_progressBar->setStyleSheet(
-		"QProgressBar {"
-		"   border: 2px solid #0078d4;"
-		"   border-radius: 4px;"
-		"   background-color: #e6e6e6;"
-		"   height: 8px;"
-		"   margin: 4px 0px;"
-		"   text-align: center;"
-		"}"
-		"QProgressBar::chunk {"
-		"   background-color: qlineargradient(x1:0, y1:0, x2:1, y2:0, "
-		"       stop:0 #0078d4, stop:0.5 #106ebe, stop:1 #0078d4);"
-		"   border-radius: 2px;"
-		"   width: 20px;"
-		"}"
-	);
-	_progressBar->setMaximumHeight(12);
-	_progressBar->setMinimumHeight(12);
-	_progressBar->setVisible(false);
-	mainLayout->addWidget(_progressBar);
+	// Progress bar and reply latency readout, created when first needed
+	_progressLayout = new QHBoxLayout;
+	_progressLayout->setContentsMargins(0, 0, 0, 0);
+	mainLayout->addLayout(_progressLayout);
+
+	_progressTimer = new QTimer(this);
+	_progressTimer->setInterval(kReadoutIntervalMs);
+	connect(_progressTimer, &QTimer::timeout, this, &uiChatWidget::updateProgressReadout);
 
 	// Input Area Container
 	QWidget* inputContainer = new QWidget(this);
@@ -174,40 +394,13 @@ void uiChatWidget::createUI(const QString& title)
 
 	// Input Box
 	_chatInputBox = new QLineEdit(inputContainer);
+	_chatInputBox->setObjectName("chatInput");
 	_chatInputBox->setPlaceholderText("Type your query here and press Enter or click Send...");
-	_chatInputBox->setStyleSheet(
-		"QLineEdit { "
-		"   padding: 8px; "
-		"   border: 1px solid #cccccc; "
-		"   border-radius: 4px; "
-		"   font-size: 10pt; "
-		"}"
-	);
 	inputLayout->addWidget(_chatInputBox, 1);
 
 	// Send Button
 	_sendButton = new QPushButton("Send", inputContainer);
-	_sendButton->setStyleSheet(
-		"QPushButton { "
-		"   background-color: #0078d4; "
-		"   color: white; "
-		"   border: none; "
-		"   border-radius: 4px; "
-		"   padding: 8px 20px; "
-		"   font-size: 10pt; "
-		"   font-weight: bold; "
-		"} "
-		"QPushButton:hover { "
-		"   background-color: #106ebe; "
-		"} "
-		"QPushButton:pressed { "
-		"   background-color: #005a9e; "
-		"} "
-		"QPushButton:disabled { "
-		"   background-color: #cccccc; "
-		"   color: #666666; "
-		"}"
-	);
+	_sendButton->setObjectName("chatSend");
 	_sendButton->setCursor(Qt::PointingHandCursor);
 	_sendButton->setMinimumWidth(80);
 	inputLayout->addWidget(_sendButton);
@@ -217,10 +410,154 @@ void uiChatWidget::createUI(const QString& title)
 	// Connect signals
 	connect(_chatInputBox, &QLineEdit::returnPressed, this, &uiChatWidget::onSendButtonClicked);
 	connect(_sendButton, &QPushButton::clicked, this, &uiChatWidget::onSendButtonClicked);
+	connect(_chatHistoryDisplay->verticalScrollBar(), &QScrollBar::valueChanged, this, &uiChatWidget::onDisplayScrolled);
+}
+
+void uiChatWidget::createHeaderButtons()
+{
+	QWidget* headerContainer = _headerLayout->parentWidget();
+
+	// New Button
+	_newButton = new QPushButton("New", headerContainer);
+	_newButton->setProperty("chatButton", "secondary");
+	_newButton->setCursor(Qt::PointingHandCursor);
+	_newButton->setToolTip("Start a new conversation");
+	_headerLayout->addWidget(_newButton);
+
+	// Export Button (turns into Cancel while an export runs)
+	_exportButton = new QPushButton(IsExporting() ? "Cancel" : "Export", headerContainer);
+	_exportButton->setProperty("chatButton", "secondary");
+	_exportButton->setCursor(Qt::PointingHandCursor);
+	_exportButton->setToolTip(IsExporting() ? "Cancel the running export" : "Export chat history to file");
+	_headerLayout->addWidget(_exportButton);
+
 	connect(_newButton, &QPushButton::clicked, this, &uiChatWidget::onNewButtonClicked);
 	connect(_exportButton, &QPushButton::clicked, this, &uiChatWidget::onExportButtonClicked);
 }
 
+void uiChatWidget::ensureSearchBar()
+{
+	if (_searchBar) return;
+
+	_searchBar = new QWidget(this);
+	QHBoxLayout* searchLayout = new QHBoxLayout;
+	_searchBar->setLayout(searchLayout);
+	searchLayout->setContentsMargins(0, 0, 0, 5);
+
+	_searchBox = new QLineEdit(_searchBar);
+	_searchBox->setObjectName("chatSearchBox");
+	_searchBox->setPlaceholderText("Search: words, prefix*, \"a phrase\", from:You, role:assistant");
+	_searchBox->setClearButtonEnabled(true);
+	searchLayout->addWidget(_searchBox, 1);
+
+	_searchStatus = new QLabel(_searchBar);
+	_searchStatus->setObjectName("chatSearchStatus");
+	searchLayout->addWidget(_searchStatus);
+
+	QPushButton* previousHitButton = new QPushButton("Previous", _searchBar);
+	previousHitButton->setProperty("chatButton", "secondary");
+	previousHitButton->setToolTip("Older match (Enter)");
+	searchLayout->addWidget(previousHitButton);
+
+	QPushButton* nextHitButton = new QPushButton("Next", _searchBar);
+	nextHitButton->setProperty("chatButton", "secondary");
+	nextHitButton->setToolTip("Newer match (Shift+Enter)");
+	searchLayout->addWidget(nextHitButton);
+
+	// Between the header and the display
+	_searchBar->setVisible(false);
+	qobject_cast<QVBoxLayout*>(layout())->insertWidget(1, _searchBar);
+
+	connect(_searchBox, &QLineEdit::textChanged, this, &uiChatWidget::onSearchTextChanged);
+	connect(_searchBox, &QLineEdit::returnPressed, this, [this]() {
+		stepSearchHit((QApplication::keyboardModifiers() & Qt::ShiftModifier) ? 1 : -1);
+	});
+	connect(previousHitButton, &QPushButton::clicked, this, [this]() { stepSearchHit(-1); });
+	connect(nextHitButton, &QPushButton::clicked, this, [this]() { stepSearchHit(1); });
+
+	QShortcut* closeSearchShortcut = new QShortcut(QKeySequence(Qt::Key_Escape), _searchBar);
+	closeSearchShortcut->setContext(Qt::WidgetWithChildrenShortcut);
+	connect(closeSearchShortcut, &QShortcut::activated, this, &uiChatWidget::HideSearchBar);
+}
+
+void uiChatWidget::ensureProgressIndicator()
+{
+	if (_progressBar) return;
+
+	_progressBar = new QProgressBar(this);
+	_progressBar->setObjectName("chatProgress");
+	_progressBar->setTextVisible(false);
+	_progressBar->setRange(0, 0); // Indeterminate/busy mode
+	_progressBar->setMaximumHeight(12);
+	_progressBar->setMinimumHeight(12);
+	_progressBar->setVisible(false);
+
+	// Reply latency readout next to the bar
+	_progressLabel = new QLabel(this);
+	_progressLabel->setObjectName("chatProgressLabel");
+	_progressLabel->setVisible(false);
+
+	_progressLayout->addWidget(_progressBar, 1);
+	_progressLayout->addWidget(_progressLabel);
+}
+
+void uiChatWidget::ensureExportProgressBar()
+{
+	if (_exportProgressBar) return;
+
+	_exportProgressBar = new QProgressBar(this);
+	_exportProgressBar->setObjectName("chatExportProgress");
+	_exportProgressBar->setTextVisible(false);
+	_exportProgressBar->setToolTip("Export progress");
+	_exportProgressBar->setMaximumHeight(12);
+	_exportProgressBar->setMinimumHeight(12);
+	_exportProgressBar->setVisible(false);
+
+	// Ahead of the reply indicator, which keeps its busy mode and readout
+	_progressLayout->insertWidget(0, _exportProgressBar, 1);
+}
+
+void uiChatWidget::showEvent(QShowEvent* event)
+{
+	QWidget::showEvent(event);
+
+	if (!_newButton) {
+		createHeaderButtons();
+	}
+
+	// Everything appended before the first show is rendered in one go, ahead of the first paint
+	if (_renderDeferred) {
+		FlushPendingRender();
+	}
+}
+
+bool uiChatWidget::eventFilter(QObject* watched, QEvent* event)
+{
+	if (_chatHistoryDisplay && watched == _chatHistoryDisplay->viewport()) {
+		if (event->type() == QEvent::MouseMove) {
+			// Pointing hand over the widget's own links only; other links are plain text
+			const QPoint pos = static_cast<QMouseEvent*>(event)->pos();
+			const bool overLink = _chatHistoryDisplay->anchorAt(pos).startsWith(kChatLinkScheme);
+			if (overLink != _overChatLink) {
+				_overChatLink = overLink;
+				if (overLink) {
+					_viewportCursor = _chatHistoryDisplay->viewport()->cursor().shape();
+				}
+				_chatHistoryDisplay->viewport()->setCursor(overLink ? Qt::PointingHandCursor : _viewportCursor);
+			}
+		}
+		else if (event->type() == QEvent::MouseButtonRelease) {
+			QMouseEvent* mouseEvent = static_cast<QMouseEvent*>(event);
+			const QString href = _chatHistoryDisplay->anchorAt(mouseEvent->pos());
+			if (mouseEvent->button() == Qt::LeftButton && href.startsWith(kChatLinkScheme)) {
+				// Re-rendered once the text edit is done with the click
+				QMetaObject::invokeMethod(this, [this, href]() { openChatLink(href); }, Qt::QueuedConnection);
+			}
+		}
+	}
+	return QWidget::eventFilter(watched, event);
+}
+
 QString uiChatWidget::senderToRole(const QString& sender) const
 {
 	if (sender == "You" || sender == "User") {
@@ -238,259 +575,2111 @@ void uiChatWidget::onSendButtonClicked()
 {
 	QString userInput = _chatInputBox->text().trimmed();
 
+	// Sending an edited queued message stores the edit; the message keeps its place
+	if (_editingQueued >= 0) {
+		const int id = _editingQueued;
+		_editingQueued = -1;
+		if (queuedPosition(id) >= 0) {
+			_chatInputBox->clear();
+			EditQueuedMessage(id, userInput);
+			return;
+		}
+		// Cancelled through the API meanwhile: the text goes out as a new message
+	}
+
 	// Check if input is empty
 	if (userInput.isEmpty())
 		return;
 
-	// Display user message
-	AppendChatMessage("You", userInput);
-
 	// Clear input box
 	_chatInputBox->clear();
 
+	// While a reply is pending, or older messages still wait, it joins the queue
+	if (_queueMode != NoQueue && (_replyPending || !_queue.isEmpty())) {
+		enqueueMessage(userInput);
+		return;
+	}
+
+	sendMessages(QStringList(userInput));
+}
+
+void uiChatWidget::sendMessages(const QStringList& texts)
+{
+	// Display user messages
+	for (const QString& text : texts) {
+		AppendChatMessage("You", text);
+	}
+
+	// The reply readout and the reply latency are measured from here
+	beginRequest();
+	if (_instrumentation.isEnabled()) {
+		_responseStart = _instrumentation.now();
+	}
+
 	// Emit signal so parent can handle the query
-	emit messageSent(userInput);
+	emit messageSent(texts.join("\n\n"));
 }
 
 void uiChatWidget::AppendChatMessage(const QString& sender, const QString& message)
 {
 	if (!_chatHistoryDisplay) return;
 
+	// A streamed message must stay the last history entry while it grows
+	if (_streaming) {
+		FinishStreamingMessage();
+	}
+
+	CHAT_TRACE_SCOPE(_instrumentation, ChatTraceStage::Append);
+
 	// Create and store message
-	QString timestamp = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
-	QString role = senderToRole(sender);
+	const qint64 timestamp = ChatHistoryStore::currentTimestamp();
+	const ChatRole role = ChatHistoryStore::roleFromString(senderToRole(sender));
 
-	ChatMessage chatMsg(timestamp, sender, message, role);
-	_chatHistory.append(chatMsg);
+	_chatHistory.append(timestamp, sender, message, role);
+	_contextIndex.appendFrom(_chatHistory);
+	noteAppended(role);
 
-	// Display in UI
-	QTextCursor cursor = _chatHistoryDisplay->textCursor();
-	cursor.movePosition(QTextCursor::End);
+	if (_messageModel) {
+		_messageModel->messagesAppended(1);
+	}
 
-	// Format timestamp for display (time only)
-	QString displayTime = timestamp.mid(11, 8); // Extract "hh:mm:ss"
+	// Display and scroll to bottom on the next frame
+	_scrollPending = true;
+	scheduleRender();
+}
 
-	// Set format based on sender for the header line
-	QTextCharFormat senderFormat;
-	senderFormat.setFontWeight(QFont::Bold);
+void uiChatWidget::AppendChatMessages(const QList<ChatMessage>& messages)
+{
+	if (!_chatHistoryDisplay || messages.isEmpty()) return;
 
-	if (sender == "You") {
-		senderFormat.setForeground(QBrush(QColor("#0078d4")));
-	}
-	else if (sender == "Assistant" || sender == "Bot") {
-		senderFormat.setForeground(QBrush(QColor("#107c10")));
+	if (_streaming) {
+		FinishStreamingMessage();
 	}
-	else if (sender == "System") {
-		senderFormat.setForeground(QBrush(QColor("#605e5c")));
+
+	CHAT_TRACE_SCOPE(_instrumentation, ChatTraceStage::Append);
+
+	const qint64 now = ChatHistoryStore::currentTimestamp();
+	_chatHistory.reserve(messages.size(), 0);
+	for (const ChatMessage& msg : messages) {
+		const QString roleString = msg.role.isEmpty() ? senderToRole(msg.sender) : msg.role;
+		const ChatRole role = ChatHistoryStore::roleFromString(roleString);
+
+		// Unstamped messages take the current time as a number, never formatted and parsed back
+		if (msg.timestamp.isEmpty() && role != ChatRole::Other) {
+			_chatHistory.append(now, msg.sender, msg.message, role);
+		}
+		else {
+			// Given timestamps and unknown roles are kept verbatim by the ChatMessage overload
+			ChatMessage chatMsg(msg);
+			chatMsg.role = roleString;
+			if (chatMsg.timestamp.isEmpty()) {
+				chatMsg.timestamp = QDateTime::fromMSecsSinceEpoch(now, Qt::UTC).toString(ChatHistoryStore::TimestampFormat);
+			}
+			_chatHistory.append(chatMsg);
+		}
+		noteAppended(_chatHistory.roleAt(_chatHistory.size() - 1));
 	}
+	_contextIndex.appendFrom(_chatHistory);
 
-	// Add separator if not the first message
-	if (!_chatHistoryDisplay->toPlainText().isEmpty()) {
-		cursor.insertText("\n");
+	if (_messageModel) {
+		_messageModel->messagesAppended(messages.size());
 	}
 
-	// Insert sender and timestamp
-	cursor.setCharFormat(senderFormat);
-	cursor.insertText(QString("[%1] %2:\n").arg(displayTime).arg(sender));
+	// The whole batch lands in one document edit on the next frame
+	_scrollPending = true;
+	scheduleRender();
+}
 
-	// Reset format and render message as Markdown
-	QTextCharFormat defaultFormat;
-	defaultFormat.setForeground(QBrush(QColor("#323130")));
-	
-	// For system messages, apply italic style
-	if (sender == "System") {
-		defaultFormat.setFontItalic(true);
-	}
-	
-	cursor.setCharFormat(defaultFormat);
-	
-	// Insert Markdown-formatted message using QTextDocument fragment
-	QTextDocument tempDoc;
-	tempDoc.setDefaultFont(_chatHistoryDisplay->font());
-	tempDoc.setMarkdown(message);
-	
-	// Merge the markdown document into the chat display
-	QTextCursor tempCursor(&tempDoc);
-	tempCursor.select(QTextCursor::Document);
-	QTextDocumentFragment fragment = tempCursor.selection();
-	cursor.insertFragment(fragment);
-	
-	cursor.insertText("\n");
+void uiChatWidget::BeginStreamingMessage(const QString& sender)
+{
+	if (!_chatHistoryDisplay) return;
+
+	// One stream at a time, also across sessions
+	finishBackgroundStream();
 
-	// Scroll to bottom
-	_chatHistoryDisplay->verticalScrollBar()->setValue(_chatHistoryDisplay->verticalScrollBar()->maximum());
+	// Add the message with empty content; the header shows up on the next frame
+	AppendChatMessage(sender, QString());
+	_streaming = true;
+	_streamDirty = false;
 }
 
-void uiChatWidget::SetChatHistory(const QList<ChatMessage>& history)
+void uiChatWidget::AppendStreamingChunk(const QString& chunk)
+{
+	if (chunk.isEmpty()) return;
+
+	if (!_streaming) {
+		// The stream was begun in a session that is now in the background
+		if (_backgroundStream >= 0) {
+			ChatSession& session = _sessions[_backgroundStream];
+			session.history.appendToLast(chunk);
+			session.streamDirty = true;
+		}
+		return;
+	}
+
+	// Grow the last history entry in place
+	_chatHistory.appendToLast(chunk);
+	noteReplyText();
+
+	// Re-render at most once per frame however fast chunks arrive
+	_streamDirty = true;
+	scheduleRender();
+}
+
+void uiChatWidget::FinishStreamingMessage()
 {
-	_chatHistory = history;
+	if (!_streaming) {
+		finishBackgroundStream();
+		return;
+	}
 
-	// Rebuild display
-	if (_chatHistoryDisplay) {
-		_chatHistoryDisplay->clear();
+	_streaming = false;
+	_contextIndex.updateLast(_chatHistory);
+	_contextCompactor.invalidateFrom(_contextIndex.contextCountBefore(_chatHistory.size() - 1, _chatHistory));
 
-		for (const ChatMessage& msg : _chatHistory) {
-			QTextCursor cursor = _chatHistoryDisplay->textCursor();
-			cursor.movePosition(QTextCursor::End);
+	// A streamed reply is complete once it is closed
+	if (_replyIndex == _chatHistory.size() - 1 && _replyEndMs < 0) {
+		_replyEndMs = _requestClock.elapsed();
+		updateProgressReadout();
+	}
 
-			// Extract time from timestamp
-			QString displayTime = msg.timestamp.mid(11, 8);
+	// Flush whatever arrived since the last frame (final content is cached)
+	const bool rendersFinal = _streamDirty || _renderedCount < _chatHistory.size();
+	_renderTimer->stop();
+	flushRender();
 
-			// Set format based on sender for the header line
-			QTextCharFormat senderFormat;
-			senderFormat.setFontWeight(QFont::Bold);
+	// Code is colored once complete; a final re-render above has done it already
+	if (!rendersFinal) {
+		highlightMessage(_chatHistory.size() - 1);
+	}
+}
 
-			if (msg.sender == "You") {
-				senderFormat.setForeground(QBrush(QColor("#0078d4")));
-			}
-			else if (msg.sender == "Assistant" || msg.sender == "Bot") {
-				senderFormat.setForeground(QBrush(QColor("#107c10")));
-			}
-			else if (msg.sender == "System") {
-				senderFormat.setForeground(QBrush(QColor("#605e5c")));
-			}
+void uiChatWidget::FlushPendingRender()
+{
+	if (!_renderTimer->isActive() && !_renderDeferred) return;
 
-			// Add separator
-			if (!_chatHistoryDisplay->toPlainText().isEmpty()) {
-				cursor.insertText("\n");
-			}
+	_renderDeferred = false;
+	_renderTimer->stop();
+	flushRender();
+}
 
-			// Insert sender and timestamp
-			cursor.setCharFormat(senderFormat);
-			cursor.insertText(QString("[%1] %2:\n").arg(displayTime).arg(msg.sender));
-
-			// Reset format and render message as Markdown
-			QTextCharFormat defaultFormat;
-			defaultFormat.setForeground(QBrush(QColor("#323130")));
-			
-			// For system messages, apply italic style
-			if (msg.sender == "System") {
-				defaultFormat.setFontItalic(true);
-			}
-			
-			cursor.setCharFormat(defaultFormat);
-			
-			// Insert Markdown-formatted message using QTextDocument fragment
-			QTextDocument tempDoc;
-			tempDoc.setDefaultFont(_chatHistoryDisplay->font());
-			tempDoc.setMarkdown(msg.message);
-			
-			// Merge the markdown document into the chat display
-			QTextCursor tempCursor(&tempDoc);
-			tempCursor.select(QTextCursor::Document);
-			QTextDocumentFragment fragment = tempCursor.selection();
-			cursor.insertFragment(fragment);
-			
-			cursor.insertText("\n");
-		}
-
-		// Scroll to bottom
-		_chatHistoryDisplay->verticalScrollBar()->setValue(_chatHistoryDisplay->verticalScrollBar()->maximum());
+void uiChatWidget::scheduleRender()
+{
+	if (!_renderTimer->isActive()) {
+		_renderTimer->start();
 	}
 }
 
-QList<ChatMessage> uiChatWidget::BuildContextMessages(int maxMessages) const
+void uiChatWidget::flushRender()
 {
-	QList<ChatMessage> contextMessages;
+	if (!_chatHistoryDisplay) return;
 
-	// Use provided maxMessages or fall back to member variable
-	int limit = (maxMessages > 0) ? maxMessages : _maxContextMessages;
+	const qint64 frameStart = _instrumentation.isEnabled() ? _instrumentation.now() : 0;
+
+	commitHistory();
 
-	// Count user/assistant messages only
-	int userAssistantCount = 0;
-	for (const ChatMessage& msg : _chatHistory) {
-		if (msg.role == "user" || msg.role == "assistant") {
-			userAssistantCount++;
+	// A widget that was never shown lays nothing out; showEvent() renders it all at once
+	if (_renderDeferred) return;
+
+	if (_viewMode == ListView) {
+		if (_streamDirty && !_chatHistory.isEmpty()) {
+			// Only the streamed row is measured and painted again
+			const int row = _chatHistory.size() - 1;
+			_messageDelegate->invalidateRow(_messageModel->index(row));
+			_messageModel->messageChanged(row);
 		}
+		_streamDirty = false;
+		_renderedCount = 0;
 	}
+	else {
+		// One edit block for everything that changed since the last frame
+		QTextCursor cursor(_chatHistoryDisplay->document());
+		cursor.beginEditBlock();
 
-	// Calculate how many to skip
-	int skipCount = (userAssistantCount > limit) ? (userAssistantCount - limit) : 0;
-	int currentCount = 0;
+		// Streamed text of a message that is already on screen
+		if (_streamDirty && _renderedCount == _chatHistory.size()) {
+			rerenderMessageBody(_chatHistory.size() - 1);
+		}
+		_streamDirty = false;
 
-	// Build context list (skip system messages, limit to recent messages)
-	for (const ChatMessage& msg : _chatHistory) {
-		if (msg.role == "user" || msg.role == "assistant") {
-			if (currentCount >= skipCount) {
-				contextMessages.append(msg);
+		// Messages appended since the last frame
+		const bool appended = (_renderedCount < _chatHistory.size());
+
+		// Queued messages stay below the last one: taken out for appends and changes, put back after
+		bool queueShown = isQueueBlock(_chatHistoryDisplay->document()->lastBlock());
+		if (queueShown && (appended || _queueDirty)) {
+			removeQueueBlocks(cursor);
+			queueShown = false;
+		}
+
+		if (appended) {
+			cursor.movePosition(QTextCursor::End);
+			for (int i = _renderedCount; i < _chatHistory.size(); ++i) {
+				insertChatMessage(cursor, _chatHistory.at(i), i);
 			}
-			currentCount++;
+			_renderedCount = _chatHistory.size();
 		}
-	}
 
-	return contextMessages;
-}
+		// Not while a load prepends above: the queue is put back once it is done
+		if (!queueShown && !_queue.isEmpty() && !IsLoadingHistory()) {
+			insertQueueBlocks(cursor);
+		}
+		_queueDirty = false;
 
-void uiChatWidget::ShowProgressIndicator()
-{
-	if (_progressBar) {
-		_progressBar->setVisible(true);
-		_progressBar->setRange(0, 0); // Ensure indeterminate mode
-		QApplication::processEvents(); // Force immediate repaint
+		{
+			CHAT_TRACE_SCOPE(_instrumentation, ChatTraceStage::Layout);
+			cursor.endEditBlock();
+		}
+
+		// Only appends push the oldest messages out; paged-in history stays until the next one
+		if (appended) {
+			trimDisplayHead();
+		}
 	}
-}
 
-void uiChatWidget::HideProgressIndicator()
-{
-	if (_progressBar) {
-		_progressBar->setVisible(false);
-		QApplication::processEvents(); // Force immediate repaint
+	if (_scrollPending) {
+		_scrollPending = false;
+		scrollToBottom();
+	}
+
+	if (_instrumentation.isEnabled()) {
+		_instrumentation.record(ChatTraceStage::Frame, frameStart, _instrumentation.now() - frameStart);
+		emit instrumentationUpdated(_instrumentation.stats());
 	}
 }
 
-QString uiChatWidget::GetInputText() const
+void uiChatWidget::insertChatMessage(QTextCursor& cursor, const ChatMessage& msg, int index)
 {
-	return _chatInputBox ? _chatInputBox->text() : QString();
+	const bool streamingTail = _streaming && index == _chatHistory.size() - 1;
+	insertChatMessage(cursor, msg, index, messageBody(msg, index, !streamingTail), false);
 }
 
-void uiChatWidget::ClearInput()
+void uiChatWidget::insertChatMessage(QTextCursor& cursor, const ChatMessage& msg, int index, const QTextDocumentFragment& body, bool atStart)
 {
-	if (_chatInputBox) {
-		_chatInputBox->clear();
+	// Extract time from timestamp
+	QString displayTime = msg.timestamp.mid(11, 8); // Extract "hh:mm:ss"
+
+	if (atStart) {
+		// Open an empty block above the first message and fill that
+		cursor.setPosition(0);
+		cursor.insertBlock(QTextBlockFormat());
+		cursor.setPosition(0);
 	}
-}
+	else if (!_chatHistoryDisplay->document()->isEmpty()) {
+		// Add separator if not the first message (isEmpty() is O(1), unlike toPlainText())
+		cursor.insertText("\n");
+	}
+	QTextBlock headerBlock = cursor.block();
 
-void uiChatWidget::SetInputEnabled(bool enabled)
-{
-	if (_chatInputBox) {
-		_chatInputBox->setEnabled(enabled);
+	// Insert sender and timestamp
+	cursor.setCharFormat(chatSenderFormat(msg.sender));
+	cursor.insertText(QString("[%1] %2:\n").arg(displayTime).arg(msg.sender));
+
+	// Reset format and render message as Markdown
+	cursor.setCharFormat(chatMessageFormat(msg.sender));
+	{
+		CHAT_TRACE_SCOPE(_instrumentation, ChatTraceStage::Insert);
+		cursor.insertFragment(body);
 	}
-	if (_sendButton) {
-		if (enabled) {
-			_sendButton->setText("Send");
-		}
-		else {
-			_sendButton->setText("Wait...");
-		}
-		_sendButton->setEnabled(enabled);
+	if (isCollapsible(msg.message)) {
+		insertCollapseLink(cursor, msg, index);
+	}
+
+	cursor.insertText("\n");
+
+	// Remember which message the new blocks belong to
+	tagMessageBlocks(headerBlock, cursor.block(), index);
+	highlightCodeBlocks(headerBlock, cursor.block(), index);
+
+	// The message that used to be first may have lost its tag in the split
+	if (atStart && cursor.block().next().isValid()) {
+		cursor.block().next().setUserState(index + 1);
 	}
 }
 
-void uiChatWidget::SetTitle(const QString& title)
+QTextDocumentFragment uiChatWidget::renderMarkdown(const ChatMessage& msg, bool cacheable)
 {
-	// Find the title label (first child of the layout)
-	QLabel* titleLabel = findChild<QLabel*>();
-	if (titleLabel) {
-		titleLabel->setText(title);
+	CHAT_TRACE_SCOPE(_instrumentation, ChatTraceStage::Markdown);
+
+	// Partial content (e.g. a reply still streaming) would only pollute the cache
+	if (!cacheable) {
+		return ChatFragmentCache::parse(msg.message, _chatHistoryDisplay->font());
 	}
+
+	return _fragmentCache.fragment(msg.message, _chatHistoryDisplay->font(), chatMessageFormat(msg.sender));
 }
 
-void uiChatWidget::ClearChatHistory()
+QTextDocumentFragment uiChatWidget::messageBody(const ChatMessage& msg, int index, bool cacheable)
 {
-	// Clear history
-	_chatHistory.clear();
+	if (!isCollapsible(msg.message)) {
+		return renderMarkdown(msg, cacheable);
+	}
 
-	// Clear display
-	if (_chatHistoryDisplay) {
-		_chatHistoryDisplay->clear();
+	// Parsed on demand and never cached, so that collapsing really releases it
+	if (_expandedMessages.contains(index)) {
+		return renderMarkdown(msg, false);
 	}
 
-	// Add welcome message back
-	AppendChatMessage("System", "Welcome! I'm your AI assistant. How can I help you today?");
-	AppendChatMessage("System", QString("Note: The assistant will remember up to %1 recent messages for context.").arg(_maxContextMessages));
+	// Collapsed: the first lines as plain text, no parse at all
+	QTextDocument preview;
+	QTextCursor cursor(&preview);
+	cursor.insertText(collapsedPreview(msg.message), chatMessageFormat(msg.sender));
+	return QTextDocumentFragment(&preview);
 }
 
-void uiChatWidget::onNewButtonClicked()
+bool uiChatWidget::isCollapsible(const QString& text) const
+{
+	return _collapseThreshold > 0 && text.size() > _collapseThreshold;
+}
+
+void uiChatWidget::insertCollapseLink(QTextCursor& cursor, const ChatMessage& msg, int index)
+{
+	const bool expanded = _expandedMessages.contains(index);
+
+	QTextCharFormat link = chatMessageFormat(msg.sender);
+	link.setAnchor(true);
+	link.setAnchorHref(QString("%1%2/%3").arg(kChatLinkScheme).arg(expanded ? "collapse" : "expand").arg(index));
+	link.setForeground(QColor("#0078d4"));
+	link.setFontUnderline(true);
+
+	// A block of its own, without the format of the last body block (e.g. a code block)
+	cursor.insertBlock(QTextBlockFormat());
+	cursor.insertText(expanded ? QString("Show less")
+		: QString("Show all (%L1 characters)").arg(msg.message.size()), link);
+	cursor.setCharFormat(chatMessageFormat(msg.sender));
+}
+
+bool uiChatWidget::openChatLink(const QString& href)
+{
+	const QStringList parts = href.mid(QLatin1String(kChatLinkScheme).size()).split('/');
+	if (!href.startsWith(kChatLinkScheme) || parts.size() != 2) return false;
+
+	// A message index, or the identifier of a queued message
+	bool ok = false;
+	const int index = parts.at(1).toInt(&ok);
+	if (!ok) return false;
+
+	if (parts.at(0) == "expand") {
+		ExpandMessage(index);
+	}
+	else if (parts.at(0) == "collapse") {
+		CollapseMessage(index);
+	}
+	else if (parts.at(0) == "edit-queued") {
+		editQueuedInInput(index);
+	}
+	else if (parts.at(0) == "cancel-queued") {
+		CancelQueuedMessage(index);
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+void uiChatWidget::SetCollapseThreshold(int characters)
+{
+	characters = qMax(0, characters);
+	if (characters == _collapseThreshold) return;
+
+	_collapseThreshold = characters;
+	_expandedMessages.clear();
+	rebuildDisplay();
+}
+
+int uiChatWidget::GetCollapseThreshold() const
+{
+	return _collapseThreshold;
+}
+
+void uiChatWidget::ExpandMessage(int index)
+{
+	if (index < 0 || index >= _chatHistory.size() || _expandedMessages.contains(index)) return;
+	if (!isCollapsible(_chatHistory.messageStringAt(index))) return;
+
+	_expandedMessages.insert(index);
+
+	// Not rendered yet: it will be, expanded
+	if (_viewMode == DocumentView && !_renderDeferred && index >= _displayFirst && index < _renderedCount) {
+		rerenderMessageBody(index);
+	}
+}
+
+void uiChatWidget::CollapseMessage(int index)
+{
+	if (!_expandedMessages.remove(index)) return;
+	if (_viewMode != DocumentView || _renderDeferred || index < _displayFirst || index >= _renderedCount) return;
+
+	rerenderMessageBody(index);
+
+	// The view may have been deep inside the message; bring its header back
+	QTextBlock header = findMessageBlock(index);
+	if (header.isValid()) {
+		const int top = qRound(_chatHistoryDisplay->document()->documentLayout()->blockBoundingRect(header).top());
+		QScrollBar* scrollBar = _chatHistoryDisplay->verticalScrollBar();
+		if (top < scrollBar->value()) {
+			scrollBar->setValue(top);
+		}
+	}
+}
+
+void uiChatWidget::rerenderMessageBody(int index)
+{
+	if (!_chatHistoryDisplay || index < 0 || index >= _chatHistory.size()) return;
+
+	QTextBlock header = findMessageBlock(index);
+	if (!header.isValid()) return;
+
+	QTextBlock trailer = lastMessageBlock(header);
+	QScrollBar* scrollBar = _chatHistoryDisplay->verticalScrollBar();
+	const bool atBottom = (scrollBar->value() == scrollBar->maximum());
+
+	const ChatMessage msg = _chatHistory.at(index);
+
+	// Replace the body blocks (between header and trailing separator) in one edit
+	QTextCursor cursor(_chatHistoryDisplay->document());
+	cursor.beginEditBlock();
+	cursor.setPosition(header.next().position());
+	cursor.setPosition(trailer.position() - 1, QTextCursor::KeepAnchor);
+	cursor.removeSelectedText();
+	cursor.setBlockFormat(QTextBlockFormat());
+	cursor.block().layout()->clearFormats();
+	cursor.setCharFormat(chatMessageFormat(msg.sender));
+	const bool streamingTail = _streaming && index == _chatHistory.size() - 1;
+	cursor.insertFragment(messageBody(msg, index, !streamingTail));
+	if (isCollapsible(msg.message)) {
+		insertCollapseLink(cursor, msg, index);
+	}
+	cursor.endEditBlock();
+
+	tagMessageBlocks(header, cursor.block().next(), index);
+	highlightCodeBlocks(header, cursor.block().next(), index);
+
+	// Follow the reply only if the user has not scrolled away
+	if (atBottom) {
+		scrollBar->setValue(scrollBar->maximum());
+	}
+}
+
+void uiChatWidget::highlightMessage(int index)
+{
+	if (!_chatHistoryDisplay || _viewMode != DocumentView || _renderDeferred) return;
+
+	QTextBlock header = findMessageBlock(index);
+	if (header.isValid()) {
+		highlightCodeBlocks(header, lastMessageBlock(header), index);
+	}
+}
+
+void uiChatWidget::highlightCodeBlocks(const QTextBlock& first, const QTextBlock& last, int index)
+{
+	// A reply still streaming is colored once complete
+	if (_streaming && index == _chatHistory.size() - 1) return;
+
+	QTextDocument* doc = _chatHistoryDisplay->document();
+	for (const DisplayCodeBlock& codeBlock : findCodeBlocks(first, last)) {
+		if (!ChatCodeHighlighter::supports(codeBlock.language)) continue;
+
+		const quint64 key = ChatCodeHighlighter::key(codeBlock.code, codeBlock.language);
+		if (const QVector<ChatCodeSpan>* spans = _codeSpans.object(key)) {
+			applyCodeSpans(doc, codeBlock, *spans);
+			continue;
+		}
+
+		// Short blocks cost less to tokenize than a round trip to the worker
+		if (codeBlock.code.size() <= kInlineTokenizeChars) {
+			const QVector<ChatCodeSpan> spans = ChatCodeHighlighter::tokenize(codeBlock.code, codeBlock.language);
+			applyCodeSpans(doc, codeBlock, spans);
+			_codeSpans.insert(key, new QVector<ChatCodeSpan>(spans), spans.size() + 1);
+			continue;
+		}
+
+		// Long ones are tokenized on the worker; the text shows plain until the spans are back
+		QVector<int>& waiting = _codeWaiting[key];
+		const bool queued = !waiting.isEmpty();
+		if (!waiting.contains(index)) {
+			waiting.append(index);
+		}
+		if (queued) continue;
+
+		const QString code = codeBlock.code;
+		const QString language = codeBlock.language;
+		_workerPool->start([this, key, code, language]() {
+			const QVector<ChatCodeSpan> spans = ChatCodeHighlighter::tokenize(code, language);
+			QMetaObject::invokeMethod(this, [this, key, spans]() {
+				onCodeTokenized(key, spans);
+			}, Qt::QueuedConnection);
+		});
+	}
+}
+
+void uiChatWidget::onCodeTokenized(quint64 key, const QVector<ChatCodeSpan>& spans)
+{
+	const QVector<int> waiting = _codeWaiting.take(key);
+	_codeSpans.insert(key, new QVector<ChatCodeSpan>(spans), spans.size() + 1);
+
+	if (!_chatHistoryDisplay || _viewMode != DocumentView || _renderDeferred) return;
+
+	// The messages may have been re-rendered, trimmed or switched away from since; match the code again
+	QTextDocument* doc = _chatHistoryDisplay->document();
+	for (int index : waiting) {
+		QTextBlock header = findMessageBlock(index);
+		if (!header.isValid()) continue;
+
+		for (const DisplayCodeBlock& codeBlock : findCodeBlocks(header, lastMessageBlock(header))) {
+			if (ChatCodeHighlighter::key(codeBlock.code, codeBlock.language) == key) {
+				applyCodeSpans(doc, codeBlock, spans);
+			}
+		}
+	}
+}
+
+void uiChatWidget::tagMessageBlocks(QTextBlock first, const QTextBlock& last, int index)
+{
+	for (QTextBlock block = first; block.isValid(); block = block.next()) {
+		block.setUserState(index);
+		if (block == last) {
+			break;
+		}
+	}
+}
+
+QTextBlock uiChatWidget::findMessageBlock(int index) const
+{
+	QTextDocument* doc = _chatHistoryDisplay->document();
+
+	// Block tags are non-decreasing message indices, so binary search for the first match
+	int lo = 0;
+	int hi = doc->blockCount() - 1;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (doc->findBlockByNumber(mid).userState() < index) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+
+	QTextBlock block = doc->findBlockByNumber(lo);
+	return (block.userState() == index) ? block : QTextBlock();
+}
+
+QTextBlock uiChatWidget::lastMessageBlock(const QTextBlock& header) const
+{
+	QTextBlock block = header;
+	while (block.next().isValid() && block.next().userState() == header.userState()) {
+		block = block.next();
+	}
+	return block;
+}
+
+void uiChatWidget::SetChatHistory(const QList<ChatMessage>& history)
+{
+	CHAT_TRACE_SCOPE(_instrumentation, ChatTraceStage::SetHistory);
+
+	_streaming = false;
+	_streamDirty = false;
+	cancelHistoryLoad();
+	cancelExportSharingArchive();
+
+	_chatHistory.assign(history);
+	_contextIndex.rebuild(_chatHistory);
+	_contextCompactor.clear();
+	resetSearch();
+	_expandedMessages.clear();
+	clearQueue();
+
+	if (_messageModel) {
+		_messageDelegate->invalidateAll();
+		_messageModel->historyReset();
+	}
+
+	// Rebuild display
+	rebuildDisplay();
+}
+
+void uiChatWidget::rebuildDisplay()
+{
+	if (!_chatHistoryDisplay) return;
+
+	cancelHistoryLoad();
+	_chatHistoryDisplay->clear();
+	_renderedCount = displayFloor();
+	_displayFirst = _renderedCount;
+
+	// Re-rendered in one edit on the next frame. The list view renders straight
+	// from the history, so the document stays empty in that mode.
+	_scrollPending = true;
+	scheduleRender();
+}
+
+void uiChatWidget::SetChatHistoryAsync(const QList<ChatMessage>& history)
+{
+	// The list view only ever parses visible rows, so there is nothing to stream in
+	if (_viewMode == ListView || history.isEmpty() || !_chatHistoryDisplay) {
+		SetChatHistory(history);
+		emit historyLoadProgress(history.size(), history.size());
+		emit historyLoadFinished();
+		return;
+	}
+
+	CHAT_TRACE_SCOPE(_instrumentation, ChatTraceStage::SetHistory);
+
+	_streaming = false;
+	_streamDirty = false;
+	cancelHistoryLoad();
+	cancelExportSharingArchive();
+	clearQueue();
+
+	_chatHistory.assign(history);
+	startHistoryLoad();
+}
+
+void uiChatWidget::startHistoryLoad()
+{
+	_contextIndex.rebuild(_chatHistory);
+	_contextCompactor.clear();
+	resetSearch();
+	_expandedMessages.clear();
+	if (_messageModel) {
+		_messageDelegate->invalidateAll();
+		_messageModel->historyReset();
+	}
+
+	renderHistoryAsync();
+}
+
+void uiChatWidget::renderHistoryAsync()
+{
+	// Loaded messages are prepended above _displayFirst; new appends render below as usual
+	_chatHistoryDisplay->clear();
+	_renderedCount = _chatHistory.size();
+	_displayFirst = _chatHistory.size();
+	_loadFloor = displayFloor();
+	_loadTotal = _chatHistory.size() - _loadFloor;
+
+	// With a history file the content is written out on the next frame
+	if (_chatHistory.log()) {
+		scheduleRender();
+	}
+
+	// Only cache misses need parsing on the worker; collapsed messages need none
+	const QFont font = _chatHistoryDisplay->font();
+	const int loadFloor = _loadFloor;
+	QVector<bool> needsParse(_chatHistory.size());
+	for (int i = loadFloor; i < _chatHistory.size(); ++i) {
+		const QString text = _chatHistory.messageStringAt(i);
+		needsParse[i] = !isCollapsible(text) && !_fragmentCache.contains(text, font, chatMessageFormat(_chatHistory.senderAt(i)));
+	}
+
+	QSharedPointer<QAtomicInt> cancelled(new QAtomicInt(0));
+	_loadCancel = cancelled;
+	const int generation = ++_loadGeneration;
+	const ChatHistoryStore snapshot = _chatHistory; // O(1): storage is implicitly shared
+
+	// QTextDocument is usable off the GUI thread as long as it has no GUI-thread parent
+	_workerPool->start([this, snapshot, needsParse, font, cancelled, generation, loadFloor]() {
+		int last = snapshot.size();
+		int chunkSize = kFirstLoadChunk;
+
+		// Newest messages first, so the viewport (at the bottom) fills immediately
+		while (last > loadFloor && !cancelled->loadAcquire()) {
+			const int first = qMax(loadFloor, last - chunkSize);
+
+			QVector<int> parsed;
+			QVector<QTextDocumentFragment> fragments;
+			for (int i = first; i < last; ++i) {
+				if (needsParse.at(i)) {
+					parsed.append(i);
+					fragments.append(ChatFragmentCache::parse(snapshot.messageStringAt(i), font));
+				}
+			}
+
+			QMetaObject::invokeMethod(this, [this, generation, first, last, parsed, fragments]() {
+				onHistoryChunkParsed(generation, first, last, parsed, fragments);
+			}, Qt::QueuedConnection);
+
+			last = first;
+			chunkSize = kLoadChunkSize;
+		}
+	});
+}
+
+void uiChatWidget::onHistoryChunkParsed(int generation, int first, int last, const QVector<int>& parsed, const QVector<QTextDocumentFragment>& fragments)
+{
+	// Drop results of a load that was superseded
+	if (generation != _loadGeneration || last != _displayFirst) return;
+
+	const QFont font = _chatHistoryDisplay->font();
+	QHash<int, QTextDocumentFragment> parsedBodies;
+	for (int k = 0; k < parsed.size(); ++k) {
+		const int index = parsed.at(k);
+		_fragmentCache.insert(_chatHistory.messageStringAt(index), font, chatMessageFormat(_chatHistory.senderAt(index)), fragments.at(k));
+		parsedBodies.insert(parsed.at(k), fragments.at(k));
+	}
+
+	prependMessages(first, last, parsedBodies);
+
+	emit historyLoadProgress(_loadTotal - (_displayFirst - _loadFloor), _loadTotal);
+	if (_displayFirst == _loadFloor) {
+		_loadCancel.reset();
+		emit historyLoadFinished();
+
+		// Queued messages were kept out of the display while it loaded
+		if (!_queue.isEmpty()) {
+			scheduleRender();
+		}
+	}
+}
+
+void uiChatWidget::prependMessages(int first, int last, const QHash<int, QTextDocumentFragment>& parsedBodies)
+{
+	QTextDocument* doc = _chatHistoryDisplay->document();
+	QScrollBar* scrollBar = _chatHistoryDisplay->verticalScrollBar();
+	const bool atBottom = (scrollBar->value() == scrollBar->maximum());
+	const int oldValue = scrollBar->value();
+	const bool wasEmpty = doc->isEmpty();
+
+	QTextCursor cursor(doc);
+	cursor.beginEditBlock();
+	if (wasEmpty) {
+		// Newest chunk: append in order
+		for (int i = first; i < last; ++i) {
+			const ChatMessage msg = _chatHistory.at(i);
+			cursor.movePosition(QTextCursor::End);
+			insertChatMessage(cursor, msg, i, parsedBodies.contains(i) ? parsedBodies.value(i) : messageBody(msg, i), false);
+		}
+	}
+	else {
+		// Older chunk: prepend above the messages already shown, newest first
+		for (int i = last - 1; i >= first; --i) {
+			const ChatMessage msg = _chatHistory.at(i);
+			insertChatMessage(cursor, msg, i, parsedBodies.contains(i) ? parsedBodies.value(i) : messageBody(msg, i), true);
+		}
+	}
+	cursor.endEditBlock();
+	_displayFirst = first;
+
+	// Keep the viewport still while history grows above it
+	if (atBottom) {
+		scrollBar->setValue(scrollBar->maximum());
+	}
+	else if (!wasEmpty) {
+		QTextBlock previousFirst = findMessageBlock(last);
+		if (previousFirst.isValid()) {
+			const qreal added = doc->documentLayout()->blockBoundingRect(previousFirst).top();
+			scrollBar->setValue(oldValue + qRound(added));
+		}
+	}
+}
+
+void uiChatWidget::onDisplayScrolled(int value)
+{
+	// Only when the user reaches the top of a document that does not start at message 0
+	if (_viewMode != DocumentView || _displayFirst == 0 || IsLoadingHistory()
+		|| _chatHistoryDisplay->document()->isEmpty()
+		|| value != _chatHistoryDisplay->verticalScrollBar()->minimum()) {
+		return;
+	}
+
+	const int first = qMax(0, _displayFirst - kPageInChunk);
+	prependMessages(first, _displayFirst, QHash<int, QTextDocumentFragment>());
+}
+
+bool uiChatWidget::ImportChatHistory(const QString& fileName)
+{
+	if (!_chatHistoryDisplay) return false;
+
+	if (_streaming) {
+		FinishStreamingMessage();
+	}
+
+	// Supersedes any running load; SetChatHistory() and friends supersede the import
+	cancelHistoryLoad();
+	QSharedPointer<QAtomicInt> cancelled(new QAtomicInt(0));
+	_loadCancel = cancelled;
+	const int generation = _loadGeneration;
+
+	_workerPool->start([this, fileName, cancelled, generation]() {
+		ChatHistoryStore imported;
+		ChatImportStats stats;
+		QString errorString;
+		const bool success = ChatImporter::read(fileName, imported, ChatImporter::Auto, &stats, &errorString,
+			[cancelled](qint64, qint64) { return !cancelled->loadAcquire(); });
+
+		// The store is implicitly shared, so handing it over copies nothing
+		QMetaObject::invokeMethod(this, [this, generation, imported, success, stats, errorString]() {
+			onHistoryImported(generation, imported, success, stats, errorString);
+		}, Qt::QueuedConnection);
+	});
+
+	return true;
+}
+
+void uiChatWidget::onHistoryImported(int generation, const ChatHistoryStore& imported, bool success, const ChatImportStats& stats, const QString& errorString)
+{
+	// Superseded (or cancelled) while the worker was reading
+	if (generation != _loadGeneration) return;
+	_loadCancel.reset();
+
+	if (success) {
+		_streaming = false;
+		_streamDirty = false;
+
+		// A history file is emptied and receives the imported messages on the next frame
+		cancelExportSharingArchive();
+		clearQueue();
+		const QSharedPointer<ChatHistoryArchive> log = _chatHistory.log();
+		_chatHistory.clear();
+		_chatHistory = imported;
+		_chatHistory.attachLog(log);
+
+		if (_viewMode == ListView || _chatHistory.isEmpty()) {
+			_contextIndex.rebuild(_chatHistory);
+			_contextCompactor.clear();
+			resetSearch();
+			_expandedMessages.clear();
+			if (_messageModel) {
+				_messageDelegate->invalidateAll();
+				_messageModel->historyReset();
+			}
+			rebuildDisplay();
+		}
+		else {
+			startHistoryLoad();
+		}
+	}
+
+	emit importFinished(success, stats, errorString);
+}
+
+int uiChatWidget::displayFloor() const
+{
+	if (!_chatHistory.log()) return 0;
+	return qMax(0, _chatHistory.size() - residentWindow());
+}
+
+int uiChatWidget::residentWindow() const
+{
+	const QSharedPointer<ChatHistoryArchive> archive = _chatHistory.log();
+	if (archive && archive->path().isEmpty() && _displayMaxMessages > 0) {
+		return _displayMaxMessages;
+	}
+	return _residentMessages;
+}
+
+void uiChatWidget::updateArchive()
+{
+	const QSharedPointer<ChatHistoryArchive> archive = _chatHistory.log();
+	if (!archive && _displayMaxMessages > 0) {
+		// Filled by persist() below; trimResident() then keeps the display window resident
+		_chatHistory.attachLog(QSharedPointer<ChatHistoryArchive>(new ChatCompressedArchive));
+	}
+	else if (archive && archive->path().isEmpty() && _displayMaxMessages <= 0) {
+		// Limit lifted: everything becomes resident again
+		_chatHistory.attachLog(QSharedPointer<ChatHistoryArchive>());
+	}
+}
+
+void uiChatWidget::trimDisplayHead()
+{
+	if (_viewMode != DocumentView || IsLoadingHistory()) return;
+	if (_displayMaxMessages <= 0 && _displayMaxBytes <= 0) return;
+
+	QTextDocument* doc = _chatHistoryDisplay->document();
+	QAbstractTextDocumentLayout* docLayout = doc->documentLayout();
+	QScrollBar* scrollBar = _chatHistoryDisplay->verticalScrollBar();
+	const bool atBottom = _scrollPending || (scrollBar->value() == scrollBar->maximum());
+	const int viewportTop = scrollBar->value();
+
+	const int keepFrom = (_displayMaxMessages > 0) ? _renderedCount - _displayMaxMessages : _displayFirst;
+	qint64 bytes = qint64(doc->characterCount()) * kRenderedBytesPerChar;
+
+	// Walk the oldest messages while a limit is exceeded; the newest one always stays
+	int first = _displayFirst;
+	QTextBlock block = doc->begin();
+	while (first < _renderedCount - 1 && (first < keepFrom || (_displayMaxBytes > 0 && bytes > _displayMaxBytes))) {
+		QTextBlock next = block;
+		int characters = 0;
+		while (next.isValid() && next.userState() <= first) {
+			characters += next.length();
+			next = next.next();
+		}
+		if (!next.isValid()) break;
+
+		// Unless the view follows the latest message, only what lies above the viewport goes
+		if (!atBottom && docLayout->blockBoundingRect(next).top() > viewportTop) break;
+
+		bytes -= qint64(characters) * kRenderedBytesPerChar;
+		block = next;
+		++first;
+	}
+	if (first == _displayFirst) return;
+
+	const qreal removedHeight = docLayout->blockBoundingRect(block).top() - docLayout->blockBoundingRect(doc->begin()).top();
+
+	QTextCursor cursor(doc);
+	cursor.beginEditBlock();
+	cursor.setPosition(block.position(), QTextCursor::KeepAnchor);
+	cursor.removeSelectedText();
+	cursor.endEditBlock();
+
+	// The merged first block keeps the tag of the first removed message
+	doc->begin().setUserState(first);
+	_displayFirst = first;
+
+	// Keep the viewport on the same messages
+	if (atBottom) {
+		scrollBar->setValue(scrollBar->maximum());
+	}
+	else {
+		scrollBar->setValue(viewportTop - qRound(removedHeight));
+	}
+}
+
+void uiChatWidget::commitHistory()
+{
+	// A streamed reply is indexed and written once it is complete
+	const int complete = _streaming ? _chatHistory.size() - 1 : _chatHistory.size();
+	_searchIndex.appendFrom(_chatHistory, complete);
+
+	updateArchive();
+	if (_chatHistory.log()) {
+		_chatHistory.persist(complete);
+		_chatHistory.trimResident(residentWindow());
+
+		// Index entries of archived messages go with them; queries reaching them read the archive
+		_searchIndex.dropBefore(_chatHistory.firstResident());
+		_contextIndex.dropBefore(_chatHistory.firstResident());
+	}
+
+	// Runs that left the context window are summarized ahead of the next request
+	scheduleSummaries();
+}
+
+void uiChatWidget::scheduleSummaries()
+{
+	if (!_contextSummarizer) return;
+
+	// Complete runs before the default window; only the most recent ones go into a context
+	const int runs = _contextCompactor.runsWithin(_contextIndex.contextCount() - _maxContextMessages);
+	_contextCompactor.forgetBefore(runs - _maxSummaries);
+	for (int run = qMax(0, runs - _maxSummaries); run < runs; ++run) {
+		if (!_contextCompactor.needsSummary(run)) continue;
+
+		// A run is a handful of messages: copied here rather than handing the worker a snapshot of the store
+		QList<ChatMessage> messages;
+		const int first = _contextCompactor.runStart(run);
+		for (int position : _contextIndex.contextPositions(first, first + _contextCompactor.runLength(), _chatHistory)) {
+			messages.append(_chatHistory.at(position));
+		}
+
+		if (!_summaryPool) {
+			_summaryPool = new QThreadPool(this);
+			_summaryPool->setMaxThreadCount(1);
+		}
+
+		const ContextSummarizer summarizer = _contextSummarizer;
+		const int session = _currentSession;
+		const int ticket = _contextCompactor.setPending(run);
+		_summaryPool->start([this, summarizer, messages, session, run, ticket]() {
+			const QString summary = summarizer(messages);
+			QMetaObject::invokeMethod(this, [this, session, run, ticket, summary]() {
+				onSummaryReady(session, run, ticket, summary);
+			}, Qt::QueuedConnection);
+		});
+	}
+}
+
+void uiChatWidget::onSummaryReady(int session, int run, int ticket, const QString& summary)
+{
+	// The session may be parked, or closed, by now
+	if (session == _currentSession) {
+		_contextCompactor.finish(run, ticket, summary);
+	}
+	else if (_sessions.contains(session)) {
+		_sessions[session].contextCompactor.finish(run, ticket, summary);
+	}
+}
+
+ChatMessage uiChatWidget::summaryMessage(int run) const
+{
+	const int n = _contextCompactor.runStart(run + 1) - 1;
+	const int last = _contextIndex.contextPositions(n, n + 1, _chatHistory).value(0);
+	return ChatMessage(_chatHistory.timestampStringAt(last), "Summary",
+		QString("Summary of earlier conversation:\n%1").arg(_contextCompactor.summary(run)), "system");
+}
+
+void uiChatWidget::SetContextSummarizer(const ContextSummarizer& summarizer, int runLength, int maxSummaries)
+{
+	_contextSummarizer = summarizer;
+	_maxSummaries = qMax(0, maxSummaries);
+
+	// Summaries of another run length cover other messages
+	_contextCompactor.setRunLength(runLength);
+	for (ChatSession& session : _sessions) {
+		session.contextCompactor.setRunLength(runLength);
+	}
+
+	scheduleSummaries();
+}
+
+int uiChatWidget::GetContextSummaryCount() const
+{
+	return _contextCompactor.summaryCount();
+}
+
+QVector<int> uiChatWidget::SearchChatHistory(const QString& query)
+{
+	// Catch up with messages added since the last frame
+	_searchIndex.appendFrom(_chatHistory, _streaming ? _chatHistory.size() - 1 : _chatHistory.size());
+	return _searchIndex.search(ChatSearchIndex::parseQuery(query), _chatHistory);
+}
+
+void uiChatWidget::ShowSearchBar()
+{
+	ensureSearchBar();
+	_searchBar->setVisible(true);
+	_searchBox->setFocus();
+	_searchBox->selectAll();
+}
+
+void uiChatWidget::HideSearchBar()
+{
+	if (_searchBar) {
+		_searchBar->setVisible(false);
+	}
+	_chatHistoryDisplay->setExtraSelections(QList<QTextEdit::ExtraSelection>());
+	_chatInputBox->setFocus();
+}
+
+void uiChatWidget::onSearchTextChanged(const QString& text)
+{
+	_searchQuery = ChatSearchIndex::parseQuery(text);
+	_searchHits = SearchChatHistory(text);
+	_searchCurrent = -1;
+
+	if (_searchHits.isEmpty()) {
+		_searchStatus->setText(_searchQuery.isEmpty() ? QString() : QString("No matches"));
+		_chatHistoryDisplay->setExtraSelections(QList<QTextEdit::ExtraSelection>());
+		return;
+	}
+
+	// Start at the newest match; Enter walks back in time
+	showSearchHit(_searchHits.size() - 1);
+}
+
+void uiChatWidget::stepSearchHit(int step)
+{
+	if (_searchHits.isEmpty()) return;
+
+	// Wrap around at both ends
+	const int count = _searchHits.size();
+	showSearchHit(((_searchCurrent + step) % count + count) % count);
+}
+
+void uiChatWidget::showSearchHit(int hit)
+{
+	_searchCurrent = hit;
+	_searchStatus->setText(QString("%1 of %2").arg(hit + 1).arg(_searchHits.size()));
+
+	const int index = _searchHits.at(hit);
+	JumpToMessage(index);
+	ExpandMessage(index); // The words may be beyond the preview of a collapsed message
+	highlightSearchHit(index);
+}
+
+void uiChatWidget::resetSearch()
+{
+	_searchIndex.clear();
+	_searchHits.clear();
+	_searchCurrent = -1;
+	if (_searchStatus) {
+		_searchStatus->clear();
+	}
+	if (_chatHistoryDisplay) {
+		_chatHistoryDisplay->setExtraSelections(QList<QTextEdit::ExtraSelection>());
+	}
+}
+
+void uiChatWidget::JumpToMessage(int index)
+{
+	if (!_chatHistoryDisplay || index < 0 || index >= _chatHistory.size()) return;
+
+	if (_viewMode == ListView) {
+		_messageListView->scrollTo(_messageModel->index(index), QAbstractItemView::PositionAtTop);
+		return;
+	}
+
+	// Render pending appends now, and page in older messages down to the target
+	if (index >= _renderedCount) {
+		_renderTimer->stop();
+		flushRender();
+	}
+	if (index < _displayFirst) {
+		if (IsLoadingHistory()) return; // The running load renders it shortly
+		prependMessages(index, _displayFirst, QHash<int, QTextDocumentFragment>());
+	}
+
+	QTextBlock header = findMessageBlock(index);
+	if (!header.isValid()) return;
+
+	const qreal top = _chatHistoryDisplay->document()->documentLayout()->blockBoundingRect(header).top();
+	_chatHistoryDisplay->verticalScrollBar()->setValue(qRound(top));
+}
+
+void uiChatWidget::highlightSearchHit(int index)
+{
+	QList<QTextEdit::ExtraSelection> selections;
+
+	QTextBlock header = findMessageBlock(index);
+	if (header.isValid()) {
+		const QTextBlock last = lastMessageBlock(header);
+
+		// The whole message
+		QTextEdit::ExtraSelection message;
+		message.format.setBackground(QColor("#fff8dc"));
+		message.cursor = QTextCursor(header);
+		message.cursor.setPosition(last.position() + last.length() - 1, QTextCursor::KeepAnchor);
+		selections.append(message);
+
+		// Every occurrence of the query words, searched in this message's blocks only
+		const QStringList highlights = _searchQuery.highlights();
+		for (QTextBlock block = header.next(); block.isValid(); block = block.next()) {
+			const QString text = block.text();
+			for (const QString& word : highlights) {
+				for (int at = text.indexOf(word, 0, Qt::CaseInsensitive); at >= 0; at = text.indexOf(word, at + word.size(), Qt::CaseInsensitive)) {
+					QTextEdit::ExtraSelection hit;
+					hit.format.setBackground(QColor("#ffd54f"));
+					hit.cursor = QTextCursor(block);
+					hit.cursor.setPosition(block.position() + at);
+					hit.cursor.setPosition(block.position() + at + word.size(), QTextCursor::KeepAnchor);
+					selections.append(hit);
+				}
+			}
+			if (block == last) {
+				break;
+			}
+		}
+	}
+
+	_chatHistoryDisplay->setExtraSelections(selections);
+}
+
+int uiChatWidget::CreateSession(const QString& title, int maxContextMessages)
+{
+	ChatSession session;
+	session.title = title;
+	session.maxContextMessages = (maxContextMessages > 0) ? maxContextMessages : _maxContextMessages;
+	session.residentMessages = _residentMessages;
+
+	// Keeps the token estimator of the current session
+	session.contextIndex = _contextIndex;
+	session.contextIndex.clear();
+	session.contextCompactor.setRunLength(_contextCompactor.runLength());
+
+	const int id = _nextSessionId++;
+	_sessions.insert(id, session);
+	return id;
+}
+
+bool uiChatWidget::SwitchToSession(int id)
+{
+	if (id == _currentSession) return true;
+	if (!_sessions.contains(id) || !_chatHistoryDisplay) return false;
+
+	// An edit of a queued message ends with the session it belongs to
+	if (_editingQueued >= 0) {
+		_editingQueued = -1;
+		_queueDirty = true;
+		scheduleRender();
+	}
+
+	// Bring the session left behind up to date, so its document can be reused as is
+	// (a widget not shown yet catches up from the session's counters later)
+	if (!_renderDeferred) {
+		FlushPendingRender();
+	}
+	const bool partial = IsLoadingHistory();
+	cancelHistoryLoad();
+
+	// Park the current session
+	const int parkedId = _currentSession;
+	ChatSession& parked = _sessions[parkedId];
+	QScrollBar* scrollBar = _chatHistoryDisplay->verticalScrollBar();
+	parked.scrollValue = (scrollBar->value() == scrollBar->maximum()) ? -1 : scrollBar->value();
+	parked.lastUsed = ++_sessionClock;
+	swapSessionState(parked);
+	if (parked.streaming) {
+		_backgroundStream = parkedId;
+	}
+
+	// Make the target current: O(1), every container is implicitly shared
+	ChatSession& target = _sessions[id];
+	swapSessionState(target);
+	if (_streaming) {
+		_backgroundStream = -1;
+	}
+	_currentSession = id;
+
+	if (_viewMode == DocumentView) {
+		QTextDocument* parkedDocument = _chatHistoryDisplay->document();
+		QTextDocument* document = _sessionDocuments.take(id);
+		const bool cached = (document != nullptr);
+		if (!cached) {
+			document = createSessionDocument();
+		}
+		_chatHistoryDisplay->setDocument(document);
+
+		// A document the cancelled load left half built is of no use later
+		if (partial) {
+			delete parkedDocument;
+		}
+		else {
+			_sessionDocuments.insert(parkedId, parkedDocument, documentCostKB(parkedDocument));
+		}
+
+		if (cached) {
+			// Pending appends and stream text of the background session render on the next frame
+			if (target.scrollValue < 0) {
+				_scrollPending = true;
+			}
+			else {
+				scrollBar->setValue(target.scrollValue);
+			}
+		}
+		else if (_chatHistory.size() - displayFloor() > kFirstLoadChunk) {
+			// Newest first, like SetChatHistoryAsync()
+			renderHistoryAsync();
+		}
+		else {
+			rebuildDisplay();
+		}
+	}
+	else {
+		_messageDelegate->invalidateAll();
+		_messageModel->historyReset();
+		_scrollPending = true;
+	}
+
+	// Search index and history file catch up on the next frame as well
+	scheduleRender();
+
+	// Matches belong to the session left behind
+	_searchHits.clear();
+	_searchCurrent = -1;
+	_chatHistoryDisplay->setExtraSelections(QList<QTextEdit::ExtraSelection>());
+	if (_searchBar) {
+		_searchStatus->clear();
+		if (_searchBar->isVisible() && !_searchBox->text().isEmpty()) {
+			onSearchTextChanged(_searchBox->text());
+		}
+	}
+
+	// A reply still pending belongs to the session left behind
+	if (_requestClock.isValid() && _replyEndMs < 0) {
+		_requestClock.invalidate();
+		_replyIndex = -1;
+		_progressTimer->stop();
+	}
+	_responseStart = -1;
+
+	emit currentSessionChanged(id);
+
+	// The queue of the session made current, sent once no reply is pending
+	emit queuedMessagesChanged(_queue.size());
+	postDispatch();
+	return true;
+}
+
+bool uiChatWidget::CloseSession(int id)
+{
+	if (!_sessions.contains(id) || _sessions.size() < 2) return false;
+
+	if (id == _currentSession) {
+		// Fall back to the most recently used other session
+		int next = -1;
+		quint64 lastUsed = 0;
+		for (auto it = _sessions.constBegin(); it != _sessions.constEnd(); ++it) {
+			if (it.key() != id && (next < 0 || it.value().lastUsed > lastUsed)) {
+				next = it.key();
+				lastUsed = it.value().lastUsed;
+			}
+		}
+		SwitchToSession(next);
+	}
+
+	ChatSession& session = _sessions[id];
+	session.history.persist(session.history.size());
+	if (_backgroundStream == id) {
+		_backgroundStream = -1;
+	}
+
+	_sessionDocuments.remove(id);
+	_sessions.remove(id);
+	return true;
+}
+
+QString uiChatWidget::GetSessionTitle(int id) const
+{
+	auto it = _sessions.constFind(id);
+	return (it != _sessions.constEnd()) ? it.value().title : QString();
+}
+
+void uiChatWidget::SetSessionTitle(int id, const QString& title)
+{
+	auto it = _sessions.find(id);
+	if (it != _sessions.end()) {
+		it.value().title = title;
+	}
+}
+
+void uiChatWidget::AppendSessionMessage(int id, const QString& sender, const QString& message)
+{
+	if (id == _currentSession) {
+		AppendChatMessage(sender, message);
+		return;
+	}
+
+	auto it = _sessions.find(id);
+	if (it == _sessions.end()) return;
+
+	// Same rule as AppendChatMessage(): an open stream is closed first
+	if (_backgroundStream == id) {
+		finishBackgroundStream();
+	}
+
+	ChatSession& session = it.value();
+	const ChatRole role = ChatHistoryStore::roleFromString(senderToRole(sender));
+	session.history.append(ChatHistoryStore::currentTimestamp(), sender, message, role);
+	session.contextIndex.appendFrom(session.history);
+}
+
+void uiChatWidget::SetSessionCacheSize(int megabytes)
+{
+	_sessionDocuments.setMaxCost(qMax(0, megabytes) * 1024);
+}
+
+qint64 uiChatWidget::GetSessionCacheUsage() const
+{
+	return qint64(_sessionDocuments.totalCost()) * 1024;
+}
+
+void uiChatWidget::swapSessionState(ChatSession& session)
+{
+	qSwap(_chatHistory, session.history);
+	qSwap(_contextIndex, session.contextIndex);
+	qSwap(_searchIndex, session.searchIndex);
+	qSwap(_contextCompactor, session.contextCompactor);
+	qSwap(_maxContextMessages, session.maxContextMessages);
+	qSwap(_residentMessages, session.residentMessages);
+	qSwap(_streaming, session.streaming);
+	qSwap(_streamDirty, session.streamDirty);
+	qSwap(_renderedCount, session.renderedCount);
+	qSwap(_displayFirst, session.displayFirst);
+	qSwap(_expandedMessages, session.expandedMessages);
+	qSwap(_queue, session.queue);
+}
+
+QTextDocument* uiChatWidget::createSessionDocument()
+{
+	// Parented to the widget: QTextEdit would delete a document it owns when another is set
+	QTextDocument* document = new QTextDocument(this);
+	document->setUndoRedoEnabled(false);
+	document->setDefaultFont(_chatHistoryDisplay->font());
+	return document;
+}
+
+void uiChatWidget::finishBackgroundStream()
+{
+	if (_backgroundStream < 0) return;
+
+	ChatSession& session = _sessions[_backgroundStream];
+	session.streaming = false;
+	session.contextIndex.updateLast(session.history);
+	session.contextCompactor.invalidateFrom(session.contextIndex.contextCountBefore(session.history.size() - 1, session.history));
+	_backgroundStream = -1;
+}
+
+bool uiChatWidget::SetHistoryFile(const QString& path, int residentMessages)
+{
+	if (_streaming) {
+		FinishStreamingMessage();
+	}
+
+	QSharedPointer<ChatHistoryLog> log;
+	if (!path.isEmpty()) {
+		log.reset(new ChatHistoryLog);
+		if (!log->open(path)) {
+			qWarning("uiChatWidget: %s", qPrintable(log->errorString()));
+			return false;
+		}
+	}
+
+	cancelHistoryLoad();
+	_residentMessages = qMax(1, residentMessages);
+	_chatHistory.attachLog(log);
+	_contextIndex.rebuild(_chatHistory);
+	_contextCompactor.clear();
+	resetSearch();
+
+	if (_messageModel) {
+		_messageDelegate->invalidateAll();
+		_messageModel->historyReset();
+	}
+
+	rebuildDisplay();
+	return true;
+}
+
+QString uiChatWidget::GetHistoryFile() const
+{
+	return _chatHistory.log() ? _chatHistory.log()->path() : QString();
+}
+
+void uiChatWidget::SetDisplayLimit(int maxMessages, qint64 maxBytes)
+{
+	_displayMaxMessages = qMax(0, maxMessages);
+	_displayMaxBytes = qMax<qint64>(0, maxBytes);
+
+	// Applied to what is shown and held right now, not only from the next message on
+	commitHistory();
+	trimDisplayHead();
+}
+
+qint64 uiChatWidget::GetHistoryMemoryUsage() const
+{
+	const QSharedPointer<ChatHistoryArchive> archive = _chatHistory.log();
+	return _chatHistory.memoryUsage() + (archive ? archive->memoryUsage() : 0)
+		+ _searchIndex.memoryUsage() + _contextIndex.memoryUsage();
+}
+
+void uiChatWidget::cancelHistoryLoad()
+{
+	if (_loadCancel) {
+		_loadCancel->storeRelease(1);
+		_loadCancel.reset();
+	}
+	++_loadGeneration;
+}
+
+void uiChatWidget::scrollToBottom()
+{
+	CHAT_TRACE_SCOPE(_instrumentation, ChatTraceStage::Scroll);
+
+	if (_viewMode == ListView) {
+		_messageListView->scrollToBottom();
+	}
+	else {
+		_chatHistoryDisplay->verticalScrollBar()->setValue(_chatHistoryDisplay->verticalScrollBar()->maximum());
+	}
+}
+
+ChatFragmentCacheStats uiChatWidget::GetFragmentCacheStats() const
+{
+	return _fragmentCache.stats();
+}
+
+void uiChatWidget::SetFragmentCacheSize(int maxCost)
+{
+	_fragmentCache.setMaxCost(maxCost);
+}
+
+void uiChatWidget::SetInstrumentationEnabled(bool enabled)
+{
+	_instrumentation.setEnabled(enabled);
+	if (!_instrumentation.isEnabled()) {
+		_responseStart = -1;
+	}
+}
+
+void uiChatWidget::ResetInstrumentation()
+{
+	_instrumentation.reset();
+	_responseStart = -1;
+}
+
+bool uiChatWidget::WriteInstrumentationTrace(const QString& fileName) const
+{
+	QSaveFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly)) return false;
+
+	return _instrumentation.writeChromeTrace(&file) && file.commit();
+}
+
+void uiChatWidget::noteAppended(ChatRole role)
+{
+	if (role != ChatRole::Assistant) return;
+
+	// The first assistant message after a request is its reply
+	if (_requestClock.isValid() && _replyIndex < 0 && _replyEndMs < 0) {
+		_replyIndex = _chatHistory.size() - 1;
+		noteReplyText();
+
+		// Appended whole unless it is the (still empty) head of a streamed reply
+		if (_firstTokenMs >= 0) {
+			_replyEndMs = _firstTokenMs;
+			updateProgressReadout();
+		}
+	}
+
+	if (_responseStart < 0) return;
+
+	// The first assistant message (or the header of a streamed reply) answers the last send
+	if (_instrumentation.isEnabled()) {
+		_instrumentation.record(ChatTraceStage::FirstResponse, _responseStart, _instrumentation.now() - _responseStart);
+	}
+	_responseStart = -1;
+}
+
+void uiChatWidget::SetViewMode(ViewMode mode)
+{
+	if (mode == _viewMode || !_chatHistoryDisplay) return;
+
+	if (mode == ListView && !_messageListView) {
+		_messageListView = new QListView(this);
+		_messageListView->setObjectName("chatHistory"); // Styled like the document view
+		_messageListView->setSelectionMode(QAbstractItemView::NoSelection);
+		_messageListView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+		_messageListView->setResizeMode(QListView::Adjust);
+		_messageListView->setLayoutMode(QListView::Batched); // Rows are laid out in batches, with estimated heights until painted
+		_messageListView->setWordWrap(true);
+
+		_messageModel = new ChatMessageModel(&_chatHistory, _messageListView);
+		_messageDelegate = new ChatMessageDelegate(_messageListView, _messageListView);
+		_messageListView->setItemDelegate(_messageDelegate);
+		_messageListView->setModel(_messageModel);
+
+		// Take the place of the document view in the layout
+		QVBoxLayout* mainLayout = qobject_cast<QVBoxLayout*>(layout());
+		if (mainLayout) {
+			mainLayout->insertWidget(mainLayout->indexOf(_chatHistoryDisplay), _messageListView, 1);
+		}
+	}
+
+	_viewMode = mode;
+	_chatHistoryDisplay->setVisible(mode == DocumentView);
+	if (_messageListView) {
+		_messageListView->setVisible(mode == ListView);
+	}
+
+	// The document is only populated while it is the active view
+	rebuildDisplay();
+}
+
+int uiChatWidget::contextWindowStart(int maxMessages, int* runs) const
+{
+	// Use provided maxMessages or fall back to member variable
+	int limit = (maxMessages > 0) ? maxMessages : _maxContextMessages;
+
+	// User/assistant positions are indexed as messages arrive, so only the tail is touched
+	const int userAssistantCount = _contextIndex.contextCount();
+
+	// Calculate how many to skip
+	int skipCount = (userAssistantCount > limit) ? (userAssistantCount - limit) : 0;
+
+	// With summaries, the window starts at a run boundary, so that no turn falls
+	// between the summaries and the window
+	*runs = 0;
+	if (_contextSummarizer) {
+		*runs = _contextCompactor.runsWithin(skipCount);
+		skipCount = _contextCompactor.runStart(*runs);
+	}
+	return skipCount;
+}
+
+QList<ChatMessage> uiChatWidget::BuildContextMessages(int maxMessages) const
+{
+	QList<ChatMessage> contextMessages;
+
+	int runs = 0;
+	const int skipCount = contextWindowStart(maxMessages, &runs);
+	const int userAssistantCount = _contextIndex.contextCount();
+
+	// Older turns: the summaries that are ready (never waited for)
+	for (int run = qMax(0, runs - _maxSummaries); run < runs; ++run) {
+		if (_contextCompactor.hasSummary(run)) {
+			contextMessages.append(summaryMessage(run));
+		}
+	}
+
+	// Build context list (skip system messages, limit to recent messages)
+	contextMessages.reserve(contextMessages.size() + userAssistantCount - skipCount);
+	for (int position : _contextIndex.contextPositions(skipCount, userAssistantCount, _chatHistory)) {
+		contextMessages.append(_chatHistory.at(position));
+	}
+
+	return contextMessages;
+}
+
+int uiChatWidget::WriteContextJson(QByteArray& out, int maxMessages) const
+{
+	int runs = 0;
+	const int skipCount = contextWindowStart(maxMessages, &runs);
+	const int userAssistantCount = _contextIndex.contextCount();
+
+	// Summaries first, as in BuildContextMessages()
+	int written = 0;
+	out.append('[');
+	for (int run = qMax(0, runs - _maxSummaries); run < runs; ++run) {
+		if (_contextCompactor.hasSummary(run)) {
+			if (written++ > 0) {
+				out.append(',');
+			}
+			const ChatMessage summary = summaryMessage(run);
+			ChatJsonWriter::appendMessage(out, summary.role, summary.message);
+		}
+	}
+
+	// Bodies are encoded from the store's arena; only archived ones are read back first
+	for (int position : _contextIndex.contextPositions(skipCount, userAssistantCount, _chatHistory)) {
+		if (written++ > 0) {
+			out.append(',');
+		}
+		const QString role = _chatHistory.roleStringAt(position);
+		if (_chatHistory.isResident(position)) {
+			ChatJsonWriter::appendMessage(out, role, _chatHistory.messageAt(position));
+		}
+		else {
+			ChatJsonWriter::appendMessage(out, role, _chatHistory.messageStringAt(position));
+		}
+	}
+	out.append(']');
+
+	return written;
+}
+
+QList<ChatMessage> uiChatWidget::BuildContextMessagesByTokens(int tokenBudget) const
+{
+	QList<ChatMessage> contextMessages;
+
+	qint64 budget = tokenBudget;
+	int end = _chatHistory.size();
+
+	// An open stream is only recounted when it finishes; count its current content now
+	if (_streaming && end > 0) {
+		--end;
+		budget -= _contextIndex.countTokens(_chatHistory, end);
+	}
+	if (budget < 0) {
+		return contextMessages;
+	}
+
+	// Longest recent window that fits, by binary search over the token prefix sums
+	const int first = _contextIndex.firstWithinBudget(budget, end, _chatHistory);
+	const int count = _contextIndex.contextCount();
+	for (int position : _contextIndex.contextPositions(_contextIndex.contextCountBefore(first, _chatHistory), count, _chatHistory)) {
+		contextMessages.append(_chatHistory.at(position));
+	}
+
+	return contextMessages;
+}
+
+void uiChatWidget::SetTokenEstimator(const ChatContextIndex::TokenEstimator& estimator)
+{
+	_contextIndex.setEstimator(estimator);
+	_contextIndex.rebuild(_chatHistory);
+
+	// Background sessions count with the same estimator
+	for (ChatSession& session : _sessions) {
+		session.contextIndex.setEstimator(estimator);
+		session.contextIndex.rebuild(session.history);
+	}
+}
+
+qint64 uiChatWidget::GetContextTokenCount() const
+{
+	qint64 tokens = _contextIndex.tokensBetween(0, _contextIndex.size());
+	if (_streaming && !_chatHistory.isEmpty()) {
+		const int last = _chatHistory.size() - 1;
+		tokens += _contextIndex.countTokens(_chatHistory, last) - _contextIndex.tokensAt(last);
+	}
+	return tokens;
+}
+
+void uiChatWidget::ShowProgressIndicator()
+{
+	ensureProgressIndicator();
+
+	// Shown with the next paint; pumping events here would re-enter the caller's slot
+	_progressBar->setRange(0, 0); // Ensure indeterminate mode
+	_progressBar->setVisible(true);
+
+	if (!_requestClock.isValid() || _replyEndMs >= 0) {
+		beginRequest();
+	}
+	_progressLabel->setVisible(true);
+	updateProgressReadout();
+	_progressTimer->start();
+}
+
+void uiChatWidget::SetProgress(int value, int maximum)
+{
+	if (maximum <= 0) {
+		ShowProgressIndicator();
+		return;
+	}
+
+	ensureProgressIndicator();
+	_progressTimer->stop();
+	_progressBar->setRange(0, maximum);
+	_progressBar->setValue(qBound(0, value, maximum));
+	_progressBar->setVisible(true);
+	_progressLabel->setText(QString("%1 / %2").arg(value).arg(maximum));
+	_progressLabel->setVisible(true);
+}
+
+void uiChatWidget::HideProgressIndicator()
+{
+	_progressTimer->stop();
+	if (!_progressBar) return;
+
+	_progressBar->setVisible(false);
+	_progressBar->setRange(0, 0);
+	_progressLabel->setVisible(false);
+}
+
+ChatStreamStats uiChatWidget::GetStreamStats() const
+{
+	ChatStreamStats stats;
+	if (!_requestClock.isValid()) return stats;
+
+	const qint64 now = (_replyEndMs >= 0) ? _replyEndMs : _requestClock.elapsed();
+	stats.elapsedMs = now;
+	stats.timeToFirstTokenMs = _firstTokenMs;
+	stats.finished = (_replyEndMs >= 0);
+
+	if (_replyIndex >= 0 && _replyIndex < _chatHistory.size() && _firstTokenMs >= 0) {
+		// Counted a few times per second at most, so the estimate of the growing reply is cheap
+		stats.tokens = _contextIndex.countTokens(_chatHistory, _replyIndex);
+		stats.streamMs = _lastTokenMs - _firstTokenMs;
+	}
+	return stats;
+}
+
+void uiChatWidget::beginRequest()
+{
+	_requestClock.start();
+	_firstTokenMs = -1;
+	_lastTokenMs = -1;
+	_replyEndMs = -1;
+	_replyIndex = -1;
+}
+
+void uiChatWidget::noteReplyText()
+{
+	if (_replyIndex < 0 || _replyIndex != _chatHistory.size() - 1 || _replyEndMs >= 0) return;
+	if (_chatHistory.messageAt(_replyIndex).isEmpty()) return;
+
+	_lastTokenMs = _requestClock.elapsed();
+	if (_firstTokenMs < 0) {
+		_firstTokenMs = _lastTokenMs;
+		updateProgressReadout();
+	}
+}
+
+void uiChatWidget::updateProgressReadout()
+{
+	const ChatStreamStats stats = GetStreamStats();
+
+	if (_progressLabel && _progressLabel->isVisible() && _progressBar->maximum() == 0) {
+		QString text;
+		if (stats.timeToFirstTokenMs < 0) {
+			text = QString("Waiting for reply | %1").arg(formatDuration(stats.elapsedMs));
+		}
+		else {
+			text = QString("First token %1").arg(formatDuration(stats.timeToFirstTokenMs));
+			if (stats.tokensPerSecond() > 0) {
+				text += QString(" | %1 tok/s").arg(stats.tokensPerSecond(), 0, 'f', 1);
+			}
+			text += QString(" | %1").arg(formatDuration(stats.elapsedMs));
+		}
+		_progressLabel->setText(text);
+	}
+
+	// Nothing changes any more once the reply is complete
+	if (stats.finished) {
+		_progressTimer->stop();
+	}
+
+	emit streamStatsUpdated(stats);
+}
+
+QString uiChatWidget::GetInputText() const
+{
+	return _chatInputBox ? _chatInputBox->text() : QString();
+}
+
+void uiChatWidget::ClearInput()
+{
+	if (_chatInputBox) {
+		_chatInputBox->clear();
+	}
+}
+
+void uiChatWidget::SetInputEnabled(bool enabled)
+{
+	_replyPending = !enabled;
+
+	// In a queued mode the input stays usable while a reply is pending; what is sent meanwhile is queued
+	const bool usable = enabled || _queueMode != NoQueue;
+	if (_chatInputBox) {
+		_chatInputBox->setEnabled(usable);
+	}
+	if (_sendButton) {
+		if (enabled) {
+			_sendButton->setText("Send");
+		}
+		else if (usable) {
+			_sendButton->setText("Queue");
+		}
+		else {
+			_sendButton->setText("Wait...");
+		}
+		_sendButton->setEnabled(usable);
+	}
+
+	// The reply is in: the next queued message goes out
+	postDispatch();
+}
+
+void uiChatWidget::SetQueueMode(QueueMode mode)
+{
+	_queueMode = mode;
+
+	// Lock or unlock the input under the new mode
+	SetInputEnabled(!_replyPending);
+}
+
+bool uiChatWidget::EditQueuedMessage(int id, const QString& text)
+{
+	const int position = queuedPosition(id);
+	if (position < 0) return false;
+
+	const QString trimmed = text.trimmed();
+	if (trimmed.isEmpty()) {
+		return CancelQueuedMessage(id);
+	}
+
+	_queue[position].text = trimmed;
+	queueChanged();
+	return true;
+}
+
+bool uiChatWidget::CancelQueuedMessage(int id)
+{
+	const int position = queuedPosition(id);
+	if (position < 0) return false;
+
+	_queue.removeAt(position);
+
+	// Cancelled while being edited: the edit goes too
+	if (_editingQueued == id) {
+		_editingQueued = -1;
+		ClearInput();
+	}
+	queueChanged();
+	return true;
+}
+
+void uiChatWidget::enqueueMessage(const QString& text)
+{
+	ChatQueuedMessage queued;
+	queued.id = _nextQueuedId++;
+	queued.text = text;
+	_queue.append(queued);
+
+	// Show it right away, below the last message
+	_scrollPending = true;
+	queueChanged();
+}
+
+void uiChatWidget::editQueuedInInput(int id)
+{
+	const int position = queuedPosition(id);
+	if (!_chatInputBox || position < 0) return;
+
+	// Held until the edit is sent (see onSendButtonClicked())
+	_editingQueued = id;
+	_chatInputBox->setText(_queue.at(position).text);
+	_chatInputBox->setFocus();
+
+	_queueDirty = true;
+	scheduleRender();
+}
+
+int uiChatWidget::queuedPosition(int id) const
+{
+	for (int i = 0; i < _queue.size(); ++i) {
+		if (_queue.at(i).id == id) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+void uiChatWidget::clearQueue()
+{
+	// Queued messages belong to the conversation; the display is rebuilt by the caller
+	if (_queue.isEmpty()) return;
+
+	_queue.clear();
+	if (_editingQueued >= 0) {
+		_editingQueued = -1;
+		ClearInput();
+	}
+	emit queuedMessagesChanged(0);
+}
+
+void uiChatWidget::queueChanged()
+{
+	_queueDirty = true;
+	scheduleRender();
+	emit queuedMessagesChanged(_queue.size());
+
+	// An edit held the queue, or the queue was waiting for the next pass
+	postDispatch();
+}
+
+void uiChatWidget::postDispatch()
+{
+	if (_replyPending || _dispatchPosted || _queue.isEmpty()) return;
+
+	// Not from inside the caller (typically the host finishing a reply): from the event loop
+	_dispatchPosted = true;
+	QMetaObject::invokeMethod(this, [this]() {
+		_dispatchPosted = false;
+		dispatchQueue();
+	}, Qt::QueuedConnection);
+}
+
+void uiChatWidget::dispatchQueue()
+{
+	if (_replyPending || _queue.isEmpty()) return;
+
+	// A message being edited holds itself and those behind it
+	int count = (_editingQueued >= 0) ? queuedPosition(_editingQueued) : _queue.size();
+	if (_queueMode != QueueBatched) {
+		count = qMin(count, 1);
+	}
+	if (count <= 0) return;
+
+	QStringList texts;
+	for (int i = 0; i < count; ++i) {
+		texts.append(_queue.takeFirst().text);
+	}
+	_queueDirty = true;
+	emit queuedMessagesChanged(_queue.size());
+
+	sendMessages(texts);
+
+	// A host that never reports a reply pending gets the rest one by one as well
+	postDispatch();
+}
+
+void uiChatWidget::insertQueueBlocks(QTextCursor& cursor)
+{
+	QTextDocument* doc = _chatHistoryDisplay->document();
+
+	cursor.movePosition(QTextCursor::End);
+	if (!doc->isEmpty()) {
+		cursor.insertText("\n");
+	}
+	const QTextBlock first = cursor.block();
+
+	QTextCharFormat header = chatSenderFormat("You");
+	header.setForeground(QColor(kQueuedColor));
+	QTextCharFormat body = chatMessageFormat("You");
+	body.setForeground(QColor(kQueuedColor));
+	body.setFontItalic(true);
+	QTextCharFormat link = chatMessageFormat("You");
+	link.setAnchor(true);
+	link.setForeground(QColor("#0078d4"));
+	link.setFontUnderline(true);
+
+	for (int i = 0; i < _queue.size(); ++i) {
+		const ChatQueuedMessage& queued = _queue.at(i);
+		if (i > 0) {
+			cursor.insertText("\n", body);
+		}
+		cursor.insertText(QString("[Queued %1/%2] You:\n").arg(i + 1).arg(_queue.size()), header);
+		cursor.insertText(queued.text + '\n', body);
+
+		if (queued.id == _editingQueued) {
+			cursor.insertText("Editing in the input box, send to update", body);
+		}
+		else {
+			link.setAnchorHref(QString("%1edit-queued/%2").arg(kChatLinkScheme).arg(queued.id));
+			cursor.insertText("Edit", link);
+		}
+		cursor.insertText("   ", body);
+		link.setAnchorHref(QString("%1cancel-queued/%2").arg(kChatLinkScheme).arg(queued.id));
+		cursor.insertText("Cancel", link);
+	}
+	cursor.insertText("\n", body);
+
+	tagMessageBlocks(first, doc->lastBlock(), kQueuedBlockState);
+}
+
+void uiChatWidget::removeQueueBlocks(QTextCursor& cursor)
+{
+	QTextDocument* doc = _chatHistoryDisplay->document();
+
+	QTextBlock first = doc->lastBlock();
+	while (isQueueBlock(first.previous())) {
+		first = first.previous();
+	}
+
+	// From the end of the last message on, so the separator before the queue goes too
+	cursor.setPosition(qMax(0, first.position() - 1));
+	cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+	cursor.removeSelectedText();
+
+	// Nothing but the queue was shown: the remaining empty block keeps no tag
+	if (doc->isEmpty()) {
+		doc->begin().setUserState(-1);
+	}
+}
+
+void uiChatWidget::SetTitle(const QString& title)
+{
+	// Find the title label (there is none if the widget was created without a title)
+	QLabel* titleLabel = findChild<QLabel*>("chatTitle");
+	if (titleLabel) {
+		titleLabel->setText(title);
+	}
+}
+
+void uiChatWidget::ClearChatHistory()
+{
+	// Drop any open stream
+	_streaming = false;
+	_streamDirty = false;
+
+	// Clear history
+	cancelExportSharingArchive();
+	_chatHistory.clear();
+	_contextIndex.clear();
+	_contextCompactor.clear();
+	resetSearch();
+	_expandedMessages.clear();
+
+	clearQueue();
+
+	// Clear display
+	rebuildDisplay();
+	if (_messageModel) {
+		_messageDelegate->invalidateAll();
+		_messageModel->historyReset();
+	}
+
+	// Add welcome message back
+	AppendChatMessage("System", "Welcome! I'm your AI assistant. How can I help you today?");
+	AppendChatMessage("System", QString("Note: The assistant will remember up to %1 recent messages for context.").arg(_maxContextMessages));
+}
+
+void uiChatWidget::onNewButtonClicked()
 {
 	// Ask for confirmation before clearing
 	QMessageBox::StandardButton reply;
@@ -510,6 +2699,13 @@ void uiChatWidget::onNewButtonClicked()
 
 void uiChatWidget::onExportButtonClicked()
 {
+	// While exporting, the button cancels
+	if (IsExporting())
+	{
+		CancelExport();
+		return;
+	}
+
 	if (_chatHistory.isEmpty())
 	{
 		QMessageBox::information(this, "Export Chat", "No chat history to export.");
@@ -520,48 +2716,111 @@ void uiChatWidget::onExportButtonClicked()
 	QString defaultFileName = QString("chat_export_%1.txt")
 		.arg(QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss"));
 
+	QString selectedFilter;
 	QString fileName = QFileDialog::getSaveFileName(this,
 		"Export Chat History",
 		defaultFileName,
-		"Text Files (*.txt);;All Files (*)");
+		ChatExporter::fileFilter(),
+		&selectedFilter);
 
 	if (fileName.isEmpty())
 	{
 		return; // User cancelled
 	}
 
-	// Write chat history to file
-	QFile file(fileName);
-	if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+	// Written on a worker thread; the outcome is reported in endExport()
+	if (ExportChatHistory(fileName, ChatExporter::formatFor(fileName, selectedFilter)))
 	{
-		QMessageBox::critical(this, "Export Error",
-			QString("Failed to open file for writing:\n%1").arg(fileName));
-		return;
+		_exportInteractive = true;
+	}
+}
+
+bool uiChatWidget::ExportChatHistory(const QString& fileName, ChatExporter::Format format)
+{
+	if (!_exporter)
+	{
+		_exporter = new ChatExporter(_workerPool, this);
+		connect(_exporter, &ChatExporter::progress, this, [this](int written, int total) {
+			_exportProgressBar->setRange(0, total);
+			_exportProgressBar->setValue(written);
+			emit exportProgress(written, total);
+		});
+		connect(_exporter, &ChatExporter::finished, this, [this]() { endExport(true); });
+		connect(_exporter, &ChatExporter::cancelled, this, [this]() { endExport(false); });
+		connect(_exporter, &ChatExporter::failed, this, [this](const QString& errorString) {
+			if (_exportInteractive)
+			{
+				QMessageBox::critical(this, "Export Error",
+					QString("Failed to export chat history to:\n%1\n\n%2").arg(_exportFileName, errorString));
+			}
+			endExport(false);
+		});
+	}
+
+	// The snapshot is an O(1) copy; the conversation goes on while the worker writes.
+	// Resident messages are copied on write, but the archive is shared: see cancelExportSharingArchive()
+	if (!_exporter->start(_chatHistory, fileName, format))
+	{
+		return false;
+	}
+
+	_exportFileName = fileName;
+	_exportInteractive = false;
+
+	if (_exportButton) {
+		_exportButton->setText("Cancel");
+		_exportButton->setToolTip("Cancel the running export");
 	}
+	ensureExportProgressBar();
+	_exportProgressBar->setRange(0, _chatHistory.size());
+	_exportProgressBar->setValue(0);
+	_exportProgressBar->setVisible(true);
+	return true;
+}
 
-	QTextStream out(&file);
-	out.setCodec("UTF-8"); // Ensure UTF-8 encoding
+void uiChatWidget::CancelExport()
+{
+	if (_exporter)
+	{
+		_exporter->cancel();
+	}
+}
 
-	// Write header
-	out << "========================================\n";
-	out << "Chat History Export\n";
-	out << "Exported: " << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") << "\n";
-	out << "Total Messages: " << _chatHistory.size() << "\n";
-	out << "========================================\n\n";
+bool uiChatWidget::IsExporting() const
+{
+	return _exporter && _exporter->isRunning();
+}
 
-	// Write each message
-	for (const ChatMessage& msg : _chatHistory)
+void uiChatWidget::cancelExportSharingArchive()
+{
+	// ChatHistoryStore::clear() truncates the archive under the snapshot. The flag is set
+	// before the truncation, so a worker that read a truncated record discards its file.
+	if (_chatHistory.log() && IsExporting())
 	{
-		out << "[" << msg.timestamp << "] " << msg.sender << ":\n";
-		out << msg.message << "\n\n";
+		CancelExport();
 	}
+}
 
-	file.close();
+void uiChatWidget::endExport(bool success)
+{
+	if (_exportButton) {
+		_exportButton->setText("Export");
+		_exportButton->setToolTip("Export chat history to file");
+	}
+	_exportProgressBar->setVisible(false);
 
-	// Notify user of success
-	QMessageBox::information(this, "Export Complete",
-		QString("Chat history exported successfully to:\n%1").arg(fileName));
+	if (success && _exportInteractive)
+	{
+		// Notify user of success
+		QMessageBox::information(this, "Export Complete",
+			QString("Chat history exported successfully to:\n%1").arg(_exportFileName));
+	}
+	_exportInteractive = false;
 
-	// Emit signal to notify parent
-	emit exportRequested();
+	emit exportFinished(success, _exportFileName);
+	if (success)
+	{
+		// Emit signal to notify parent
+		emit exportRequested();
+	}
 }
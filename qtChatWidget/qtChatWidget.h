@@ -6,6 +6,29 @@
  * ----------|---------------|------------------------------------------------------
  * 25/10/2025| Tian-Qing Ye  | Created with assistance of Claude Sonnet 4.5
  * 13/11/2025| Tian-Qing Ye  | Added new chat and export buttons and slot functions
+ * 02/02/2026| Tian-Qing Ye  | Added streaming message API (begin/append chunk/finish)
+ * 09/02/2026| Tian-Qing Ye  | Added virtualized list view mode
+ * 16/02/2026| Tian-Qing Ye  | Cache parsed markdown fragments per message
+ * 23/02/2026| Tian-Qing Ye  | Added batch append; display updates coalesced per frame
+ * 02/03/2026| Tian-Qing Ye  | Added asynchronous, newest-first SetChatHistoryAsync
+ * 09/03/2026| Tian-Qing Ye  | History kept in a compact ChatHistoryStore
+ * 16/03/2026| Tian-Qing Ye  | Added token-budgeted context building
+ * 23/03/2026| Tian-Qing Ye  | Context building costs O(k) via the context index
+ * 30/03/2026| Tian-Qing Ye  | Optional on-disk history file with lazy paging of old messages
+ * 06/04/2026| Tian-Qing Ye  | Export runs on a worker thread (text, JSONL, Markdown, HTML)
+ * 13/04/2026| Tian-Qing Ye  | Added memory-mapped import of JSONL and text transcripts
+ * 20/04/2026| Tian-Qing Ye  | Added indexed search bar with hit highlighting
+ * 27/04/2026| Tian-Qing Ye  | Added FlushPendingRender for headless use and benchmarks
+ * 04/05/2026| Tian-Qing Ye  | Optional latency instrumentation with Chrome trace export
+ * 11/05/2026| Tian-Qing Ye  | Progress indicator no longer pumps events; determinate mode and reply latency readout
+ * 18/05/2026| Tian-Qing Ye  | Multiple conversation sessions with LRU-cached rendered documents
+ * 25/05/2026| Tian-Qing Ye  | Shared theme, lazily created controls, rendering deferred to the first show
+ * 01/06/2026| Tian-Qing Ye  | Display limit with head trimming; old messages archived compressed in memory
+ * 08/06/2026| Tian-Qing Ye  | Syntax highlighting of code blocks, tokenized off the GUI thread and cached
+ * 15/06/2026| Tian-Qing Ye  | Oversized messages collapsed to a preview, parsed only when expanded
+ * 22/06/2026| Tian-Qing Ye  | Context compaction: old turns replaced by summaries made in the background
+ * 06/07/2026| Tian-Qing Ye  | Queued mode: messages sent while a reply is pending wait in the display
+ * 20/07/2026| Tian-Qing Ye  | WriteContextJson: the context serialized straight from the history store
  */
 #ifndef QT_CHATWIDGET_H
 #define QT_CHATWIDGET_H
@@ -13,13 +36,46 @@
 #include <QWidget>
 #include <QString>
 #include <QList>
+#include <QStringList>
 #include <QDateTime>
+#include <QVector>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMetaType>
+#include <QMap>
+#include <QCache>
+#include <QSet>
+#include "qtChatFragmentCache.h"
+#include "qtChatHistoryStore.h"
+#include "qtChatContextIndex.h"
+#include "qtChatExporter.h"
+#include "qtChatImporter.h"
+#include "qtChatSearchIndex.h"
+#include "qtChatInstrumentation.h"
+#include "qtChatSession.h"
+#include "qtChatCodeHighlighter.h"
+#include "qtChatContextCompactor.h"
+#include <functional>
 
  // Forward declarations
 class QTextEdit;
 class QLineEdit;
+class QLabel;
 class QPushButton;
+class QHBoxLayout;
+class QShowEvent;
 class QProgressBar;
+class QListView;
+class QThreadPool;
+class ChatMessageModel;
+class ChatMessageDelegate;
+class QTimer;
+class QTextCursor;
+class QTextBlock;
+class QTextDocument;
+class QTextDocumentFragment;
+class ChatHistoryLog;
 
 /**
  * \brief Structure to hold a single chat message
@@ -38,6 +94,23 @@ struct ChatMessage
 	}
 };
 
+/**
+ * \brief Latency and throughput of the reply to the current request
+ */
+struct ChatStreamStats
+{
+	qint64 elapsedMs = 0;				// Since the request started (frozen once the reply is complete)
+	qint64 timeToFirstTokenMs = -1;		// Until the first reply text arrived, -1 before that
+	qint64 streamMs = 0;				// From the first token to the last one so far
+	qint64 tokens = 0;					// Estimated tokens of the reply (see SetTokenEstimator())
+	bool finished = false;				// The reply is complete
+
+	//! Reply tokens per second since the first token (0 until measurable)
+	double tokensPerSecond() const { return streamMs > 0 ? tokens * 1000.0 / streamMs : 0.0; }
+};
+
+Q_DECLARE_METATYPE(ChatStreamStats)
+
 /**
  * \brief A reusable chat widget with AI assistant integration
  *
@@ -52,6 +125,19 @@ class uiChatWidget : public QWidget
 	Q_OBJECT
 
 public:
+	//! How the message history is displayed
+	enum ViewMode {
+		DocumentView,	//!< One rich-text document holding every message (default)
+		ListView		//!< Virtualized list; only visible messages are laid out and painted
+	};
+
+	//! What the input does while a reply is pending (see SetQueueMode())
+	enum QueueMode {
+		NoQueue,		//!< The input is locked until the reply is in (default)
+		QueueInOrder,	//!< Messages are queued and sent one by one, in order
+		QueueBatched	//!< Messages are queued and all sent together as one request
+	};
+
 	/**
 	 * \brief Constructor
 	 * \param title The title/header text for the chat widget
@@ -72,11 +158,59 @@ public:
 	 */
 	void AppendChatMessage(const QString& sender, const QString& message);
 
+	/**
+	 * \brief Append several messages at once (e.g. replaying a log)
+	 * \param messages Messages to append; an empty timestamp is set to now and an
+	 *        empty role is derived from the sender
+	 *
+	 * The whole batch is rendered in a single document edit on the next frame.
+	 */
+	void AppendChatMessages(const QList<ChatMessage>& messages);
+
+	/**
+	 * \brief Start a streamed message (e.g. an assistant reply arriving token by token)
+	 * \param sender The sender name (default: "Assistant")
+	 *
+	 * The message is added to the history straight away with empty content and then
+	 * grows in place with each AppendStreamingChunk() call. Only the tail of the
+	 * display is re-rendered, at most once per frame.
+	 */
+	void BeginStreamingMessage(const QString& sender = "Assistant");
+
+	/**
+	 * \brief Append a chunk of text to the message opened by BeginStreamingMessage()
+	 * \param chunk The text to append (one or more tokens)
+	 */
+	void AppendStreamingChunk(const QString& chunk);
+
+	//! Close the streamed message and render its final content
+	void FinishStreamingMessage();
+
+	//! Returns true while a streamed message is open
+	bool IsStreaming() const { return _streaming; }
+
+	/**
+	 * \brief Render pending changes now instead of on the next frame
+	 *
+	 * Display updates are normally coalesced into one edit per frame. Call this
+	 * when the display must be up to date immediately (e.g. before grabbing the
+	 * widget, or to time the rendering in a benchmark). A widget that was never
+	 * shown renders nothing until it is shown or this is called, so creating
+	 * many hidden widgets costs no layout.
+	 */
+	void FlushPendingRender();
+
 	/**
 	 * \brief Get the chat history as a list of messages
 	 * \return QList of ChatMessage structures
 	 */
-	QList<ChatMessage> GetChatHistory() const { return _chatHistory; }
+	QList<ChatMessage> GetChatHistory() const { return _chatHistory.toList(); }
+
+	/**
+	 * \brief Get read access to the compact history storage
+	 * \return The history store (roles as enums, bodies without copies)
+	 */
+	const ChatHistoryStore& GetChatHistoryStore() const { return _chatHistory; }
 
 	/**
 	 * \brief Set the entire chat history (useful for loading from file)
@@ -84,6 +218,98 @@ public:
 	 */
 	void SetChatHistory(const QList<ChatMessage>& history);
 
+	/**
+	 * \brief Set the entire chat history without blocking the GUI thread
+	 * \param history List of ChatMessage structures
+	 *
+	 * The history is available immediately. Markdown is parsed on a worker
+	 * thread; the newest messages are shown first and older ones stream in
+	 * above them in chunks. Progress is reported through historyLoadProgress()
+	 * and historyLoadFinished().
+	 */
+	void SetChatHistoryAsync(const QList<ChatMessage>& history);
+
+	/**
+	 * \brief Replace the chat history with a transcript file, without blocking the GUI thread
+	 * \param fileName A JSONL (OpenAI messages) or text export (see ChatImporter)
+	 * \return false if the widget has no display
+	 *
+	 * The file is memory-mapped and parsed on a worker thread; malformed records
+	 * are skipped. importFinished() reports the outcome and throughput, then the
+	 * history is shown like SetChatHistoryAsync() does.
+	 */
+	bool ImportChatHistory(const QString& fileName);
+
+	//! Returns true while SetChatHistoryAsync() or ImportChatHistory() is still loading
+	bool IsLoadingHistory() const { return !_loadCancel.isNull(); }
+
+	/**
+	 * \brief Get a range of the chat history
+	 * \param first Index of the first message
+	 * \param count Number of messages
+	 * \return The messages (read back from the history file if no longer in memory)
+	 */
+	QList<ChatMessage> GetChatHistoryRange(int first, int count) const { return _chatHistory.range(first, count); }
+
+	/**
+	 * \brief Back the chat history with an append-only file
+	 * \param path History file (an offset index is kept next to it); empty to detach
+	 * \param residentMessages Number of recent messages kept in memory and shown
+	 * \return false if the file cannot be opened (the history is left unchanged)
+	 *
+	 * If the file already holds a conversation, it replaces the current history;
+	 * otherwise the current history is written to it. Every later message is
+	 * appended on the next frame (a streamed reply once it is finished). Older
+	 * messages are read back on demand through a memory map: when the user
+	 * scrolls to the top of the display, by GetChatHistory() and by
+	 * GetChatHistoryRange(). SetChatHistory() and ClearChatHistory() rewrite the file.
+	 */
+	bool SetHistoryFile(const QString& path, int residentMessages = 2000);
+
+	//! Path of the history file (empty if none)
+	QString GetHistoryFile() const;
+
+	/**
+	 * \brief Bound what the pane keeps rendered and in memory (for panes running for days)
+	 * \param maxMessages Messages kept in the display (0: no limit)
+	 * \param maxBytes Estimated memory of the rendered display, in bytes (0: no limit)
+	 *
+	 * Past a limit, the oldest messages are removed from the top of the display
+	 * in one edit, without moving the viewport. Without a history file they
+	 * also leave memory for a compressed archive (see ChatCompressedArchive)
+	 * and only maxMessages stay resident; with one, SetHistoryFile() decides
+	 * what stays resident. Either way memory stays constant: the search and
+	 * context indexes drop the entries of archived messages too. Archived
+	 * messages are restored on demand: scrolling to the top pages them back
+	 * in, and JumpToMessage(), the search (which scans them), context building
+	 * and GetChatHistory() reach them as before.
+	 */
+	void SetDisplayLimit(int maxMessages, qint64 maxBytes = 0);
+
+	//! Approximate heap memory of the current history: resident messages, an in-memory archive and the indexes
+	qint64 GetHistoryMemoryUsage() const;
+
+	/**
+	 * \brief Collapse messages longer than a threshold (pasted logs, large dumps)
+	 * \param characters Length from which a message is collapsed (0: never)
+	 *
+	 * A collapsed message shows its first lines as plain text and a
+	 * "Show all" link; its markdown is parsed only when it is expanded, and
+	 * collapsing it again removes the rendered blocks. The history keeps the
+	 * full text, so context building, search and export are not affected.
+	 * Default: 20000 characters.
+	 */
+	void SetCollapseThreshold(int characters);
+
+	//! Length from which messages are collapsed (0: never)
+	int GetCollapseThreshold() const;
+
+	//! Render a collapsed message in full (as its "Show all" link does)
+	void ExpandMessage(int index);
+
+	//! Collapse an expanded message back to its preview (as its "Show less" link does)
+	void CollapseMessage(int index);
+
 	/**
 	 * \brief Clear the chat history
 	 */
@@ -93,15 +319,214 @@ public:
 	 * \brief Build context messages suitable for OpenAI API
 	 * \param maxMessages Maximum number of messages to include (-1 for all)
 	 * \return QList of recent messages (user/assistant only, excludes system notifications)
+	 *
+	 * Costs O(k) in the number of returned messages, however long the history.
+	 * With a context summarizer set, older turns are preceded by the summaries
+	 * of the runs before them (see SetContextSummarizer()).
 	 */
 	QList<ChatMessage> BuildContextMessages(int maxMessages = -1) const;
 
-	//! Show the progress indicator
+	/**
+	 * \brief Write the context as an OpenAI "messages" JSON array
+	 * \param out Buffer the UTF-8 JSON is appended to
+	 * \param maxMessages Maximum number of messages to include (-1 for all)
+	 * \return Number of messages written
+	 *
+	 * Same messages as BuildContextMessages(), serialized straight from the
+	 * history store: bodies are escaped and encoded from where they are held,
+	 * with no ChatMessage copies and no QJson* objects (see ChatJsonWriter).
+	 * Keep one buffer, reserve() it once and resize(0) it between requests,
+	 * and its capacity is reused too.
+	 */
+	int WriteContextJson(QByteArray& out, int maxMessages = -1) const;
+
+	//! Returns the summary of a run of old user/assistant messages (empty: failed); called on a background thread
+	typedef std::function<QString(const QList<ChatMessage>& messages)> ContextSummarizer;
+
+	/**
+	 * \brief Compact old turns of the context into summaries
+	 * \param summarizer Summarizes a run of messages (e.g. a call to a small
+	 *        local model); must be thread safe. An empty function turns
+	 *        compaction off.
+	 * \param runLength User/assistant messages per summarized run
+	 * \param maxSummaries Summaries of the most recent runs put into a context
+	 *
+	 * User/assistant messages are cut into fixed runs from the first one on.
+	 * As runs leave the context window, they are summarized on a background
+	 * thread, one at a time; each summary is kept until a message of its run
+	 * changes, the history is replaced, or the run falls more than
+	 * maxSummaries runs behind the default window. BuildContextMessages()
+	 * then starts with up to maxSummaries summaries (role "system"), followed
+	 * by the recent messages from the start of the run the window begins in.
+	 * So a context holds at most maxSummaries + maxMessages + runLength - 1
+	 * messages, and building it never waits: a summary that is not ready yet
+	 * is left out. BuildContextMessagesByTokens() is not compacted.
+	 */
+	void SetContextSummarizer(const ContextSummarizer& summarizer, int runLength = ChatContextCompactor::DefaultRunLength, int maxSummaries = 4);
+
+	//! Number of summaries ready for the current conversation
+	int GetContextSummaryCount() const;
+
+	/**
+	 * \brief Build context messages that fit a token budget
+	 * \param tokenBudget Maximum number of tokens of the returned messages
+	 * \return The longest run of recent user/assistant messages whose estimated
+	 *         tokens (see SetTokenEstimator()) fit the budget; empty if even the
+	 *         latest message does not fit
+	 *
+	 * Token counts are computed once per message, so this costs a binary search
+	 * plus the copy of the returned messages.
+	 */
+	QList<ChatMessage> BuildContextMessagesByTokens(int tokenBudget) const;
+
+	/**
+	 * \brief Replace the token estimator used by BuildContextMessagesByTokens()
+	 * \param estimator Returns the token count of a message body; an empty
+	 *        function restores the built-in estimate (ChatContextIndex::estimateTokens)
+	 *
+	 * Plug in a real tokenizer here when exact counts matter. All cached counts
+	 * are recomputed once.
+	 */
+	void SetTokenEstimator(const ChatContextIndex::TokenEstimator& estimator);
+
+	//! Estimated context tokens of the whole history (user/assistant messages)
+	qint64 GetContextTokenCount() const;
+
+	/**
+	 * \brief Export the chat history to a file without blocking the GUI thread
+	 * \param fileName Output file
+	 * \param format Output format (see ChatExporter::formatFor() to pick it from a file name)
+	 * \return false if an export is already running
+	 *
+	 * A snapshot of the history is written on a worker thread. Progress is
+	 * reported through exportProgress() and the outcome through exportFinished().
+	 * Messages may be appended meanwhile; clearing or replacing a history that
+	 * has an archive (history file or display limit) cancels the export.
+	 */
+	bool ExportChatHistory(const QString& fileName, ChatExporter::Format format);
+
+	//! Cancel a running export (no file is left behind)
+	void CancelExport();
+
+	//! Returns true while an export runs
+	bool IsExporting() const;
+
+	/**
+	 * \brief Search the message history
+	 * \param query Words (all must occur), prefix* words, "quoted phrases",
+	 *        from:Sender and role:user|assistant|system filters; case is ignored
+	 * \return Indices of matching messages, oldest first
+	 *
+	 * Served from an inverted index kept up to date as messages arrive.
+	 */
+	QVector<int> SearchChatHistory(const QString& query);
+
+	//! Show the search bar (also Ctrl+F); Enter and Shift+Enter step through matches
+	void ShowSearchBar();
+
+	//! Hide the search bar and its highlights (also Escape)
+	void HideSearchBar();
+
+	/**
+	 * \brief Scroll a message into view
+	 * \param index Message index in the history
+	 *
+	 * Older messages not yet in the display are rendered first.
+	 */
+	void JumpToMessage(int index);
+
+	/**
+	 * \brief Open another conversation in this widget
+	 * \param title Title of the conversation (for the application's own use)
+	 * \param maxContextMessages Context window of the conversation (-1: same as the current one)
+	 * \return Identifier of the new session (the widget starts with session 0)
+	 *
+	 * The new session starts empty and does not become current.
+	 */
+	int CreateSession(const QString& title = QString(), int maxContextMessages = -1);
+
+	/**
+	 * \brief Make another conversation current
+	 * \param id Session identifier
+	 * \return false if there is no such session
+	 *
+	 * Every session keeps its own history, context window, search index and
+	 * open stream; all other methods act on the current one. The rendered
+	 * documents of recently used sessions are cached (see SetSessionCacheSize()),
+	 * so switching back to one costs O(1). A session whose document was evicted
+	 * is rendered again newest first, like SetChatHistoryAsync() does. A history
+	 * load or import still running in the session left behind is cancelled.
+	 */
+	bool SwitchToSession(int id);
+
+	//! Identifier of the current session
+	int GetCurrentSession() const { return _currentSession; }
+
+	//! Identifiers of all sessions, ascending
+	QList<int> GetSessions() const { return _sessions.keys(); }
+
+	/**
+	 * \brief Close a conversation (its history file, if any, is brought up to date)
+	 * \param id Session identifier
+	 * \return false if there is no such session or it is the only one
+	 *
+	 * Closing the current session switches to the most recently used other one.
+	 */
+	bool CloseSession(int id);
+
+	//! Title of a session (empty if unknown)
+	QString GetSessionTitle(int id) const;
+
+	//! Rename a session
+	void SetSessionTitle(int id, const QString& title);
+
+	/**
+	 * \brief Append a message to any session, current or not
+	 * \param id Session identifier
+	 * \param sender The sender name (e.g., "Assistant")
+	 * \param message The message content
+	 *
+	 * Messages of a background session are rendered when it becomes current.
+	 * Streamed chunks always go to the session the stream was begun in.
+	 */
+	void AppendSessionMessage(int id, const QString& sender, const QString& message);
+
+	/**
+	 * \brief Bound the memory of the rendered documents cached for background sessions
+	 * \param megabytes Estimated memory budget; least recently used documents are dropped first
+	 */
+	void SetSessionCacheSize(int megabytes);
+
+	//! Estimated memory of the rendered documents cached for background sessions, in bytes
+	qint64 GetSessionCacheUsage() const;
+
+	/**
+	 * \brief Show the busy indicator with a live readout of the pending reply
+	 *
+	 * Starts the request clock unless a request is already running (sending a
+	 * message from the input box starts it too). The readout shows the elapsed
+	 * time, then the time to first token and tokens per second as the reply
+	 * is appended or streamed in. Never re-enters the event loop: the bar is
+	 * painted with the next frame.
+	 */
 	void ShowProgressIndicator();
 
-	//! Hide the progress indicator
+	/**
+	 * \brief Show determinate progress
+	 * \param value Work done
+	 * \param maximum Total work (0 switches back to the busy indicator)
+	 */
+	void SetProgress(int value, int maximum);
+
+	//! Hide the progress indicator (the request statistics are kept)
 	void HideProgressIndicator();
 
+	/**
+	 * \brief Get the latency and throughput of the reply to the current (or last) request
+	 * \return Elapsed time, time to first token and token throughput
+	 */
+	ChatStreamStats GetStreamStats() const;
+
 	/**
 	 * \brief Get the current input text
 	 * \return QString containing the input box text
@@ -114,15 +539,106 @@ public:
 	/**
 	 * \brief Enable or disable the input controls
 	 * \param enabled true to enable, false to disable
+	 *
+	 * Call with false while a reply is pending and with true once it is in.
+	 * In a queued mode the input stays usable meanwhile (see SetQueueMode()).
 	 */
 	void SetInputEnabled(bool enabled);
 
+	/**
+	 * \brief Let the user go on typing while a reply is pending
+	 * \param mode NoQueue, QueueInOrder or QueueBatched
+	 *
+	 * In a queued mode, SetInputEnabled(false) marks a reply as pending instead
+	 * of locking the input. Messages sent meanwhile show at the bottom of the
+	 * display as queued, each with Edit and Cancel links, and are not part of
+	 * the history yet. Once SetInputEnabled(true) reports the reply in, the
+	 * oldest one is appended and sent through messageSent() as if typed just
+	 * then; QueueBatched appends them all and sends them as one messageSent()
+	 * (texts separated by blank lines). A message being edited is held, with
+	 * the ones behind it, until the edit is sent. The list view does not show
+	 * the queue. Queued messages belong to the conversation: SetChatHistory(),
+	 * SetChatHistoryAsync(), an import and ClearChatHistory() drop them.
+	 */
+	void SetQueueMode(QueueMode mode);
+
+	//! Get the queue mode
+	QueueMode GetQueueMode() const { return _queueMode; }
+
+	//! Messages waiting to be sent, oldest first
+	QList<ChatQueuedMessage> GetQueuedMessages() const { return _queue; }
+
+	/**
+	 * \brief Change a queued message before it is sent
+	 * \param id Identifier of the queued message
+	 * \param text New text (empty cancels the message)
+	 * \return false if no such message is queued (e.g. it was sent already)
+	 */
+	bool EditQueuedMessage(int id, const QString& text);
+
+	//! Drop a queued message; false if no such message is queued
+	bool CancelQueuedMessage(int id);
+
 	/**
 	 * \brief Set the title/header text
 	 * \param title The new title text
 	 */
 	void SetTitle(const QString& title);
 
+	/**
+	 * \brief Switch between the document view and the virtualized list view
+	 * \param mode The view mode to use
+	 *
+	 * The list view keeps layout, memory and scroll cost flat for very long
+	 * histories. The history API behaves the same in both modes.
+	 */
+	void SetViewMode(ViewMode mode);
+
+	//! Get the current view mode
+	ViewMode GetViewMode() const { return _viewMode; }
+
+	/**
+	 * \brief Get the hit/miss counters of the parsed markdown cache
+	 * \return Counters and current size of the fragment cache
+	 */
+	ChatFragmentCacheStats GetFragmentCacheStats() const;
+
+	/**
+	 * \brief Bound the parsed markdown cache
+	 * \param maxCost Maximum total length (characters) of cached messages
+	 */
+	void SetFragmentCacheSize(int maxCost);
+
+	/**
+	 * \brief Turn the latency instrumentation on or off (off by default)
+	 * \param enabled true to time the display hot path
+	 *
+	 * Times markdown rendering, fragment insertion, document layout and
+	 * scrolling of every display update, the AppendChatMessage() and
+	 * SetChatHistory() calls, and the time from messageSent() to the first
+	 * assistant message. Has no effect in builds with QTCHATWIDGET_NO_INSTRUMENTATION.
+	 */
+	void SetInstrumentationEnabled(bool enabled);
+
+	//! Returns true while the instrumentation records
+	bool IsInstrumentationEnabled() const { return _instrumentation.isEnabled(); }
+
+	/**
+	 * \brief Get the instrumentation counters
+	 * \return Sample count, total, min, max and a latency histogram per stage
+	 */
+	ChatInstrumentationStats GetInstrumentationStats() const { return _instrumentation.stats(); }
+
+	//! Drop all instrumentation counters and trace events
+	void ResetInstrumentation();
+
+	/**
+	 * \brief Write the recorded events as Chrome trace-event JSON
+	 * \param fileName Output file (open it in chrome://tracing or ui.perfetto.dev)
+	 * \return false if the file could not be written
+	 */
+	bool WriteInstrumentationTrace(const QString& fileName) const;
+
 signals:
 	/**
 	 * \brief Emitted when the user sends a message
@@ -136,6 +652,63 @@ signals:
 	//! brief Emitted when the user starts a new conversation
 	void newConversationRequested();
 
+	/**
+	 * \brief Emitted as SetChatHistoryAsync() renders chunks of history
+	 * \param loaded Number of messages rendered so far (newest first)
+	 * \param total Number of messages being loaded
+	 */
+	void historyLoadProgress(int loaded, int total);
+
+	//! Emitted when SetChatHistoryAsync() has rendered the whole history
+	void historyLoadFinished();
+
+	/**
+	 * \brief Emitted when ImportChatHistory() has read the file
+	 * \param success false if the file could not be read (the history is unchanged)
+	 * \param stats Messages imported, records skipped and throughput
+	 * \param errorString Reason of a failure
+	 */
+	void importFinished(bool success, const ChatImportStats& stats, const QString& errorString);
+
+	/**
+	 * \brief Emitted as an export writes messages
+	 * \param written Number of messages written so far
+	 * \param total Number of messages being exported
+	 */
+	void exportProgress(int written, int total);
+
+	/**
+	 * \brief Emitted when an export ends
+	 * \param success true if the file was written, false if it failed or was cancelled
+	 * \param fileName The output file
+	 */
+	void exportFinished(bool success, const QString& fileName);
+
+	/**
+	 * \brief Emitted after each display update while the instrumentation is enabled
+	 * \param stats Counters and histograms recorded so far
+	 */
+	void instrumentationUpdated(const ChatInstrumentationStats& stats);
+
+	/**
+	 * \brief Emitted whenever the reply readout is refreshed (a few times per second while busy)
+	 * \param stats Latency and throughput of the pending reply
+	 */
+	void streamStatsUpdated(const ChatStreamStats& stats);
+
+	//! Emitted when SwitchToSession() (or closing the current session) made another session current
+	void currentSessionChanged(int id);
+
+	//! Emitted when messages are queued, edited, cancelled or sent from the queue
+	void queuedMessagesChanged(int count);
+
+protected:
+	//! Creates the header buttons and renders what was appended before the first show
+	void showEvent(QShowEvent* event) override;
+
+	//! Follows the widget's own links of the display (expand / collapse, queued messages)
+	bool eventFilter(QObject* watched, QEvent* event) override;
+
 private slots:
 	void onSendButtonClicked();
 	void onNewButtonClicked();
@@ -144,12 +717,15 @@ private slots:
 private:
 	Q_DISABLE_COPY(uiChatWidget)
 
-		//! Chat history stored as list of messages
-		QList<ChatMessage> _chatHistory;
+		//! Chat history in compact form (see ChatHistoryStore)
+		ChatHistoryStore _chatHistory;
 
 	//! Maximum number of messages to send as context (to avoid token limits)
 	int _maxContextMessages;
 
+	//! Cached token counts and user/assistant positions, kept in step with _chatHistory
+	ChatContextIndex _contextIndex;
+
 	// UI Components
 	QTextEdit* _chatHistoryDisplay;
 	QLineEdit* _chatInputBox;
@@ -157,10 +733,360 @@ private:
 	QPushButton* _newButton;
 	QPushButton* _exportButton;
 	QProgressBar* _progressBar;
+	QLabel* _progressLabel;
+
+	//! Export progress, apart from the busy indicator of the reply (both can run at once)
+	QProgressBar* _exportProgressBar;
+
+	//! Refreshes the readout next to the busy indicator
+	QTimer* _progressTimer;
+
+	//! Started when a request is sent; invalid before the first one
+	QElapsedTimer _requestClock;
+
+	//! Request clock times of the first and last reply token, and of the complete reply (-1 until then)
+	qint64 _firstTokenMs;
+	qint64 _lastTokenMs;
+	qint64 _replyEndMs;
+
+	//! History index of the reply to the running request, -1 until it arrives
+	int _replyIndex;
+
+	//! True while a streamed message is open (always the last history entry)
+	bool _streaming;
+
+	//! Streamed text has arrived since the tail was last rendered
+	bool _streamDirty;
+
+	//! Single-shot frame timer coalescing display updates
+	QTimer* _renderTimer;
+
+	//! Number of history messages already rendered into the document
+	int _renderedCount;
+
+	//! Scroll to the latest message on the next frame
+	bool _scrollPending;
+
+	//! Current view mode
+	ViewMode _viewMode;
+
+	//! Virtualized view (created on first use)
+	QListView* _messageListView;
+	ChatMessageModel* _messageModel;
+	ChatMessageDelegate* _messageDelegate;
+
+	//! Parsed markdown per message, so re-renders never re-parse
+	ChatFragmentCache _fragmentCache;
+
+	//! First history message rendered in the document (> 0 while an async load runs)
+	int _displayFirst;
+
+	//! Worker threads for background parsing
+	QThreadPool* _workerPool;
+
+	//! Cancellation flag shared with the running load worker
+	QSharedPointer<QAtomicInt> _loadCancel;
+
+	//! Bumped by every history replacement; stale worker results are ignored
+	int _loadGeneration;
+
+	//! Number of messages of the running async load
+	int _loadTotal;
+
+	//! Oldest message the running async load renders
+	int _loadFloor;
+
+	//! Messages kept in memory (and initially shown) when a history file is set
+	int _residentMessages;
+
+	//! Background export (created on first use)
+	ChatExporter* _exporter;
+
+	//! Output file of the running export
+	QString _exportFileName;
+
+	//! The running export was started from the Export button (report with message boxes)
+	bool _exportInteractive;
+
+	//! Inverted index of message bodies (complete messages, caught up once per frame)
+	ChatSearchIndex _searchIndex;
+
+	// Search bar
+	QWidget* _searchBar;
+	QLineEdit* _searchBox;
+	QLabel* _searchStatus;
+
+	//! Current query, its matches (ascending message indices) and the match shown
+	ChatSearchQuery _searchQuery;
+	QVector<int> _searchHits;
+	int _searchCurrent;
+
+	//! Optional latency counters and trace of the display hot path
+	ChatInstrumentation _instrumentation;
+
+	//! Instrumentation time of the last messageSent() still waiting for a reply, -1 if none
+	qint64 _responseStart;
+
+	//! All sessions by identifier; the current one's state lives in the members above
+	QMap<int, ChatSession> _sessions;
+	int _currentSession;
+	int _nextSessionId;
+
+	//! Bumped on every switch (orders sessions by last use)
+	quint64 _sessionClock;
+
+	//! Background session holding an open stream, -1 if none
+	int _backgroundStream;
+
+	//! Rendered documents of background sessions (LRU, cost in KB)
+	QCache<int, QTextDocument> _sessionDocuments;
+
+	//! Layouts receiving the controls created on demand
+	QHBoxLayout* _headerLayout;
+	QHBoxLayout* _progressLayout;
+
+	//! Nothing has been rendered yet: the widget was never shown and FlushPendingRender() never called
+	bool _renderDeferred;
+
+	//! Display limits (0: none), see SetDisplayLimit()
+	int _displayMaxMessages;
+	qint64 _displayMaxBytes;
+
+	//! Syntax spans of code blocks by ChatCodeHighlighter::key() (cost: spans)
+	QCache<quint64, QVector<ChatCodeSpan>> _codeSpans;
+
+	//! Code blocks being tokenized on the worker, with the messages showing them
+	QHash<quint64, QVector<int>> _codeWaiting;
+
+	//! Summarizer of old context runs (empty: no compaction) and summaries put into a context
+	ContextSummarizer _contextSummarizer;
+	int _maxSummaries;
+
+	//! Summaries of old context runs of the current session
+	ChatContextCompactor _contextCompactor;
+
+	//! Runs the summarizer, one run at a time (created on first use)
+	QThreadPool* _summaryPool;
+
+	//! Length from which messages are collapsed (0: never), and those the user expanded
+	int _collapseThreshold;
+	QSet<int> _expandedMessages;
+
+	//! The mouse is over an expand / collapse link; the viewport cursor to restore when it leaves
+	bool _overChatLink;
+	Qt::CursorShape _viewportCursor;
+
+	//! What the input does while a reply is pending
+	QueueMode _queueMode;
+
+	//! A reply is pending (SetInputEnabled(false) was called)
+	bool _replyPending;
+
+	//! Messages waiting to be sent in the current session, and the identifier of the next one
+	QList<ChatQueuedMessage> _queue;
+	int _nextQueuedId;
+
+	//! Queued message loaded into the input box for editing, -1 if none
+	int _editingQueued;
+
+	//! The queue changed since it was last rendered / a dispatch is posted
+	bool _queueDirty;
+	bool _dispatchPosted;
+
+	//! Exchange the per-session members with a parked session
+	void swapSessionState(ChatSession& session);
+
+	//! New empty document set up for the display
+	QTextDocument* createSessionDocument();
+
+	//! Close the stream left open in a background session
+	void finishBackgroundStream();
+
+	//! Record the first response latency when an assistant message arrives
+	void noteAppended(ChatRole role);
+
+	//! Start timing the reply to a new request
+	void beginRequest();
+
+	//! Note reply text arriving (a whole message, or a streamed chunk)
+	void noteReplyText();
+
+	//! Refresh the readout next to the progress bar and emit streamStatsUpdated()
+	void updateProgressReadout();
 
 	//! Create and setup the UI
 	void createUI(const QString& title);
 
+	//! Add the New and Export buttons (done when the widget is first shown)
+	void createHeaderButtons();
+
+	//! Create the search bar on first use
+	void ensureSearchBar();
+
+	//! Create the progress bar and readout on first use
+	void ensureProgressIndicator();
+
+	//! Create the export progress bar on first use
+	void ensureExportProgressBar();
+
+	//! Re-render every message into the document view
+	void rebuildDisplay();
+
+	//! Keep the latest message in view
+	void scrollToBottom();
+
+	//! Insert a message (header, markdown body, trailing separator) at the cursor
+	void insertChatMessage(QTextCursor& cursor, const ChatMessage& msg, int index);
+
+	//! Insert a message with an already parsed body, at the cursor or above the first message
+	void insertChatMessage(QTextCursor& cursor, const ChatMessage& msg, int index, const QTextDocumentFragment& body, bool atStart);
+
+	//! Render a chunk parsed by the SetChatHistoryAsync() worker
+	void onHistoryChunkParsed(int generation, int first, int last, const QVector<int>& parsed, const QVector<QTextDocumentFragment>& fragments);
+
+	//! Stop a running SetChatHistoryAsync() load
+	void cancelHistoryLoad();
+
+	//! Render the history into the (empty) document newest first, parsing on the worker
+	void renderHistoryAsync();
+
+	//! Show the current history newest first, parsing older messages on the worker
+	void startHistoryLoad();
+
+	//! Adopt the history read by an ImportChatHistory() worker
+	void onHistoryImported(int generation, const ChatHistoryStore& imported, bool success, const ChatImportStats& stats, const QString& errorString);
+
+	//! Render messages [first, last) above those shown, keeping the viewport still
+	void prependMessages(int first, int last, const QHash<int, QTextDocumentFragment>& parsedBodies);
+
+	//! Page older messages into the display when the user reaches the top
+	void onDisplayScrolled(int value);
+
+	//! Oldest message rendered when the display is rebuilt
+	int displayFloor() const;
+
+	//! Messages kept in memory: the history file's window, or the display limit when archiving in memory
+	int residentWindow() const;
+
+	//! Attach (or detach) the in-memory archive as the display limit requires
+	void updateArchive();
+
+	//! Remove the oldest messages from the top of the display while a limit is exceeded
+	void trimDisplayHead();
+
+	//! Index complete messages for search, write them to the history file and trim the resident window
+	void commitHistory();
+
+	//! Start summarizing the runs that left the context window and have no summary yet
+	void scheduleSummaries();
+
+	//! Store a summary made in the background (dropped if its run changed meanwhile)
+	void onSummaryReady(int session, int run, int ticket, const QString& summary);
+
+	//! Context message standing for a summarized run
+	ChatMessage summaryMessage(int run) const;
+
+	/**
+	 * \brief Context window of BuildContextMessages() and WriteContextJson()
+	 * \param maxMessages As for BuildContextMessages()
+	 * \param runs Receives the number of runs before the window (0 without a summarizer)
+	 * \return First user/assistant position (see ChatContextIndex) of the window
+	 */
+	int contextWindowStart(int maxMessages, int* runs) const;
+
+	//! Restore the Export button and hide the export progress bar after an export
+	void endExport(bool success);
+
+	//! Cancel a running export before the history archive its snapshot reads from is emptied
+	void cancelExportSharingArchive();
+
+	//! Run the query typed in the search bar
+	void onSearchTextChanged(const QString& text);
+
+	//! Show the match step positions away from the current one (wrapping around)
+	void stepSearchHit(int step);
+
+	//! Jump to and highlight one match
+	void showSearchHit(int hit);
+
+	//! Highlight a message and the query words in it
+	void highlightSearchHit(int index);
+
+	//! Drop the search index and matches (history replaced)
+	void resetSearch();
+
+	//! Parsed markdown of a message (from the fragment cache unless not cacheable)
+	QTextDocumentFragment renderMarkdown(const ChatMessage& msg, bool cacheable = true);
+
+	//! Body of a message as displayed: its markdown, or the preview of a collapsed one
+	QTextDocumentFragment messageBody(const ChatMessage& msg, int index, bool cacheable = true);
+
+	//! True if a message of this text is collapsed unless expanded
+	bool isCollapsible(const QString& text) const;
+
+	//! Insert the "Show all" / "Show less" link below the body of a collapsible message
+	void insertCollapseLink(QTextCursor& cursor, const ChatMessage& msg, int index);
+
+	//! Act on a link of the display; false if it is not one of the widget's links
+	bool openChatLink(const QString& href);
+
+	//! Append the user's messages and emit messageSent() once for them (the request clock starts here)
+	void sendMessages(const QStringList& texts);
+
+	//! Add a message to the queue
+	void enqueueMessage(const QString& text);
+
+	//! Load a queued message into the input box; sending it stores the edit
+	void editQueuedInInput(int id);
+
+	//! Position of a queued message, -1 if it is not queued
+	int queuedPosition(int id) const;
+
+	//! The queue changed: re-render it and notify
+	void queueChanged();
+
+	//! Drop the queued messages of a conversation that is cleared or replaced
+	void clearQueue();
+
+	//! Send queued messages on the next pass of the event loop if no reply is pending
+	void postDispatch();
+
+	//! Send the oldest queued message (or, batched, all those not held by an edit)
+	void dispatchQueue();
+
+	//! Insert the queued messages at the end of the display
+	void insertQueueBlocks(QTextCursor& cursor);
+
+	//! Remove the queued messages from the end of the display
+	void removeQueueBlocks(QTextCursor& cursor);
+
+	//! Replace the rendered body of a message with its current content
+	void rerenderMessageBody(int index);
+
+	//! Color the code blocks of a rendered message
+	void highlightMessage(int index);
+
+	//! Color the code blocks among the display blocks [first, last] of a message (cached, short or queued to the worker)
+	void highlightCodeBlocks(const QTextBlock& first, const QTextBlock& last, int index);
+
+	//! Cache spans tokenized on the worker and color the messages waiting for them
+	void onCodeTokenized(quint64 key, const QVector<ChatCodeSpan>& spans);
+
+	//! Request a display update on the next frame
+	void scheduleRender();
+
+	//! Apply all pending appends, streamed text and scrolling in one edit
+	void flushRender();
+
+	//! Tag the blocks [first, last] of the display with their message index
+	void tagMessageBlocks(QTextBlock first, const QTextBlock& last, int index);
+
+	//! Find the header block of a message in the display (invalid if not rendered)
+	QTextBlock findMessageBlock(int index) const;
+
+	//! Find the last (separator) block of a message given its header block
+	QTextBlock lastMessageBlock(const QTextBlock& header) const;
+
 	//! Helper: Convert sender name to role
 	QString senderToRole(const QString& sender) const;
 };
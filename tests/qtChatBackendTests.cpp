@@ -0,0 +1,402 @@
+/**
+ * File: qtChatBackendTests.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 16/10/2026| Tian-Qing Ye   | Created: SSE parser, and ChatBackend against the localhost mock server
+ *
+ * Runs without a display or network: every server listens on 127.0.0.1.
+ */
+#include "qtChatBackend.h"
+#include "qtChatMockServer.h"
+#include <QtTest>
+#include <QHash>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+namespace
+{
+	//! How long a request may take before a test gives up, in ms
+	const int kWaitMs = 5000;
+
+	//! Payloads of parsed events, in order
+	QList<QByteArray> eventData(const QVector<ChatSseParser::Event>& events)
+	{
+		QList<QByteArray> data;
+		for (const ChatSseParser::Event& event : events) {
+			data.append(event.data);
+		}
+		return data;
+	}
+
+	//! A conversation of one user message
+	QList<ChatMessage> conversation(const QString& text)
+	{
+		return { ChatMessage(QString(), "You", text, "user") };
+	}
+
+	/**
+	 * \brief Answers every request with a fixed HTTP response, written in pieces
+	 *
+	 * For replies ChatMockServer does not make: CRLF line ends, events cut in
+	 * the middle of a line, errors inside the stream, plain text error bodies.
+	 * The response ends with the connection.
+	 */
+	class RawReplyServer
+	{
+	public:
+		//! Pieces of the response, written this far apart
+		static const int PieceIntervalMs = 10;
+
+		explicit RawReplyServer(const QList<QByteArray>& pieces)
+			: _pieces(pieces)
+		{
+			QObject::connect(&_server, &QTcpServer::newConnection, [this]() {
+				while (QTcpSocket* socket = _server.nextPendingConnection()) {
+					QObject::connect(socket, &QTcpSocket::readyRead, socket, [this, socket]() { onReadyRead(socket); });
+					QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+				}
+			});
+		}
+
+		bool listen() { return _server.listen(QHostAddress::LocalHost); }
+
+		QUrl url() const
+		{
+			return QUrl(QString("http://127.0.0.1:%1/v1/chat/completions").arg(_server.serverPort()));
+		}
+
+	private:
+		//! Respond once the whole request (header and Content-Length bytes of body) is in
+		void onReadyRead(QTcpSocket* socket)
+		{
+			QByteArray& request = _requests[socket];
+			request += socket->readAll();
+
+			const int headerEnd = request.indexOf("\r\n\r\n");
+			if (headerEnd < 0) return;
+
+			int contentLength = 0;
+			for (const QByteArray& line : request.left(headerEnd).split('\n')) {
+				if (line.toLower().startsWith("content-length:")) {
+					contentLength = line.mid(15).trimmed().toInt();
+				}
+			}
+			if (request.size() < headerEnd + 4 + contentLength) return;
+
+			_requests.remove(socket);
+			writePiece(socket, 0);
+		}
+
+		void writePiece(QTcpSocket* socket, int index)
+		{
+			if (index == _pieces.size()) {
+				socket->disconnectFromHost();
+				return;
+			}
+			socket->write(_pieces.at(index));
+			socket->flush();
+			QTimer::singleShot(PieceIntervalMs, socket, [this, socket, index]() { writePiece(socket, index + 1); });
+		}
+
+		QTcpServer _server;
+		QList<QByteArray> _pieces;
+		QHash<QTcpSocket*, QByteArray> _requests;
+	};
+}
+
+class ChatBackendTests : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	// ChatSseParser
+	void parserSplitAcrossReads();
+	void parserByteByByte();
+	void parserCrlf();
+	void parserMultiLineData();
+	void parserFieldsAndComments();
+	void parserDone();
+	void parserReset();
+
+	// ChatBackend against ChatMockServer
+	void streamedReplyInChunks();
+	void wholeReply();
+	void failNextRequest();
+	void cancel();
+
+	// ChatBackend against fixed responses
+	void crlfSplitStream();
+	void errorInsideStream();
+	void plainTextErrorBody();
+};
+
+void ChatBackendTests::parserSplitAcrossReads()
+{
+	ChatSseParser parser;
+	QVERIFY(parser.feed("da").isEmpty());
+	QVERIFY(parser.feed("ta: hel").isEmpty());
+	QVERIFY(parser.feed("lo\n").isEmpty());
+
+	// The blank line completes the event; the next one starts in the same read
+	QCOMPARE(eventData(parser.feed("\ndata: wor")), QList<QByteArray>{ "hello" });
+	QCOMPARE(eventData(parser.feed("ld\n\n")), QList<QByteArray>{ "world" });
+}
+
+void ChatBackendTests::parserByteByByte()
+{
+	const QByteArray stream = "data: one\n\ndata: two\r\n\r\n: keep-alive\n\ndata: [DONE]\n\n";
+
+	ChatSseParser parser;
+	QList<QByteArray> data;
+	for (int i = 0; i < stream.size(); ++i) {
+		data += eventData(parser.feed(stream.mid(i, 1)));
+	}
+	QCOMPARE(data, (QList<QByteArray>{ "one", "two", "[DONE]" }));
+}
+
+void ChatBackendTests::parserCrlf()
+{
+	ChatSseParser parser;
+	QCOMPARE(eventData(parser.feed("data: a\r\n\r\n")), QList<QByteArray>{ "a" });
+
+	// "\r" and "\n" in different reads
+	QVERIFY(parser.feed("data: b\r").isEmpty());
+	QVERIFY(parser.feed("\n\r").isEmpty());
+	QCOMPARE(eventData(parser.feed("\n")), QList<QByteArray>{ "b" });
+}
+
+void ChatBackendTests::parserMultiLineData()
+{
+	ChatSseParser parser;
+	QCOMPARE(eventData(parser.feed("data: first\ndata:second\ndata:\n\n")), QList<QByteArray>{ "first\nsecond\n" });
+
+	// One leading space is dropped, the others are part of the value
+	QCOMPARE(eventData(parser.feed("data:   indented\r\ndata: x\r\n\r\n")), QList<QByteArray>{ "  indented\nx" });
+}
+
+void ChatBackendTests::parserFieldsAndComments()
+{
+	ChatSseParser parser;
+	const QVector<ChatSseParser::Event> events = parser.feed(
+		": comment\n"
+		"id: 7\n"
+		"retry: 1000\n"
+		"event: error\n"
+		"data: {\"error\":{\"message\":\"Overloaded\"}}\n"
+		"\n"
+		"event: ping\n"
+		"\n"
+		"data: after\n"
+		"\n");
+
+	// An event without data is not dispatched, and its name does not carry over
+	QCOMPARE(events.size(), 2);
+	QCOMPARE(events.at(0).name, QByteArray("error"));
+	QCOMPARE(events.at(0).data, QByteArray("{\"error\":{\"message\":\"Overloaded\"}}"));
+	QCOMPARE(events.at(1).name, QByteArray());
+	QCOMPARE(events.at(1).data, QByteArray("after"));
+}
+
+void ChatBackendTests::parserDone()
+{
+	ChatSseParser parser;
+	QCOMPARE(eventData(parser.feed("data: {\"choices\":[]}\n\ndata: [DONE]\n\n")),
+		(QList<QByteArray>{ "{\"choices\":[]}", "[DONE]" }));
+
+	// An event not ended by a blank line is never dispatched
+	QVERIFY(parser.feed("data: cut").isEmpty());
+	QVERIFY(parser.feed("\n").isEmpty());
+}
+
+void ChatBackendTests::parserReset()
+{
+	ChatSseParser parser;
+	QVERIFY(parser.feed("event: stale\ndata: half").isEmpty());
+	parser.reset();
+
+	const QVector<ChatSseParser::Event> events = parser.feed("data: fresh\n\n");
+	QCOMPARE(events.size(), 1);
+	QCOMPARE(events.at(0).name, QByteArray());
+	QCOMPARE(events.at(0).data, QByteArray("fresh"));
+}
+
+void ChatBackendTests::streamedReplyInChunks()
+{
+	ChatMockServer server;
+	QVERIFY(server.listen());
+	server.setReply([](const QJsonArray&) { return QString("one two three four"); });
+	server.setFirstTokenDelay(20);
+	server.setTokenInterval(10);
+
+	ChatBackend backend;
+	backend.setEndpoint(server.url());
+	QSignalSpy firstToken(&backend, &ChatBackend::firstToken);
+	QSignalSpy chunks(&backend, &ChatBackend::replyChunk);
+	QSignalSpy finished(&backend, &ChatBackend::replyFinished);
+	QSignalSpy failed(&backend, &ChatBackend::replyFailed);
+
+	QVERIFY(backend.send(conversation("Count to four")));
+	QVERIFY(backend.isBusy());
+	QVERIFY(!backend.send(conversation("One request at a time")));
+	QVERIFY(finished.wait(kWaitMs));
+
+	// One chunk per token, however the bytes were cut on the way
+	QStringList received;
+	for (const QList<QVariant>& arguments : chunks) {
+		received.append(arguments.at(0).toString());
+	}
+	QCOMPARE(received, (QStringList{ "one ", "two ", "three ", "four" }));
+	QCOMPARE(finished.at(0).at(0).toString(), QString("one two three four"));
+	QCOMPARE(firstToken.count(), 1);
+	QCOMPARE(failed.count(), 0);
+	QVERIFY(!backend.isBusy());
+	QCOMPARE(server.requestCount(), 1);
+}
+
+void ChatBackendTests::wholeReply()
+{
+	ChatMockServer server;
+	QVERIFY(server.listen());
+
+	ChatBackend backend;
+	backend.setEndpoint(server.url());
+	backend.setStreaming(false);
+	QSignalSpy firstToken(&backend, &ChatBackend::firstToken);
+	QSignalSpy chunks(&backend, &ChatBackend::replyChunk);
+	QSignalSpy finished(&backend, &ChatBackend::replyFinished);
+
+	QVERIFY(backend.send(conversation("Hello")));
+	QVERIFY(finished.wait(kWaitMs));
+	QCOMPARE(finished.at(0).at(0).toString(), QString("This is a mock reply to: Hello"));
+	QCOMPARE(chunks.count(), 0);
+	QCOMPARE(firstToken.count(), 1);
+}
+
+void ChatBackendTests::failNextRequest()
+{
+	ChatMockServer server;
+	QVERIFY(server.listen());
+	server.failNextRequest(429, "Rate limit reached");
+
+	ChatBackend backend;
+	backend.setEndpoint(server.url());
+	QSignalSpy chunks(&backend, &ChatBackend::replyChunk);
+	QSignalSpy finished(&backend, &ChatBackend::replyFinished);
+	QSignalSpy failed(&backend, &ChatBackend::replyFailed);
+
+	// The message of the JSON error body is reported, nothing is streamed
+	QVERIFY(backend.send(conversation("Hello")));
+	QVERIFY(failed.wait(kWaitMs));
+	QCOMPARE(failed.at(0).at(0).toString(), QString("HTTP 429: Rate limit reached"));
+	QCOMPARE(chunks.count(), 0);
+	QCOMPARE(finished.count(), 0);
+	QVERIFY(!backend.isBusy());
+
+	// Only the next request fails
+	QVERIFY(backend.send(conversation("Again")));
+	QVERIFY(finished.wait(kWaitMs));
+	QCOMPARE(finished.at(0).at(0).toString(), QString("This is a mock reply to: Again"));
+	QCOMPARE(failed.count(), 1);
+	QCOMPARE(server.requestCount(), 2);
+}
+
+void ChatBackendTests::cancel()
+{
+	ChatMockServer server;
+	QVERIFY(server.listen());
+	server.setFirstTokenDelay(10000);
+
+	ChatBackend backend;
+	backend.setEndpoint(server.url());
+	QSignalSpy cancelled(&backend, &ChatBackend::replyCancelled);
+	QSignalSpy finished(&backend, &ChatBackend::replyFinished);
+	QSignalSpy failed(&backend, &ChatBackend::replyFailed);
+
+	QVERIFY(backend.send(conversation("Hello")));
+	QTRY_COMPARE_WITH_TIMEOUT(server.requestCount(), 1, kWaitMs);
+	backend.cancel();
+
+	QCOMPARE(cancelled.count(), 1);
+	QVERIFY(!backend.isBusy());
+	QCOMPARE(finished.count(), 0);
+	QCOMPARE(failed.count(), 0);
+}
+
+void ChatBackendTests::crlfSplitStream()
+{
+	// Lines end in CRLF and are cut anywhere, even between '\r' and '\n'; one
+	// event has its JSON over two data lines; nothing after [DONE] is read
+	RawReplyServer server({
+		"HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nConnection: close\r\n\r\n",
+		"data: {\"choices\":[{\"delta\":{\"content\":\"Hel\"}}]}\r",
+		"\n\r\ndata: {\"choices\":[{\"delta\":",
+		"\r\ndata: {\"content\":\"lo\"}}]}\r\n",
+		"\r\n: keep-alive\r\n\r\ndata: [DO",
+		"NE]\r\n\r\ndata: {\"choices\":[{\"delta\":{\"content\":\" ignored\"}}]}\r\n\r\n"
+	});
+	QVERIFY(server.listen());
+
+	ChatBackend backend;
+	backend.setEndpoint(server.url());
+	QSignalSpy chunks(&backend, &ChatBackend::replyChunk);
+	QSignalSpy finished(&backend, &ChatBackend::replyFinished);
+	QSignalSpy failed(&backend, &ChatBackend::replyFailed);
+
+	QVERIFY(backend.send(conversation("Hello")));
+	QVERIFY(finished.wait(kWaitMs));
+	QCOMPARE(finished.at(0).at(0).toString(), QString("Hello"));
+	QCOMPARE(chunks.count(), 2);
+	QCOMPARE(failed.count(), 0);
+}
+
+void ChatBackendTests::errorInsideStream()
+{
+	// The server starts streaming, then reports an error as an event
+	RawReplyServer server({
+		"HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nConnection: close\r\n\r\n",
+		"data: {\"choices\":[{\"delta\":{\"content\":\"Par\"}}]}\n\n",
+		"data: {\"error\":{\"message\":\"The server is overloaded\",\"type\":\"server_error\"}}\n\n"
+	});
+	QVERIFY(server.listen());
+
+	ChatBackend backend;
+	backend.setEndpoint(server.url());
+	QSignalSpy chunks(&backend, &ChatBackend::replyChunk);
+	QSignalSpy finished(&backend, &ChatBackend::replyFinished);
+	QSignalSpy failed(&backend, &ChatBackend::replyFailed);
+
+	QVERIFY(backend.send(conversation("Hello")));
+	QVERIFY(failed.wait(kWaitMs));
+	QCOMPARE(failed.at(0).at(0).toString(), QString("The server is overloaded"));
+	QCOMPARE(chunks.count(), 1);
+	QCOMPARE(finished.count(), 0);
+}
+
+void ChatBackendTests::plainTextErrorBody()
+{
+	// Not JSON: the start of the body is the message
+	RawReplyServer server({
+		"HTTP/1.1 502 Bad Gateway\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\n",
+		"upstream ",
+		"unavailable\n"
+	});
+	QVERIFY(server.listen());
+
+	ChatBackend backend;
+	backend.setEndpoint(server.url());
+	QSignalSpy chunks(&backend, &ChatBackend::replyChunk);
+	QSignalSpy failed(&backend, &ChatBackend::replyFailed);
+
+	QVERIFY(backend.send(conversation("Hello")));
+	QVERIFY(failed.wait(kWaitMs));
+	QCOMPARE(failed.at(0).at(0).toString(), QString("HTTP 502: upstream unavailable"));
+	QCOMPARE(chunks.count(), 0);
+}
+
+QTEST_GUILESS_MAIN(ChatBackendTests)
+
+#include "qtChatBackendTests.moc"
@@ -0,0 +1,405 @@
+/**
+ * File: qtChatContextCompactorTests.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 16/10/2026| Tian-Qing Ye   | Created: ChatContextCompactor, and SetContextSummarizer with a stand-in summarizer
+ *
+ * Runs without a display (CTest sets QT_QPA_PLATFORM=offscreen).
+ */
+#include "qtChatContextCompactor.h"
+#include "qtChatWidget.h"
+#include <QtTest>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QSemaphore>
+#include <QSharedPointer>
+#include <QThread>
+
+namespace
+{
+	//! How long background summaries may take before a test gives up, in ms
+	const int kWaitMs = 5000;
+
+	/**
+	 * \brief Stands in for a local summarization model
+	 *
+	 * The summary of a run is its message texts joined by '|', so a test can
+	 * tell exactly which messages a summary was made from. Until open() is
+	 * called, every call waits at a gate: work in progress stays in progress
+	 * for as long as a test needs.
+	 */
+	class StandInSummarizer
+	{
+	public:
+		//! The summarizer to hand to SetContextSummarizer()
+		static uiChatWidget::ContextSummarizer create(const QSharedPointer<StandInSummarizer>& standIn)
+		{
+			return [standIn](const QList<ChatMessage>& messages) { return standIn->summarize(messages); };
+		}
+
+		//! Let every waiting and future call through
+		void open() { _gate.release(); }
+
+		//! Calls that have returned
+		int calls() const { return _calls.loadAcquire(); }
+
+		//! Calls made on the GUI thread (summaries must be made in the background)
+		int callsOnGuiThread() const { return _callsOnGuiThread.loadAcquire(); }
+
+		//! Summaries returned so far, in order
+		QStringList returned() const
+		{
+			QMutexLocker locker(&_mutex);
+			return _returned;
+		}
+
+	private:
+		QString summarize(const QList<ChatMessage>& messages)
+		{
+			if (QThread::currentThread() == QCoreApplication::instance()->thread()) {
+				_callsOnGuiThread.ref();
+			}
+
+			// Once opened, the gate stays open: each call passes it on
+			_gate.acquire();
+			_gate.release();
+
+			QStringList texts;
+			for (const ChatMessage& message : messages) {
+				texts.append(message.message);
+			}
+			const QString summary = texts.join('|');
+
+			QMutexLocker locker(&_mutex);
+			_returned.append(summary);
+			_calls.ref();
+			return summary;
+		}
+
+		QSemaphore _gate;
+		QAtomicInt _calls;
+		QAtomicInt _callsOnGuiThread;
+		mutable QMutex _mutex;
+		QStringList _returned;
+	};
+
+	//! Opens the gate when a test ends, before the widget waits for its summary pool
+	class GateOpener
+	{
+	public:
+		explicit GateOpener(const QSharedPointer<StandInSummarizer>& standIn) : _standIn(standIn) {}
+		~GateOpener() { _standIn->open(); }
+
+	private:
+		QSharedPointer<StandInSummarizer> _standIn;
+	};
+
+	//! A conversation of count messages "m0", "m1", ..., user and assistant in turn
+	QList<ChatMessage> conversation(int count, const QString& prefix = "m")
+	{
+		QList<ChatMessage> history;
+		for (int i = 0; i < count; ++i) {
+			const bool user = (i % 2 == 0);
+			history.append(ChatMessage("2026-10-16 09:00:00", user ? "You" : "Assistant",
+				prefix + QString::number(i), user ? "user" : "assistant"));
+		}
+		return history;
+	}
+
+	//! Contents of the summary messages that start a context, without their heading
+	QStringList summariesOf(const QList<ChatMessage>& context)
+	{
+		const QString heading("Summary of earlier conversation:\n");
+
+		QStringList summaries;
+		for (const ChatMessage& message : context) {
+			if (message.role != "system" || !message.message.startsWith(heading)) break;
+			summaries.append(message.message.mid(heading.size()));
+		}
+		return summaries;
+	}
+
+	//! Contents of the messages of a context
+	QStringList textsOf(const QList<ChatMessage>& context)
+	{
+		QStringList texts;
+		for (const ChatMessage& message : context) {
+			texts.append(message.message);
+		}
+		return texts;
+	}
+}
+
+class ChatContextCompactorTests : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	// ChatContextCompactor
+	void runs();
+	void pendingAndFinished();
+	void failedRunNotRetried();
+	void invalidateFrom();
+	void lateResultAfterInvalidate();
+	void lateResultAfterRunLength();
+	void clear();
+
+	// uiChatWidget::SetContextSummarizer() with a stand-in summarizer
+	void summarizedInBackground();
+	void changedMessageInvalidatesRun();
+	void runLengthChangeDropsLateResults();
+	void replacedHistoryDropsLateResults();
+};
+
+void ChatContextCompactorTests::runs()
+{
+	ChatContextCompactor compactor(4);
+	QCOMPARE(compactor.runLength(), 4);
+	QCOMPARE(compactor.runsWithin(-1), 0);
+	QCOMPARE(compactor.runsWithin(3), 0);
+	QCOMPARE(compactor.runsWithin(4), 1);
+	QCOMPARE(compactor.runsWithin(11), 2);
+	QCOMPARE(compactor.runStart(0), 0);
+	QCOMPARE(compactor.runStart(3), 12);
+
+	// A run holds at least one message
+	QCOMPARE(ChatContextCompactor(0).runLength(), 1);
+	compactor.setRunLength(-5);
+	QCOMPARE(compactor.runLength(), 1);
+}
+
+void ChatContextCompactorTests::pendingAndFinished()
+{
+	ChatContextCompactor compactor(4);
+	QVERIFY(compactor.needsSummary(0));
+
+	const int ticket = compactor.setPending(0);
+	QVERIFY(!compactor.needsSummary(0));
+	QVERIFY(!compactor.hasSummary(0));
+
+	QVERIFY(compactor.finish(0, ticket, "first run"));
+	QVERIFY(compactor.hasSummary(0));
+	QVERIFY(!compactor.needsSummary(0));
+	QCOMPARE(compactor.summary(0), QString("first run"));
+	QCOMPARE(compactor.summaryCount(), 1);
+
+	// Only once per ticket
+	QVERIFY(!compactor.finish(0, ticket, "again"));
+	QCOMPARE(compactor.summary(0), QString("first run"));
+}
+
+void ChatContextCompactorTests::failedRunNotRetried()
+{
+	ChatContextCompactor compactor(4);
+
+	// An empty (or blank) summary is a failure: no summary, and the run is not tried again
+	QVERIFY(compactor.finish(0, compactor.setPending(0), QString()));
+	QVERIFY(compactor.finish(1, compactor.setPending(1), " \n"));
+	QVERIFY(!compactor.hasSummary(0));
+	QVERIFY(!compactor.hasSummary(1));
+	QVERIFY(!compactor.needsSummary(0));
+	QVERIFY(!compactor.needsSummary(1));
+	QCOMPARE(compactor.summaryCount(), 0);
+
+	// Until a message of the run changes
+	compactor.invalidateFrom(4);
+	QVERIFY(!compactor.needsSummary(0));
+	QVERIFY(compactor.needsSummary(1));
+}
+
+void ChatContextCompactorTests::invalidateFrom()
+{
+	ChatContextCompactor compactor(4);
+	for (int run = 0; run < 4; ++run) {
+		QVERIFY(compactor.finish(run, compactor.setPending(run), QString("run %1").arg(run)));
+	}
+	compactor.setPending(4);
+
+	// Message 6 is in run 1: runs 1 and up go, run 0 stays
+	compactor.invalidateFrom(6);
+	QCOMPARE(compactor.summaryCount(), 1);
+	QCOMPARE(compactor.summary(0), QString("run 0"));
+	for (int run = 1; run <= 4; ++run) {
+		QVERIFY(!compactor.hasSummary(run));
+		QVERIFY(compactor.needsSummary(run));
+	}
+
+	// The first message of a run invalidates that run too
+	compactor.invalidateFrom(0);
+	QCOMPARE(compactor.summaryCount(), 0);
+	QVERIFY(compactor.needsSummary(0));
+}
+
+void ChatContextCompactorTests::lateResultAfterInvalidate()
+{
+	ChatContextCompactor compactor(4);
+	const int stale = compactor.setPending(1);
+
+	// The run changed while its summary was being made
+	compactor.invalidateFrom(5);
+	QVERIFY(!compactor.finish(1, stale, "of the old messages"));
+	QVERIFY(!compactor.hasSummary(1));
+	QVERIFY(compactor.needsSummary(1));
+
+	// The run is summarized again; the late result of the first attempt still misses
+	const int fresh = compactor.setPending(1);
+	QVERIFY(fresh != stale);
+	QVERIFY(!compactor.finish(1, stale, "of the old messages"));
+	QVERIFY(!compactor.hasSummary(1));
+	QVERIFY(compactor.finish(1, fresh, "of the new messages"));
+	QCOMPARE(compactor.summary(1), QString("of the new messages"));
+}
+
+void ChatContextCompactorTests::lateResultAfterRunLength()
+{
+	ChatContextCompactor compactor(4);
+	QVERIFY(compactor.finish(0, compactor.setPending(0), "run 0"));
+	const int stale = compactor.setPending(1);
+
+	// The same length keeps everything
+	compactor.setRunLength(4);
+	QCOMPARE(compactor.summaryCount(), 1);
+	QVERIFY(!compactor.needsSummary(1));
+
+	// Another length makes every run cover other messages
+	compactor.setRunLength(2);
+	QCOMPARE(compactor.runLength(), 2);
+	QCOMPARE(compactor.summaryCount(), 0);
+	QVERIFY(compactor.needsSummary(0));
+	QVERIFY(compactor.needsSummary(1));
+
+	// Run 1 is pending again under the new length: the old ticket does not match it
+	const int fresh = compactor.setPending(1);
+	QVERIFY(!compactor.finish(1, stale, "messages 4 to 7"));
+	QVERIFY(compactor.finish(1, fresh, "messages 2 and 3"));
+	QCOMPARE(compactor.summary(1), QString("messages 2 and 3"));
+}
+
+void ChatContextCompactorTests::clear()
+{
+	ChatContextCompactor compactor(4);
+	QVERIFY(compactor.finish(0, compactor.setPending(0), "run 0"));
+	QVERIFY(compactor.finish(1, compactor.setPending(1), QString()));
+	const int pending = compactor.setPending(2);
+
+	compactor.clear();
+	QCOMPARE(compactor.runLength(), 4);
+	QCOMPARE(compactor.summaryCount(), 0);
+	for (int run = 0; run < 3; ++run) {
+		QVERIFY(compactor.needsSummary(run));
+	}
+	QVERIFY(!compactor.finish(2, pending, "run 2"));
+}
+
+void ChatContextCompactorTests::summarizedInBackground()
+{
+	const QSharedPointer<StandInSummarizer> standIn(new StandInSummarizer);
+
+	// 16 messages, a window of 4: runs 0 to 2 left it
+	uiChatWidget widget("Test", "Test", 4);
+	GateOpener opener(standIn);
+	widget.SetChatHistory(conversation(16));
+	widget.SetContextSummarizer(StandInSummarizer::create(standIn), 4, 4);
+
+	// Every summary is still being made: the context does not wait for them
+	const QList<ChatMessage> waiting = widget.BuildContextMessages();
+	QCOMPARE(textsOf(waiting), (QStringList{ "m12", "m13", "m14", "m15" }));
+	QCOMPARE(widget.GetContextSummaryCount(), 0);
+
+	QByteArray json;
+	QCOMPARE(widget.WriteContextJson(json), 4);
+	QCOMPARE(standIn->calls(), 0);
+
+	// Once made, they start the context, oldest first, followed by the window
+	standIn->open();
+	QTRY_COMPARE_WITH_TIMEOUT(widget.GetContextSummaryCount(), 3, kWaitMs);
+	QCOMPARE(standIn->callsOnGuiThread(), 0);
+
+	const QList<ChatMessage> context = widget.BuildContextMessages();
+	QCOMPARE(summariesOf(context), (QStringList{ "m0|m1|m2|m3", "m4|m5|m6|m7", "m8|m9|m10|m11" }));
+	QCOMPARE(context.size(), 3 + 4);
+	QCOMPARE(textsOf(context).mid(3), (QStringList{ "m12", "m13", "m14", "m15" }));
+	for (int i = 0; i < 3; ++i) {
+		QCOMPARE(context.at(i).role, QString("system"));
+	}
+
+	// The direct JSON writer puts in the same messages
+	json.resize(0);
+	QCOMPARE(widget.WriteContextJson(json), context.size());
+}
+
+void ChatContextCompactorTests::changedMessageInvalidatesRun()
+{
+	const QSharedPointer<StandInSummarizer> standIn(new StandInSummarizer);
+
+	// No window: every complete run is summarized, up to the last message
+	uiChatWidget widget("Test", "Test", 0);
+	GateOpener opener(standIn);
+	widget.SetChatHistory(conversation(7));
+	widget.SetContextSummarizer(StandInSummarizer::create(standIn), 4, 4);
+
+	// A streamed reply completes run 1 while it is still empty, and its summary is started
+	widget.BeginStreamingMessage("Assistant");
+	widget.FlushPendingRender();
+
+	// The reply is then written: run 1 changed under the summary being made
+	widget.AppendStreamingChunk("final ");
+	widget.AppendStreamingChunk("words");
+	widget.FinishStreamingMessage();
+	widget.FlushPendingRender();
+
+	// Run 0, run 1 as it was (dropped by its ticket), then run 1 as it is
+	standIn->open();
+	QTRY_COMPARE_WITH_TIMEOUT(standIn->calls(), 3, kWaitMs);
+	QTRY_COMPARE_WITH_TIMEOUT(widget.GetContextSummaryCount(), 2, kWaitMs);
+	QVERIFY(standIn->returned().contains("m4|m5|m6|"));
+
+	QCOMPARE(summariesOf(widget.BuildContextMessages()), (QStringList{ "m0|m1|m2|m3", "m4|m5|m6|final words" }));
+}
+
+void ChatContextCompactorTests::runLengthChangeDropsLateResults()
+{
+	const QSharedPointer<StandInSummarizer> standIn(new StandInSummarizer);
+
+	// 12 messages, a window of 4: runs of 4 put runs 0 and 1 to work
+	uiChatWidget widget("Test", "Test", 4);
+	GateOpener opener(standIn);
+	widget.SetChatHistory(conversation(12));
+	widget.SetContextSummarizer(StandInSummarizer::create(standIn), 4, 4);
+
+	// Runs of 2 while they are being made: runs 0 to 3 cover the same 8 messages
+	widget.SetContextSummarizer(StandInSummarizer::create(standIn), 2, 4);
+
+	// The two results for runs of 4 come in first and are dropped
+	standIn->open();
+	QTRY_COMPARE_WITH_TIMEOUT(standIn->calls(), 2 + 4, kWaitMs);
+	QTRY_COMPARE_WITH_TIMEOUT(widget.GetContextSummaryCount(), 4, kWaitMs);
+
+	QCOMPARE(summariesOf(widget.BuildContextMessages()), (QStringList{ "m0|m1", "m2|m3", "m4|m5", "m6|m7" }));
+}
+
+void ChatContextCompactorTests::replacedHistoryDropsLateResults()
+{
+	const QSharedPointer<StandInSummarizer> standIn(new StandInSummarizer);
+
+	// 8 messages, a window of 4: run 0 left it
+	uiChatWidget widget("Test", "Test", 4);
+	GateOpener opener(standIn);
+	widget.SetChatHistory(conversation(8, "old"));
+	widget.SetContextSummarizer(StandInSummarizer::create(standIn), 4, 4);
+
+	// A new conversation while run 0 of the old one is being summarized
+	widget.SetChatHistory(conversation(8, "new"));
+
+	standIn->open();
+	QTRY_COMPARE_WITH_TIMEOUT(standIn->calls(), 2, kWaitMs);
+	QTRY_COMPARE_WITH_TIMEOUT(widget.GetContextSummaryCount(), 1, kWaitMs);
+
+	QCOMPARE(summariesOf(widget.BuildContextMessages()), QStringList{ "new0|new1|new2|new3" });
+}
+
+QTEST_MAIN(ChatContextCompactorTests)
+
+#include "qtChatContextCompactorTests.moc"
@@ -0,0 +1,211 @@
+/**
+ * File: qtChatDisplayLimitTests.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 16/10/2026| Tian-Qing Ye   | Created: archived messages under a display limit, against an unlimited pane
+ *
+ * Runs without a display (CTest sets QT_QPA_PLATFORM=offscreen).
+ */
+#include "qtChatHistoryArchive.h"
+#include "qtChatWidget.h"
+#include <QtTest>
+
+namespace
+{
+	//! How long background summaries may take before a test gives up, in ms
+	const int kWaitMs = 5000;
+
+	//! Messages first..first+count-1: alternating user and assistant, with words shared by some of them
+	QList<ChatMessage> batch(int first, int count)
+	{
+		QList<ChatMessage> messages;
+		for (int i = first; i < first + count; ++i) {
+			const bool user = (i % 2 == 0);
+			QString text = QString("msg%1 common").arg(i);
+			if (i % 7 == 0) {
+				text += " alpha";
+			}
+			text += user ? " question" : " reply with more words";
+			messages.append(ChatMessage("2026-10-16 09:00:00", user ? "You" : "Assistant", text, user ? "user" : "assistant"));
+		}
+		return messages;
+	}
+
+	//! Append messages [first, first + count) in batches of ten, rendering each
+	void fill(uiChatWidget& widget, int first, int count)
+	{
+		for (int i = first; i < first + count; i += 10) {
+			widget.AppendChatMessages(batch(i, qMin(10, first + count - i)));
+			widget.FlushPendingRender();
+		}
+	}
+
+	QStringList textsOf(const QList<ChatMessage>& messages)
+	{
+		QStringList texts;
+		for (const ChatMessage& message : messages) {
+			texts.append(message.role + ": " + message.message);
+		}
+		return texts;
+	}
+
+	ChatLogRecord record(int i)
+	{
+		ChatLogRecord record;
+		record.timestamp = 1000 * i;
+		record.role = (i % 2) ? ChatRole::Assistant : ChatRole::User;
+		record.sender = (i % 2) ? "Assistant" : "You";
+		record.message = QString("record %1 ").arg(i) + QString(i % 50, QChar('x'));
+		return record;
+	}
+}
+
+class ChatDisplayLimitTests : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void compressedArchive();
+	void searchReachesArchived();
+	void contextMatchesUnlimited();
+	void summariesOfArchivedRuns();
+	void memoryStaysFlat();
+};
+
+void ChatDisplayLimitTests::compressedArchive()
+{
+	// Blocks of 4 records, 2 of them in memory: most blocks go to the file
+	ChatCompressedArchive archive(4, 2);
+	for (int i = 0; i < 101; ++i) {
+		QVERIFY(archive.append(record(i)));
+	}
+	QCOMPARE(archive.size(), 101);
+
+	// Read back in order and out of order, from the file, from memory and from the open block
+	for (int i : { 0, 1, 57, 3, 99, 100, 4, 92, 50 }) {
+		const ChatLogRecord read = archive.read(i);
+		QCOMPARE(read.timestamp, record(i).timestamp);
+		QCOMPARE(read.role, record(i).role);
+		QCOMPARE(read.sender, record(i).sender);
+		QCOMPARE(read.message, record(i).message);
+	}
+	QCOMPARE(archive.read(101).timestamp, qint64(-1));
+
+	// Memory holds two blocks whatever the length, and 8 bytes of file offset per block
+	const qint64 memory = archive.memoryUsage();
+	for (int i = 101; i < 1001; ++i) {
+		archive.append(record(i));
+	}
+	QCOMPARE(archive.read(1000).message, record(1000).message);
+	QCOMPARE(archive.read(7).message, record(7).message);
+	QVERIFY2(archive.memoryUsage() < memory + 4096, qPrintable(QString("%1 -> %2 bytes").arg(memory).arg(archive.memoryUsage())));
+
+	QVERIFY(archive.clear());
+	QCOMPARE(archive.size(), 0);
+	archive.append(record(5));
+	QCOMPARE(archive.read(0).message, record(5).message);
+}
+
+void ChatDisplayLimitTests::searchReachesArchived()
+{
+	uiChatWidget unlimited("Test", "Test");
+	uiChatWidget limited("Test", "Test");
+	limited.SetDisplayLimit(20);
+	fill(unlimited, 0, 300);
+	fill(limited, 0, 300);
+
+	// Archived messages are scanned, the rest comes from the index: the same hits either way
+	const QStringList queries = { "msg5", "common", "alpha", "msg1*", "alp* question", "\"msg12 common\"",
+		"role:user alpha", "from:Assistant alpha", "missing", "msg299 reply" };
+	for (const QString& query : queries) {
+		QCOMPARE(limited.SearchChatHistory(query), unlimited.SearchChatHistory(query));
+	}
+	QCOMPARE(limited.SearchChatHistory("msg5"), QVector<int>{ 5 });
+	QCOMPARE(limited.SearchChatHistory("common").size(), 300);
+}
+
+void ChatDisplayLimitTests::contextMatchesUnlimited()
+{
+	uiChatWidget unlimited("Test", "Test");
+	uiChatWidget limited("Test", "Test");
+	limited.SetDisplayLimit(20);
+	fill(unlimited, 0, 300);
+	fill(limited, 0, 300);
+
+	QCOMPARE(limited.GetContextTokenCount(), unlimited.GetContextTokenCount());
+
+	// Windows within the resident messages and reaching far into the archived ones
+	for (int maxMessages : { 5, 20, 100, 299, -1 }) {
+		QCOMPARE(textsOf(limited.BuildContextMessages(maxMessages)), textsOf(unlimited.BuildContextMessages(maxMessages)));
+
+		QByteArray limitedJson;
+		QByteArray unlimitedJson;
+		QCOMPARE(limited.WriteContextJson(limitedJson, maxMessages), unlimited.WriteContextJson(unlimitedJson, maxMessages));
+		QCOMPARE(limitedJson, unlimitedJson);
+	}
+
+	const qint64 total = unlimited.GetContextTokenCount();
+	for (qint64 budget : { qint64(0), qint64(40), qint64(500), total / 2, total - 1, total, total * 2 }) {
+		QCOMPARE(textsOf(limited.BuildContextMessagesByTokens(int(budget))), textsOf(unlimited.BuildContextMessagesByTokens(int(budget))));
+	}
+
+	// An open stream is counted with its current content
+	for (uiChatWidget* widget : { &unlimited, &limited }) {
+		widget->BeginStreamingMessage("Assistant");
+		widget->AppendStreamingChunk("partial answer");
+	}
+	QCOMPARE(limited.GetContextTokenCount(), unlimited.GetContextTokenCount());
+	QCOMPARE(textsOf(limited.BuildContextMessagesByTokens(200)), textsOf(unlimited.BuildContextMessagesByTokens(200)));
+}
+
+void ChatDisplayLimitTests::summariesOfArchivedRuns()
+{
+	// 40 messages, a window of 4, runs of 4 and 4 summaries: runs 5 to 8, all of them archived
+	uiChatWidget widget("Test", "Test", 4);
+	widget.SetDisplayLimit(2);
+	fill(widget, 0, 40);
+	widget.SetContextSummarizer([](const QList<ChatMessage>& messages) {
+		QStringList texts;
+		for (const ChatMessage& message : messages) {
+			texts.append(message.message.section(' ', 0, 0));
+		}
+		return texts.join('|');
+	}, 4, 4);
+
+	const QString heading("Summary of earlier conversation:\n");
+	QTRY_COMPARE_WITH_TIMEOUT(widget.GetContextSummaryCount(), 4, kWaitMs);
+	QCOMPARE(widget.BuildContextMessages().first().message, heading + "msg20|msg21|msg22|msg23");
+
+	// As the conversation goes on, summaries of runs no context reaches any more are dropped
+	fill(widget, 40, 40);
+	QTRY_COMPARE_WITH_TIMEOUT(widget.GetContextSummaryCount(), 4, kWaitMs);
+	QCOMPARE(widget.BuildContextMessages().first().message, heading + "msg60|msg61|msg62|msg63");
+}
+
+void ChatDisplayLimitTests::memoryStaysFlat()
+{
+	uiChatWidget widget("Test", "Test");
+	widget.SetDisplayLimit(50);
+
+	// Past the limit and the archive blocks kept in memory (16 x 64 messages), memory no longer follows the history
+	fill(widget, 0, 1500);
+	qint64 plateau = 0;
+	for (int first = 1500; first < 2000; first += 10) {
+		fill(widget, first, 10);
+		plateau = qMax(plateau, widget.GetHistoryMemoryUsage());
+	}
+	for (int first = 2000; first < 8000; first += 10) {
+		fill(widget, first, 10);
+		const qint64 memory = widget.GetHistoryMemoryUsage();
+		QVERIFY2(memory < plateau + plateau / 10, qPrintable(QString("%1 bytes at %2 messages, %3 at 2000").arg(memory).arg(first + 10).arg(plateau)));
+	}
+
+	QCOMPARE(widget.SearchChatHistory("msg17"), QVector<int>{ 17 });
+	QCOMPARE(widget.GetChatHistory().size(), 8000);
+}
+
+QTEST_MAIN(ChatDisplayLimitTests)
+
+#include "qtChatDisplayLimitTests.moc"
@@ -0,0 +1,208 @@
+/**
+ * File: qtChatJsonWriterTests.cpp
+ *
+ * History:
+ * When      | Who            | What
+ * ----------|----------------|------------------------------------------------
+ * 16/10/2026| Tian-Qing Ye   | Created: ChatJsonWriter and WriteContextJson against the QJsonDocument path
+ *
+ * Runs without a display (CTest sets QT_QPA_PLATFORM=offscreen).
+ */
+#include "qtChatJsonWriter.h"
+#include "qtChatWidget.h"
+#include <QtTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <initializer_list>
+
+namespace
+{
+	//! Text made of the given UTF-16 units, taken as they are (unpaired surrogates included)
+	QString fromUnits(std::initializer_list<ushort> units)
+	{
+		QString text;
+		for (ushort unit : units) {
+			text.append(QChar(unit));
+		}
+		return text;
+	}
+
+	//! A character outside the BMP (U+1F600), as a surrogate pair
+	QString emoji()
+	{
+		return fromUnits({ 0xd83d, 0xde00 });
+	}
+
+	//! The messages array as requests were written before ChatJsonWriter: QJsonObject / QJsonDocument
+	QByteArray viaQJson(const QList<ChatMessage>& messages)
+	{
+		QJsonArray array;
+		for (const ChatMessage& message : messages) {
+			array.append(QJsonObject{
+				{ "role", message.role.isEmpty() ? QString("user") : message.role },
+				{ "content", message.message }
+			});
+		}
+		return QJsonDocument(array).toJson(QJsonDocument::Compact);
+	}
+
+	//! Parse a JSON array; a parse error fails the current test
+	QJsonArray parseArray(const QByteArray& json)
+	{
+		QJsonParseError error;
+		const QJsonDocument document = QJsonDocument::fromJson(json, &error);
+		if (error.error != QJsonParseError::NoError || !document.isArray()) {
+			QTest::qFail(qPrintable(QString("Not a JSON array: %1 at offset %2").arg(error.errorString()).arg(error.offset)),
+				__FILE__, __LINE__);
+			return QJsonArray();
+		}
+		return document.array();
+	}
+
+	QList<ChatMessage> oneMessage(const QString& content)
+	{
+		return { ChatMessage(QString(), "You", content, "user") };
+	}
+}
+
+class ChatJsonWriterTests : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void sameAsQJson_data();
+	void sameAsQJson();
+	void unpairedSurrogates_data();
+	void unpairedSurrogates();
+	void appendsToBuffer();
+	void widgetContext();
+};
+
+void ChatJsonWriterTests::sameAsQJson_data()
+{
+	QTest::addColumn<QString>("text");
+
+	QString controls;
+	for (ushort unit = 0; unit < 0x20; ++unit) {
+		controls.append(QChar(unit));
+	}
+
+	// One chunk is 4096 UTF-16 units: text shorter, equal, longer, and with a pair across the boundary
+	const QString mixed = QString("\"quoted\" back\\slash\ttab\nline ") + fromUnits({ 0x01, 0xe9, 0x4e2d, 0x2028 }) + emoji();
+	QString long1;
+	while (long1.size() < 3 * 4096) {
+		long1 += mixed;
+	}
+
+	QTest::newRow("empty") << QString();
+	QTest::newRow("ascii") << QString("Hello, world! {\"not\": [\"json\"]} /path");
+	QTest::newRow("quotes and backslashes") << QString("\"\\\"\\\\\"\\n\\u0041");
+	QTest::newRow("control characters") << controls;
+	QTest::newRow("delete") << fromUnits({ 'a', 0x7f, 'b' });
+	QTest::newRow("line and paragraph separators") << fromUnits({ 'a', 0x2028, 'b', 0x2029, 'c' });
+	QTest::newRow("two and three byte utf-8") << fromUnits({ 0xe9, 0x7ff, 0x800, 0x4e2d, 0xfeff, 0xfffd, 0xffff });
+	QTest::newRow("surrogate pairs") << emoji() + fromUnits({ 0xd800, 0xdc00, 0xdbff, 0xdfff }) + emoji();
+	QTest::newRow("chunk - 1") << QString(4095, QChar('a'));
+	QTest::newRow("chunk") << QString(4096, QChar('"'));
+	QTest::newRow("chunk + 1") << QString(4097, QChar(0x01));
+	QTest::newRow("pair across chunks") << QString(4095, QChar('a')) + emoji() + QString(10, QChar('b'));
+	QTest::newRow("pair after chunk") << QString(4096, QChar('a')) + emoji();
+	QTest::newRow("escapes across chunks") << QString(4094, QChar('a')) + QString("\"\\\n\x01") + QString(4094, QChar(0xe9));
+	QTest::newRow("mixed, three chunks") << long1;
+}
+
+void ChatJsonWriterTests::sameAsQJson()
+{
+	QFETCH(QString, text);
+
+	QByteArray direct;
+	ChatJsonWriter::appendMessages(direct, oneMessage(text));
+
+	const QJsonArray parsed = parseArray(direct);
+	QCOMPARE(parsed, parseArray(viaQJson(oneMessage(text))));
+	QCOMPARE(parsed.at(0).toObject().value("content").toString(), text);
+}
+
+void ChatJsonWriterTests::unpairedSurrogates_data()
+{
+	QTest::addColumn<QString>("text");
+	QTest::addColumn<QString>("expected");
+
+	const ushort r = 0xfffd;
+	QTest::newRow("high") << fromUnits({ 'a', 0xd800, 'b' }) << fromUnits({ 'a', r, 'b' });
+	QTest::newRow("low") << fromUnits({ 'a', 0xdc00, 'b' }) << fromUnits({ 'a', r, 'b' });
+	QTest::newRow("high at the end") << fromUnits({ 'a', 0xdbff }) << fromUnits({ 'a', r });
+	QTest::newRow("reversed pair") << fromUnits({ 0xde00, 0xd83d }) << fromUnits({ r, r });
+	QTest::newRow("high before a pair") << fromUnits({ 0xd800, 0xd83d, 0xde00 }) << QString(QChar(r)) + emoji();
+	QTest::newRow("high at chunk end") << QString(4095, QChar('a')) + fromUnits({ 0xd800, 'b' })
+		<< QString(4095, QChar('a')) + fromUnits({ r, 'b' });
+	QTest::newRow("low at chunk start") << QString(4096, QChar('a')) + fromUnits({ 0xdc00 })
+		<< QString(4096, QChar('a')) + fromUnits({ r });
+}
+
+void ChatJsonWriterTests::unpairedSurrogates()
+{
+	QFETCH(QString, text);
+	QFETCH(QString, expected);
+
+	// They have no UTF-8 form: written as U+FFFD, so the output stays valid UTF-8
+	QByteArray direct;
+	ChatJsonWriter::appendString(direct, text);
+	const QByteArray expectedJson = QByteArray("\"") + expected.toUtf8() + QByteArray("\"");
+	QCOMPARE(parseArray("[" + direct + "]").at(0).toString(), expected);
+	QCOMPARE(direct, expectedJson);
+}
+
+void ChatJsonWriterTests::appendsToBuffer()
+{
+	QList<ChatMessage> messages;
+	messages.append(ChatMessage(QString(), "System", "Be brief.", "system"));
+	messages.append(ChatMessage(QString(), "You", "Hi \"there\"", QString()));
+	messages.append(ChatMessage(QString(), "Assistant", QString(5000, QChar(0x4e2d)), "assistant"));
+
+	// Appended after what the buffer holds; a reserved buffer keeps its capacity
+	QByteArray out("{\"messages\":");
+	out.reserve(64 * 1024);
+	const int capacity = out.capacity();
+	ChatJsonWriter::appendMessages(out, messages);
+	out.append('}');
+
+	QVERIFY(out.startsWith("{\"messages\":["));
+	QCOMPARE(out.capacity(), capacity);
+
+	const QJsonDocument document = QJsonDocument::fromJson(out);
+	QVERIFY(document.isObject());
+	QCOMPARE(document.object().value("messages").toArray(), parseArray(viaQJson(messages)));
+	QCOMPARE(document.object().value("messages").toArray().at(1).toObject().value("role").toString(), QString("user"));
+}
+
+void ChatJsonWriterTests::widgetContext()
+{
+	QList<ChatMessage> history;
+	const QString texts[] = {
+		QString("Plain question"),
+		QString("Reply with \"quotes\", a C:\\path and\ttabs\nover lines ") + emoji(),
+		fromUnits({ 0x01, 0x1f, 0x2028, 0xe9, 0x4e2d }),
+		QString(4095, QChar('x')) + emoji() + QString(9000, QChar('"'))
+	};
+	for (int i = 0; i < 8; ++i) {
+		history.append(ChatMessage("2026-07-20 09:00:00", (i % 2) ? "Assistant" : "You",
+			texts[i % 4], (i % 2) ? "assistant" : "user"));
+	}
+
+	uiChatWidget widget("Test", "Test");
+	widget.SetChatHistory(history);
+
+	for (int maxMessages : { -1, 3 }) {
+		const QList<ChatMessage> context = widget.BuildContextMessages(maxMessages);
+
+		QByteArray direct;
+		QCOMPARE(widget.WriteContextJson(direct, maxMessages), context.size());
+		QCOMPARE(parseArray(direct), parseArray(viaQJson(context)));
+	}
+}
+
+QTEST_MAIN(ChatJsonWriterTests)
+
+#include "qtChatJsonWriterTests.moc"